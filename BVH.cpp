@@ -0,0 +1,142 @@
+#include "BVH.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+void BVH::build(Scene &scene) {
+	nodes.clear();
+	leaves.clear();
+	leaf_index.clear();
+	dirty_leaves.clear();
+
+	leaves.reserve(scene.objects.size());
+	for (auto &kv : scene.objects) {
+		Leaf leaf;
+		leaf.name = &kv.first;
+		leaf.object = &kv.second;
+		leaf_index.insert(std::make_pair(leaf.object, uint32_t(leaves.size())));
+		leaves.emplace_back(leaf);
+	}
+	if (leaves.empty()) return;
+
+	//leaf indices, partitioned in place as the tree is built:
+	std::vector< uint32_t > order(leaves.size());
+	for (uint32_t i = 0; i < leaves.size(); ++i) {
+		order[i] = i;
+	}
+	nodes.reserve(2 * leaves.size() - 1);
+	build_range(&order[0], &order[0] + order.size(), -1U);
+}
+
+uint32_t BVH::build_range(uint32_t *begin, uint32_t *end, uint32_t parent) {
+	uint32_t index = uint32_t(nodes.size());
+	nodes.emplace_back();
+	nodes[index].parent = parent;
+
+	if (end - begin == 1) {
+		Leaf &leaf = leaves[*begin];
+		leaf.node = index;
+		nodes[index].leaf = *begin;
+		nodes[index].bounds = leaf.object->bounds.transformed(leaf.object->transform.make_local_to_world());
+		return index;
+	}
+
+	//split at the median of the widest axis of the leaf centers:
+	auto world_center = [this](uint32_t leaf) {
+		Scene::Object const &object = *leaves[leaf].object;
+		glm::vec3 center = (object.bounds.empty() ? glm::vec3(0.0f) : 0.5f * (object.bounds.min + object.bounds.max));
+		return glm::vec3(object.transform.make_local_to_world() * glm::vec4(center, 1.0f));
+	};
+	AABB centers;
+	for (uint32_t *i = begin; i != end; ++i) {
+		centers.enclose(world_center(*i));
+	}
+	glm::vec3 size = centers.max - centers.min;
+	int axis = (size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2));
+	uint32_t *mid = begin + (end - begin) / 2;
+	std::nth_element(begin, mid, end, [&world_center, axis](uint32_t a, uint32_t b) {
+		return world_center(a)[axis] < world_center(b)[axis];
+	});
+
+	//NOTE: 'nodes' may reallocate during the recursive calls, so index rather than hold references:
+	uint32_t left = build_range(begin, mid, index);
+	uint32_t right = build_range(mid, end, index);
+	nodes[index].left = left;
+	nodes[index].right = right;
+	nodes[index].bounds = nodes[left].bounds;
+	nodes[index].bounds.enclose(nodes[right].bounds);
+	return index;
+}
+
+void BVH::moved(Scene::Object const *object) {
+	auto f = leaf_index.find(object);
+	if (f == leaf_index.end()) return;
+	Leaf &leaf = leaves[f->second];
+	if (!leaf.dirty) {
+		leaf.dirty = true;
+		dirty_leaves.emplace_back(f->second);
+	}
+}
+
+void BVH::refit() {
+	for (uint32_t l : dirty_leaves) {
+		Leaf &leaf = leaves[l];
+		leaf.dirty = false;
+		Node &node = nodes[leaf.node];
+		node.bounds = leaf.object->bounds.transformed(leaf.object->transform.make_local_to_world());
+		for (uint32_t n = node.parent; n != -1U; n = nodes[n].parent) {
+			Node &parent = nodes[n];
+			parent.bounds = nodes[parent.left].bounds;
+			parent.bounds.enclose(nodes[parent.right].bounds);
+		}
+	}
+	dirty_leaves.clear();
+}
+
+void BVH::query(Frustum const &frustum, std::vector< Scene::Object * > *objects) const {
+	if (nodes.empty()) return;
+	uint32_t stack[64];
+	uint32_t top = 0;
+	stack[top++] = 0;
+	while (top) {
+		Node const &node = nodes[stack[--top]];
+		if (!frustum.intersects(node.bounds)) continue;
+		if (node.leaf != -1U) {
+			objects->emplace_back(leaves[node.leaf].object);
+		} else {
+			//median splits keep the depth near log2(objects), far below the stack size:
+			assert(top + 2 <= 64);
+			stack[top++] = node.right;
+			stack[top++] = node.left;
+		}
+	}
+}
+
+bool BVH::raycast(glm::vec3 const &origin, glm::vec3 const &direction, Hit *hit, float max_t, Scene::Object const *ignore) const {
+	if (nodes.empty()) return false;
+	glm::vec3 inv_direction = 1.0f / direction;
+	Hit best;
+	best.t = max_t;
+	uint32_t stack[64];
+	uint32_t top = 0;
+	stack[top++] = 0;
+	while (top) {
+		Node const &node = nodes[stack[--top]];
+		float t;
+		if (!node.bounds.intersect_ray(origin, inv_direction, best.t, &t)) continue;
+		if (node.leaf != -1U) {
+			Leaf const &leaf = leaves[node.leaf];
+			if (leaf.object == ignore) continue;
+			best.name = leaf.name;
+			best.object = leaf.object;
+			best.t = t;
+		} else {
+			assert(top + 2 <= 64);
+			stack[top++] = node.right;
+			stack[top++] = node.left;
+		}
+	}
+	if (!best.object) return false;
+	if (hit) *hit = best;
+	return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Scene.hpp"
+#include "Bounds.hpp"
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <unordered_map>
+#include <string>
+#include <limits>
+
+//"BVH" is a bounding-volume hierarchy over the world-space bounds of a scene's objects.
+// It is built once, then kept up to date by flagging the objects that move (with 'moved')
+// and calling 'refit', which only touches the paths from those objects to the root.
+
+struct BVH {
+	//(re)build the hierarchy over every object currently in 'scene':
+	// note: must be rebuilt if objects are added to or removed from the scene.
+	void build(Scene &scene);
+
+	//flag an object whose transform changed since the last build/refit:
+	void moved(Scene::Object const *object);
+	//recompute bounds for flagged objects and their ancestors:
+	void refit();
+
+	//append every object whose world-space bounds intersect 'frustum':
+	void query(Frustum const &frustum, std::vector< Scene::Object * > *objects) const;
+
+	//nearest object whose world-space bounds are hit by the ray (origin + t * direction):
+	struct Hit {
+		std::string const *name = nullptr;
+		Scene::Object *object = nullptr;
+		float t = 0.0f;
+	};
+	// returns false if nothing is hit with t in [0, max_t]; 'ignore' is skipped (e.g., the object doing the looking)
+	bool raycast(glm::vec3 const &origin, glm::vec3 const &direction, Hit *hit,
+		float max_t = std::numeric_limits< float >::infinity(), Scene::Object const *ignore = nullptr) const;
+
+	//internals:
+	struct Node {
+		AABB bounds;
+		uint32_t parent = -1U;
+		uint32_t left = -1U, right = -1U; //children (interior nodes only)
+		uint32_t leaf = -1U; //index into 'leaves' (leaf nodes only)
+	};
+	struct Leaf {
+		std::string const *name = nullptr;
+		Scene::Object *object = nullptr;
+		uint32_t node = -1U;
+		bool dirty = false;
+	};
+	std::vector< Node > nodes; //nodes[0] is the root
+	std::vector< Leaf > leaves;
+	std::unordered_map< Scene::Object const *, uint32_t > leaf_index;
+	std::vector< uint32_t > dirty_leaves;
+
+	uint32_t build_range(uint32_t *begin, uint32_t *end, uint32_t parent);
+};
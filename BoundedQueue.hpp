@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+//"BoundedQueue" is a fixed-capacity multi-producer, multi-consumer FIFO that never locks or allocates
+// after construction: 'push' fails when the queue is full and 'pop' fails when it is empty,
+// leaving the caller to decide whether to drop, retry, or sleep.
+//Each cell carries a sequence number that tells producers and consumers whether it is theirs to fill or empty
+// (after Dmitry Vyukov's bounded MPMC queue).
+
+template< typename T >
+struct BoundedQueue {
+	//capacity is rounded up to a power of two:
+	BoundedQueue(uint32_t capacity) {
+		size_t size = 1;
+		while (size < capacity) size *= 2;
+		mask = size - 1;
+		cells.reset(new Cell[size]);
+		for (size_t i = 0; i < size; ++i) {
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+	BoundedQueue(BoundedQueue const &) = delete;
+
+	bool push(T const &value) {
+		size_t position = tail.load(std::memory_order_relaxed);
+		while (true) {
+			Cell &cell = cells[position & mask];
+			size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			intptr_t difference = intptr_t(sequence) - intptr_t(position);
+			if (difference == 0) {
+				//cell is free; claim it (or find out someone else did):
+				if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					cell.value = value;
+					cell.sequence.store(position + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (difference < 0) {
+				return false; //full
+			} else {
+				position = tail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	bool pop(T *value) {
+		size_t position = head.load(std::memory_order_relaxed);
+		while (true) {
+			Cell &cell = cells[position & mask];
+			size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			intptr_t difference = intptr_t(sequence) - intptr_t(position + 1);
+			if (difference == 0) {
+				if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					*value = cell.value;
+					cell.sequence.store(position + mask + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (difference < 0) {
+				return false; //empty
+			} else {
+				position = head.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	size_t capacity() const { return mask + 1; }
+
+	//internals:
+	struct Cell {
+		std::atomic< size_t > sequence;
+		T value;
+	};
+	std::unique_ptr< Cell[] > cells;
+	size_t mask = 0;
+	//(producers and consumers each get their own cache line)
+	alignas(64) std::atomic< size_t > tail{0};
+	alignas(64) std::atomic< size_t > head{0};
+};
@@ -0,0 +1,191 @@
+#include "Bounds.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define BOUNDS_USE_SSE 1
+#endif
+
+void AABB::enclose(glm::vec3 const &point) {
+	min = glm::min(min, point);
+	max = glm::max(max, point);
+}
+
+void AABB::enclose(AABB const &box) {
+	min = glm::min(min, box.min);
+	max = glm::max(max, box.max);
+}
+
+AABB AABB::transformed(glm::mat4 const &xf) const {
+	if (empty()) return *this;
+	//transform center + extents (after Arvo, "Transforming Axis-Aligned Bounding Boxes"):
+	glm::vec3 center = 0.5f * (min + max);
+	glm::vec3 radius = 0.5f * (max - min);
+	glm::vec3 new_center = glm::vec3(xf * glm::vec4(center, 1.0f));
+	glm::vec3 new_radius =
+		  glm::abs(glm::vec3(xf[0])) * radius.x
+		+ glm::abs(glm::vec3(xf[1])) * radius.y
+		+ glm::abs(glm::vec3(xf[2])) * radius.z;
+	AABB ret;
+	ret.min = new_center - new_radius;
+	ret.max = new_center + new_radius;
+	return ret;
+}
+
+bool AABB::intersect_ray(glm::vec3 const &origin, glm::vec3 const &inv_direction, float max_t, float *t) const {
+	float t0 = 0.0f;
+	float t1 = max_t;
+	for (int i = 0; i < 3; ++i) {
+		float enter = (min[i] - origin[i]) * inv_direction[i];
+		float exit = (max[i] - origin[i]) * inv_direction[i];
+		if (enter > exit) std::swap(enter, exit);
+		//(NaN from 0 * inf fails both comparisons, leaving the interval alone)
+		if (enter > t0) t0 = enter;
+		if (exit < t1) t1 = exit;
+		if (t0 > t1) return false;
+	}
+	if (t) *t = t0;
+	return true;
+}
+
+Sphere Sphere::transformed(glm::mat4 const &xf) const {
+	Sphere ret;
+	ret.center = glm::vec3(xf * glm::vec4(center, 1.0f));
+	float scale = std::max(glm::length(glm::vec3(xf[0])), std::max(glm::length(glm::vec3(xf[1])), glm::length(glm::vec3(xf[2]))));
+	ret.radius = radius * scale;
+	return ret;
+}
+
+Frustum Frustum::from_clip(glm::mat4 const &world_to_clip) {
+	//Gribb/Hartmann plane extraction, using rows of the matrix:
+	glm::mat4 m = glm::transpose(world_to_clip);
+	Frustum frustum;
+	frustum.planes[Left]   = m[3] + m[0];
+	frustum.planes[Right]  = m[3] - m[0];
+	frustum.planes[Bottom] = m[3] + m[1];
+	frustum.planes[Top]    = m[3] - m[1];
+	frustum.planes[Near]   = m[3] + m[2];
+	frustum.planes[Far]    = m[3] - m[2];
+	for (auto &plane : frustum.planes) {
+		float length = glm::length(glm::vec3(plane));
+		if (length > 0.0f) plane /= length;
+	}
+	return frustum;
+}
+
+bool Frustum::intersects(AABB const &box) const {
+	if (box.empty()) return false;
+	for (auto const &plane : planes) {
+		//test the corner furthest along the plane normal:
+		glm::vec3 corner(
+			plane.x >= 0.0f ? box.max.x : box.min.x,
+			plane.y >= 0.0f ? box.max.y : box.min.y,
+			plane.z >= 0.0f ? box.max.z : box.min.z
+		);
+		if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f) return false;
+	}
+	return true;
+}
+
+bool Frustum::intersects(Sphere const &sphere) const {
+	for (auto const &plane : planes) {
+		if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius) return false;
+	}
+	return true;
+}
+
+void BoundsList::clear() {
+	count = 0;
+	center_x.clear(); center_y.clear(); center_z.clear();
+	extent_x.clear(); extent_y.clear(); extent_z.clear();
+	radius.clear();
+}
+
+void BoundsList::resize(uint32_t count_) {
+	count = count_;
+	//grow by full groups of four; unused slots get zero-size bounds at the origin:
+	uint32_t padded = (count + 3) / 4 * 4;
+	center_x.resize(padded, 0.0f); center_y.resize(padded, 0.0f); center_z.resize(padded, 0.0f);
+	extent_x.resize(padded, 0.0f); extent_y.resize(padded, 0.0f); extent_z.resize(padded, 0.0f);
+	radius.resize(padded, 0.0f);
+}
+
+void BoundsList::add(AABB const &box, Sphere const &sphere) {
+	resize(count + 1);
+	set(count - 1, box, sphere);
+}
+
+void BoundsList::set(uint32_t index, AABB const &box, Sphere const &sphere) {
+	if (box.empty()) {
+		//unknown bounds are never culled ("huge", but finite so that 0 * extent stays 0):
+		const float Huge = 1e30f;
+		center_x[index] = center_y[index] = center_z[index] = 0.0f;
+		extent_x[index] = extent_y[index] = extent_z[index] = Huge;
+		radius[index] = Huge;
+	} else {
+		glm::vec3 center = 0.5f * (box.min + box.max);
+		glm::vec3 extent = 0.5f * (box.max - box.min);
+		center_x[index] = center.x; center_y[index] = center.y; center_z[index] = center.z;
+		extent_x[index] = extent.x; extent_y[index] = extent.y; extent_z[index] = extent.z;
+		//the sphere is usually centered close to the box, so test it about the box center (growing it to stay conservative):
+		radius[index] = sphere.radius + glm::length(sphere.center - center);
+	}
+}
+
+void BoundsList::cull(Frustum const &frustum, std::vector< uint8_t > *visible) const {
+	visible->resize(count);
+	if (count) cull(frustum, &(*visible)[0], 0, count);
+}
+
+void BoundsList::cull(Frustum const &frustum, uint8_t *visible, uint32_t begin, uint32_t end) const {
+	assert(begin % 4 == 0);
+	end = std::min(end, count);
+	//each plane rejects bounds whose center is further behind it than the smaller of
+	// the box's projected extent along the plane normal and the sphere radius:
+#ifdef BOUNDS_USE_SSE
+	__m128 sign_mask = _mm_set1_ps(-0.0f);
+	for (uint32_t i = begin; i < end; i += 4) {
+		__m128 cx = _mm_loadu_ps(&center_x[i]);
+		__m128 cy = _mm_loadu_ps(&center_y[i]);
+		__m128 cz = _mm_loadu_ps(&center_z[i]);
+		__m128 ex = _mm_loadu_ps(&extent_x[i]);
+		__m128 ey = _mm_loadu_ps(&extent_y[i]);
+		__m128 ez = _mm_loadu_ps(&extent_z[i]);
+		__m128 r = _mm_loadu_ps(&radius[i]);
+		__m128 inside = _mm_cmpeq_ps(r, r); //all ones
+		for (auto const &plane : frustum.planes) {
+			__m128 a = _mm_set1_ps(plane.x);
+			__m128 b = _mm_set1_ps(plane.y);
+			__m128 c = _mm_set1_ps(plane.z);
+			__m128 d = _mm_set1_ps(plane.w);
+			__m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, cx), _mm_mul_ps(b, cy)), _mm_add_ps(_mm_mul_ps(c, cz), d));
+			__m128 box_r = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(_mm_andnot_ps(sign_mask, a), ex),
+				_mm_mul_ps(_mm_andnot_ps(sign_mask, b), ey)),
+				_mm_mul_ps(_mm_andnot_ps(sign_mask, c), ez));
+			__m128 reach = _mm_min_ps(box_r, r);
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, _mm_sub_ps(_mm_setzero_ps(), reach)));
+		}
+		int mask = _mm_movemask_ps(inside);
+		for (uint32_t j = 0; j < 4 && i + j < end; ++j) {
+			visible[i + j] = uint8_t((mask >> j) & 1);
+		}
+	}
+#else
+	for (uint32_t i = begin; i < end; ++i) {
+		bool inside = true;
+		for (auto const &plane : frustum.planes) {
+			float dist = plane.x * center_x[i] + plane.y * center_y[i] + plane.z * center_z[i] + plane.w;
+			float box_r = std::abs(plane.x) * extent_x[i] + std::abs(plane.y) * extent_y[i] + std::abs(plane.z) * extent_z[i];
+			if (dist < -std::min(box_r, radius[i])) {
+				inside = false;
+				break;
+			}
+		}
+		visible[i] = (inside ? 1 : 0);
+	}
+#endif
+}
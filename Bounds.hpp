@@ -0,0 +1,68 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <limits>
+#include <vector>
+#include <cstdint>
+
+//Axis-aligned bounding box; starts out empty (min > max):
+struct AABB {
+	glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
+	glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+
+	bool empty() const { return min.x > max.x; }
+	void enclose(glm::vec3 const &point);
+	void enclose(AABB const &box);
+
+	//box around this box after transformation by 'xf':
+	AABB transformed(glm::mat4 const &xf) const;
+
+	//distance along ray (origin + t * direction) at which the ray enters the box, if within [0, max_t]:
+	// (inv_direction is 1.0f / direction, computed once per ray)
+	bool intersect_ray(glm::vec3 const &origin, glm::vec3 const &inv_direction, float max_t, float *t) const;
+};
+
+//Bounding sphere:
+struct Sphere {
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.0f;
+
+	//sphere around this sphere after transformation by 'xf':
+	Sphere transformed(glm::mat4 const &xf) const;
+};
+
+//View frustum as inward-facing planes (dot(plane, vec4(p, 1)) >= 0 inside every plane):
+struct Frustum {
+	enum { Left, Right, Bottom, Top, Near, Far, PlaneCount };
+	glm::vec4 planes[PlaneCount];
+
+	//extract planes from a world-to-clip matrix:
+	// note: for an infinite projection the far plane is degenerate, and never rejects anything.
+	static Frustum from_clip(glm::mat4 const &world_to_clip);
+
+	bool intersects(AABB const &box) const;
+	bool intersects(Sphere const &sphere) const;
+};
+
+//Many (world-space) bounds stored as structure-of-arrays, for testing in batches:
+struct BoundsList {
+	void clear();
+	//add an object's box and sphere; the object is treated as lying inside both:
+	void add(AABB const &box, Sphere const &sphere);
+	//or size the list up front and fill entries in any order (e.g., from several threads):
+	void resize(uint32_t count);
+	void set(uint32_t index, AABB const &box, Sphere const &sphere);
+	uint32_t size() const { return count; }
+
+	//set (*visible)[i] to 1 if bounds i may intersect the frustum, 0 if not:
+	// (uses SSE when available, testing four bounds at a time)
+	void cull(Frustum const &frustum, std::vector< uint8_t > *visible) const;
+	//same, for entries [begin, end) only ('begin' must be a multiple of four; 'visible' must hold 'end' entries):
+	void cull(Frustum const &frustum, uint8_t *visible, uint32_t begin, uint32_t end) const;
+
+	//internals (arrays are padded to a multiple of four entries):
+	uint32_t count = 0;
+	std::vector< float > center_x, center_y, center_z;
+	std::vector< float > extent_x, extent_y, extent_z;
+	std::vector< float > radius;
+};
@@ -0,0 +1,203 @@
+#include "Checkpoint.hpp"
+#include "MappedFile.hpp"
+#include "read_chunk.hpp"
+#include "write_chunk.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include <stdexcept>
+#include <cassert>
+#include <algorithm>
+
+namespace {
+	struct TransformEntry {
+		int32_t parent; //index into the object chunk, or -1 for none
+		glm::vec3 position;
+		glm::quat rotation;
+		glm::vec3 scale;
+	};
+	static_assert(sizeof(TransformEntry) == 44, "TransformEntry is packed");
+
+	struct ObjectEntry {
+		uint32_t name_begin, name_end;
+		TransformEntry transform;
+	};
+	static_assert(sizeof(ObjectEntry) == 52, "ObjectEntry is packed");
+
+	struct CameraEntry {
+		TransformEntry transform;
+		float fovy, aspect, near_plane;
+	};
+	static_assert(sizeof(CameraEntry) == 56, "CameraEntry is packed");
+
+	struct LightEntry {
+		TransformEntry transform;
+		uint32_t type;
+		glm::vec3 intensity;
+		float range;
+	};
+	static_assert(sizeof(LightEntry) == 64, "LightEntry is packed");
+
+	TransformEntry make_entry(Scene::Transform const &transform, std::unordered_map< Scene::Transform const *, int32_t > const &indices) {
+		TransformEntry entry;
+		entry.parent = -1;
+		if (transform.parent) {
+			auto f = indices.find(transform.parent);
+			if (f != indices.end()) {
+				entry.parent = f->second;
+			} else {
+				std::cerr << "WARNING: checkpoint only records parents that are scene objects; flattening hierarchy." << std::endl;
+			}
+		}
+		entry.position = transform.position;
+		entry.rotation = transform.rotation;
+		entry.scale = transform.scale;
+		return entry;
+	}
+
+	void restore_entry(TransformEntry const &entry, Scene::Transform *transform, std::vector< Scene::Object * > const &objects) {
+		transform->position = entry.position;
+		transform->rotation = entry.rotation;
+		transform->scale = entry.scale;
+		Scene::Transform *parent = nullptr;
+		if (entry.parent >= 0) {
+			if (uint32_t(entry.parent) >= objects.size()) throw std::runtime_error("checkpoint transform has out-of-range parent");
+			if (objects[entry.parent]) parent = &objects[entry.parent]->transform;
+		}
+		if (transform->parent != parent) transform->set_parent(parent);
+	}
+}
+
+void save_checkpoint(std::string const &filename, Scene const &scene, MatchState const &match) {
+	//number objects first, so parents can be written as indices:
+	std::unordered_map< Scene::Transform const *, int32_t > indices;
+	for (auto const &kv : scene.objects) {
+		int32_t index = int32_t(indices.size());
+		indices.insert(std::make_pair(&kv.second.transform, index));
+	}
+
+	std::vector< char > strings;
+	std::vector< ObjectEntry > objects;
+	objects.reserve(scene.objects.size());
+	for (auto const &kv : scene.objects) {
+		ObjectEntry entry;
+		entry.name_begin = uint32_t(strings.size());
+		strings.insert(strings.end(), kv.first.begin(), kv.first.end());
+		entry.name_end = uint32_t(strings.size());
+		entry.transform = make_entry(kv.second.transform, indices);
+		objects.emplace_back(entry);
+	}
+	//pad so the chunks that follow stay aligned for in-place reads:
+	strings.resize((strings.size() + 3) / 4 * 4, '\0');
+
+	std::vector< CameraEntry > camera(1);
+	camera[0].transform = make_entry(scene.camera.transform, indices);
+	camera[0].fovy = scene.camera.fovy;
+	camera[0].aspect = scene.camera.aspect;
+	camera[0].near_plane = scene.camera.near_plane;
+
+	std::vector< LightEntry > lights;
+	for (auto const &light : scene.lights) {
+		LightEntry entry;
+		entry.transform = make_entry(light.transform, indices);
+		entry.type = uint32_t(light.type);
+		entry.intensity = light.intensity;
+		entry.range = light.range;
+		lights.emplace_back(entry);
+	}
+
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) throw std::runtime_error("Failed to open '" + filename + "' for writing.");
+	write_chunk(file, "str0", strings);
+	write_chunk(file, "chk0", objects);
+	write_chunk(file, "cam0", camera);
+	write_chunk(file, "lit0", lights);
+	write_chunk(file, "mat0", std::vector< MatchState >(1, match));
+	if (!file.flush()) throw std::runtime_error("Failed to write '" + filename + "'.");
+}
+
+void load_checkpoint(std::string const &filename, Scene *scene_, MatchState *match) {
+	assert(scene_);
+	assert(match);
+	Scene &scene = *scene_;
+
+	MappedFile file(filename);
+	char const *at = file.data;
+	char const *end = file.data + file.size;
+	if (!at) throw std::runtime_error("Checkpoint '" + filename + "' is empty.");
+
+	char const *strings; size_t strings_size;
+	read_chunk(&at, end, "str0", &strings, &strings_size);
+	ObjectEntry const *objects; size_t object_count;
+	read_chunk(&at, end, "chk0", &objects, &object_count);
+	CameraEntry const *camera; size_t camera_count;
+	read_chunk(&at, end, "cam0", &camera, &camera_count);
+	LightEntry const *lights; size_t light_count;
+	read_chunk(&at, end, "lit0", &lights, &light_count);
+	MatchState const *match_state; size_t match_count;
+	read_chunk(&at, end, "mat0", &match_state, &match_count);
+	if (camera_count != 1 || match_count != 1) throw std::runtime_error("Checkpoint should have exactly one camera and match state.");
+	if (at != end) {
+		std::cerr << "WARNING: trailing data in checkpoint file '" << filename << "'" << std::endl;
+	}
+
+	//reject parent loops up front, since linking one would leave the scene with a cycle:
+	for (size_t i = 0; i < object_count; ++i) {
+		size_t steps = 0;
+		for (int32_t p = objects[i].transform.parent; p >= 0; p = objects[p].transform.parent) {
+			if (uint32_t(p) >= object_count) throw std::runtime_error("checkpoint transform has out-of-range parent");
+			if (uint32_t(p) == i || ++steps > object_count) throw std::runtime_error("checkpoint object has a parent cycle");
+		}
+	}
+
+	//find objects by name (one buffer is reused for the lookups, so this doesn't allocate per object):
+	std::vector< Scene::Object * > targets(object_count, nullptr);
+	std::string name;
+	for (size_t i = 0; i < object_count; ++i) {
+		ObjectEntry const &entry = objects[i];
+		if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings_size)) {
+			throw std::runtime_error("checkpoint object has out-of-range name begin/end");
+		}
+		name.assign(strings + entry.name_begin, strings + entry.name_end);
+		auto f = scene.objects.find(name);
+		if (f == scene.objects.end()) {
+			std::cerr << "WARNING: checkpoint object '" << name << "' is not in the scene." << std::endl;
+			continue;
+		}
+		targets[i] = &f->second;
+	}
+	{ //each object at most once, so the loop check above also holds for the linked transforms:
+		std::vector< Scene::Object * > sorted(targets);
+		std::sort(sorted.begin(), sorted.end());
+		for (size_t i = 1; i < sorted.size(); ++i) {
+			if (sorted[i] && sorted[i] == sorted[i-1]) throw std::runtime_error("checkpoint names an object more than once");
+		}
+	}
+
+	//restore transforms once all targets are known (parents may come later in the file):
+	for (size_t i = 0; i < object_count; ++i) {
+		if (targets[i]) restore_entry(objects[i].transform, &targets[i]->transform, targets);
+	}
+
+	restore_entry(camera->transform, &scene.camera.transform, targets);
+	scene.camera.fovy = camera->fovy;
+	scene.camera.aspect = camera->aspect;
+	scene.camera.near_plane = camera->near_plane;
+
+	//reuse existing lights where possible:
+	while (scene.lights.size() > light_count) scene.lights.pop_back();
+	while (scene.lights.size() < light_count) scene.lights.emplace_back();
+	auto light = scene.lights.begin();
+	for (size_t i = 0; i < light_count; ++i, ++light) {
+		LightEntry const &entry = lights[i];
+		if (entry.type > uint32_t(Scene::Light::Point)) throw std::runtime_error("checkpoint light has unknown type");
+		restore_entry(entry.transform, &light->transform, targets);
+		light->type = Scene::Light::Type(entry.type);
+		light->intensity = entry.intensity;
+		light->range = entry.range;
+	}
+
+	*match = *match_state;
+}
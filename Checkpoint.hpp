@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Scene.hpp"
+
+#include <glm/glm.hpp>
+#include <string>
+#include <cstdint>
+
+//Checkpoints store the runtime state of a scene (object transforms, the transform
+// hierarchy as indices, camera, lights) and of the match in a single chunked file
+// (see read_chunk.hpp). Loading maps the file and restores it in place.
+
+//Gameplay state that lives outside the scene:
+struct MatchState {
+	glm::vec2 player1_velocity = glm::vec2(0.0f); //(y, z)
+	glm::vec2 player2_velocity = glm::vec2(0.0f);
+	glm::vec2 ball_velocity = glm::vec2(0.0f);
+	int32_t hits = 0;
+	int32_t last_hit = 1;
+};
+static_assert(sizeof(MatchState) == 32, "MatchState is packed");
+
+//note: will throw if the file can't be written.
+void save_checkpoint(std::string const &filename, Scene const &scene, MatchState const &match);
+
+//restore into a scene holding the same objects (matched by name); missing objects are skipped with a warning.
+// note: will throw if the file can't be read or is malformed.
+void load_checkpoint(std::string const &filename, Scene *scene, MatchState *match);
@@ -0,0 +1,85 @@
+#include "CommandList.hpp"
+#include "GLState.hpp"
+
+#include <algorithm>
+
+
+void CommandList::draw(uint64_t key, GLuint program, GLuint vao, GLuint start, GLuint count, InstanceBuffer::Instance const &instance) {
+	Draw draw;
+	draw.key = key;
+	draw.program = program;
+	draw.vao = vao;
+	draw.start = start;
+	draw.count = count;
+	draw.first_instance = uint32_t(instances.size());
+	draw.instance_count = 1;
+	draws.emplace_back(draw);
+	instances.emplace_back(instance);
+}
+
+void CommandList::merge(std::vector< CommandList > const &parts, RenderQueue *queue) {
+	clear();
+
+	//sort (part, draw) pairs by key:
+	std::vector< uint32_t > part_base(parts.size());
+	uint32_t total = 0;
+	for (uint32_t p = 0; p < parts.size(); ++p) {
+		part_base[p] = total;
+		total += uint32_t(parts[p].draws.size());
+	}
+	queue->clear();
+	for (uint32_t p = 0; p < parts.size(); ++p) {
+		for (uint32_t d = 0; d < parts[p].draws.size(); ++d) {
+			queue->push(parts[p].draws[d].key, part_base[p] + d);
+		}
+	}
+	queue->sort();
+
+	for (auto const &item : queue->items) {
+		//part holding this draw is the last one starting at or before it:
+		uint32_t p = uint32_t(std::upper_bound(part_base.begin(), part_base.end(), item.index) - part_base.begin()) - 1;
+		CommandList const &part = parts[p];
+		Draw const &src = part.draws[item.index - part_base[p]];
+
+		bool extends = !draws.empty()
+			&& draws.back().program == src.program && draws.back().vao == src.vao
+			&& draws.back().start == src.start && draws.back().count == src.count;
+		if (!extends) {
+			Draw draw = src;
+			draw.first_instance = uint32_t(instances.size());
+			draw.instance_count = 0;
+			draws.emplace_back(draw);
+		}
+		instances.insert(instances.end(),
+			part.instances.begin() + src.first_instance,
+			part.instances.begin() + src.first_instance + src.instance_count);
+		draws.back().instance_count += src.instance_count;
+	}
+}
+
+CommandList::Counts CommandList::execute(GLState &gl, StreamingBuffer &streaming, InstanceBuffer &instance_buffer) const {
+	Counts counts;
+	if (draws.empty()) return counts;
+
+	instance_buffer.upload(instances, streaming);
+
+	GLuint current_program = 0;
+	GLuint current_vao = 0;
+	for (auto const &draw : draws) {
+		if (draw.program != current_program) {
+			gl.use_program(draw.program);
+			current_program = draw.program;
+			counts.program_changes += 1;
+		}
+		if (draw.vao != current_vao) {
+			gl.bind_vertex_array(draw.vao);
+			current_vao = draw.vao;
+			counts.vao_changes += 1;
+		}
+		instance_buffer.point(draw.vao, draw.first_instance, gl);
+
+		glDrawArraysInstanced(GL_TRIANGLES, draw.start, draw.count, draw.instance_count);
+		counts.draws += 1;
+	}
+	return counts;
+}
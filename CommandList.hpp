@@ -0,0 +1,48 @@
+#pragma once
+
+#include "InstanceBuffer.hpp"
+#include "RenderQueue.hpp"
+
+#include <vector>
+#include <cstdint>
+
+struct GLState;
+struct StreamingBuffer;
+
+//"CommandList" records draws as plain data, so that it can be filled on any thread:
+// worker threads each record part of a frame into their own list, the parts are merged
+// (sorted by key, with consecutive draws of the same vertices combined into instanced draws),
+// and the merged list is then executed on the thread that owns the GL context.
+
+struct CommandList {
+	struct Draw {
+		uint64_t key = 0; //see RenderQueue::make_key
+		GLuint program = 0;
+		GLuint vao = 0;
+		GLuint start = 0, count = 0; //vertex range
+		uint32_t first_instance = 0, instance_count = 0; //range of 'instances'
+	};
+	std::vector< Draw > draws;
+	std::vector< InstanceBuffer::Instance > instances;
+
+	void clear() {
+		draws.clear();
+		instances.clear();
+	}
+
+	//record a single-instance draw:
+	void draw(uint64_t key, GLuint program, GLuint vao, GLuint start, GLuint count, InstanceBuffer::Instance const &instance);
+
+	//replace this list with the draws of 'parts', sorted by key, and with runs that share
+	// program, vao, and vertex range merged into one instanced draw:
+	// ('queue' is scratch space for the sort)
+	void merge(std::vector< CommandList > const &parts, RenderQueue *queue);
+
+	//issue the recorded draws (GL thread only):
+	struct Counts {
+		uint32_t program_changes = 0; //glUseProgram calls
+		uint32_t vao_changes = 0; //glBindVertexArray calls
+		uint32_t draws = 0; //glDrawArraysInstanced calls
+	};
+	Counts execute(GLState &gl, StreamingBuffer &streaming, InstanceBuffer &instance_buffer) const;
+};
@@ -0,0 +1,105 @@
+#include "FileWatcher.hpp"
+
+#include <iostream>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef __linux__
+
+FileWatcher::FileWatcher() {
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd < 0) {
+		std::cerr << "WARNING: inotify unavailable (" << std::strerror(errno) << "); files won't be watched." << std::endl;
+	}
+}
+
+FileWatcher::~FileWatcher() {
+	if (fd >= 0) close(fd);
+}
+
+void FileWatcher::watch(std::string const &path) {
+	paths.emplace_back(path);
+	if (fd < 0) return;
+
+	std::string directory = "./";
+	auto slash = path.rfind('/');
+	if (slash != std::string::npos) directory = path.substr(0, slash + 1);
+
+	for (auto const &kv : directories) {
+		if (kv.second == directory) return;
+	}
+	int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+	if (wd < 0) {
+		std::cerr << "WARNING: can't watch '" << directory << "' (" << std::strerror(errno) << ")." << std::endl;
+		return;
+	}
+	directories[wd] = directory;
+}
+
+std::vector< std::string > FileWatcher::poll() {
+	std::vector< std::string > changed;
+	if (fd < 0) return changed;
+
+	alignas(struct inotify_event) char buffer[4096];
+	while (true) {
+		ssize_t length = read(fd, buffer, sizeof(buffer));
+		if (length <= 0) break; //EAGAIN: nothing more to read
+		for (char const *at = buffer; at < buffer + length; ) {
+			struct inotify_event const *event = reinterpret_cast< struct inotify_event const * >(at);
+			at += sizeof(struct inotify_event) + event->len;
+			if (event->len == 0) continue;
+			auto f = directories.find(event->wd);
+			if (f == directories.end()) continue;
+			std::string name = event->name; //(name is null-padded)
+			for (auto const &path : paths) {
+				bool match = (path == f->second + name) || (f->second == "./" && path == name);
+				if (match && std::find(changed.begin(), changed.end(), path) == changed.end()) {
+					changed.emplace_back(path);
+				}
+			}
+		}
+	}
+	return changed;
+}
+
+#else
+
+static std::time_t modification_time(std::string const &path) {
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0) return 0;
+	return info.st_mtime;
+}
+
+FileWatcher::FileWatcher() {
+}
+
+FileWatcher::~FileWatcher() {
+}
+
+void FileWatcher::watch(std::string const &path) {
+	paths.emplace_back(path);
+	mtimes[path] = modification_time(path);
+}
+
+std::vector< std::string > FileWatcher::poll() {
+	std::vector< std::string > changed;
+	for (auto const &path : paths) {
+		std::time_t mtime = modification_time(path);
+		if (mtime != mtimes[path]) {
+			mtimes[path] = mtime;
+			changed.emplace_back(path);
+		}
+	}
+	return changed;
+}
+
+#endif
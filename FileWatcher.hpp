@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <ctime>
+
+//"FileWatcher" reports when watched files are rewritten.
+// On Linux it uses inotify on the containing directories (so files replaced by rename are seen too);
+// elsewhere it falls back to comparing modification times on each poll.
+
+struct FileWatcher {
+	FileWatcher();
+	FileWatcher(FileWatcher const &) = delete;
+	~FileWatcher();
+
+	//start watching a file (the file needn't exist yet):
+	void watch(std::string const &path);
+
+	//watched paths (as passed to 'watch') that changed since the last poll; never blocks:
+	std::vector< std::string > poll();
+
+	//internals:
+	std::vector< std::string > paths;
+#ifdef __linux__
+	int fd = -1;
+	std::map< int, std::string > directories; //watch descriptor -> directory (with trailing '/')
+#else
+	std::map< std::string, std::time_t > mtimes;
+#endif
+};
@@ -0,0 +1,34 @@
+#include "FrameUniforms.hpp"
+#include "GLState.hpp"
+#include "StreamingBuffer.hpp"
+
+#include <stdexcept>
+
+FrameUniforms::FrameUniforms() {
+	GLint value = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &value);
+	alignment = (value < 1 ? 1 : value);
+}
+
+char const *FrameUniforms::declaration() {
+	return
+		"layout(std140) uniform Frame {\n"
+		"	mat4 projection;\n"
+		"	uvec4 cluster_grid;\n"
+		"	vec4 cluster_params;\n"
+		"};\n";
+}
+
+void FrameUniforms::attach(GLuint program) {
+	GLuint index = glGetUniformBlockIndex(program, "Frame");
+	if (index == GL_INVALID_INDEX) throw std::runtime_error("no uniform block named Frame");
+	GLint size = 0;
+	glGetActiveUniformBlockiv(program, index, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+	if (size != GLint(sizeof(Block))) throw std::runtime_error("uniform block Frame doesn't match FrameUniforms::Block");
+	glUniformBlockBinding(program, index, BindingPoint);
+}
+
+void FrameUniforms::upload(StreamingBuffer &streaming, GLState &gl) {
+	GLintptr offset = streaming.write(&block, sizeof(Block), alignment);
+	gl.bind_buffer_range(GL_UNIFORM_BUFFER, BindingPoint, streaming.buffer, offset, sizeof(Block));
+}
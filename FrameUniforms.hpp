@@ -0,0 +1,47 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+
+struct GLState;
+struct StreamingBuffer;
+
+//"FrameUniforms" holds values shared by every draw in a frame, as a std140 uniform block:
+//   layout(std140) uniform Frame {
+//     mat4 projection;     //camera to clip
+//     uvec4 cluster_grid;  //xyz: light cluster grid size, w: directional light count
+//     vec4 cluster_params; //xy: fragment coordinate to tile scale, zw: (near, slices / log(far / near))
+//   };
+//Each upload writes the block into the frame's region of a StreamingBuffer and binds it with glBindBufferRange.
+//(Per-object data is streamed separately, as instance attributes -- see InstanceBuffer.hpp.)
+
+struct FrameUniforms {
+	FrameUniforms();
+
+	struct Block {
+		glm::mat4 projection = glm::mat4(1.0f);
+		glm::uvec4 cluster_grid = glm::uvec4(0);
+		glm::vec4 cluster_params = glm::vec4(0.0f);
+	};
+	static_assert(sizeof(Block) == 96, "Block should match std140 layout");
+
+	//values for the next upload:
+	Block block;
+
+	enum : GLuint { BindingPoint = 0 }; //uniform buffer binding used for the block
+
+	//GLSL declaration of the block (for pasting into shader source after the #version line):
+	static char const *declaration();
+
+	//point a program's "Frame" block at BindingPoint:
+	// note: will throw if the program doesn't have one
+	static void attach(GLuint program);
+
+	//copy 'block' into the streaming buffer and bind it:
+	void upload(StreamingBuffer &streaming, GLState &gl);
+
+	//internals:
+	GLsizeiptr alignment = 1; //GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+};
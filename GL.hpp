@@ -9,3 +9,6 @@
 #define GL_GLEXT_PROTOTYPES 1
 #include "glcorearb.h"
 #endif
+
+//trace capture (redirects the GL calls listed in GLTrace.hpp):
+#include "GLTrace.hpp"
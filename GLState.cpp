@@ -0,0 +1,144 @@
+#include "GLState.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstring>
+
+bool GLState::changed(bool differs) {
+	if (differs) frame.issued += 1;
+	else frame.skipped += 1;
+	return differs;
+}
+
+void GLState::set_capability(GLenum cap, bool enabled) {
+	auto f = capabilities.find(cap);
+	if (!changed(f == capabilities.end() || f->second != enabled)) return;
+	capabilities[cap] = enabled;
+	if (enabled) glEnable(cap);
+	else glDisable(cap);
+}
+
+void GLState::blend_func(GLenum src, GLenum dst) {
+	if (!changed(!blend_known || blend_src != src || blend_dst != dst)) return;
+	blend_known = true;
+	blend_src = src;
+	blend_dst = dst;
+	glBlendFunc(src, dst);
+}
+
+void GLState::clear_color(glm::vec4 const &color) {
+	if (!changed(!clear_color_known || clear_color_value != color)) return;
+	clear_color_known = true;
+	clear_color_value = color;
+	glClearColor(color.x, color.y, color.z, color.w);
+}
+
+void GLState::use_program(GLuint program_) {
+	if (!changed(program != program_)) return;
+	program = program_;
+	glUseProgram(program);
+}
+
+void GLState::bind_vertex_array(GLuint vao_) {
+	if (!changed(vao != vao_)) return;
+	vao = vao_;
+	glBindVertexArray(vao);
+}
+
+void GLState::bind_buffer(GLenum target, GLuint buffer) {
+	auto f = buffers.find(target);
+	if (!changed(f == buffers.end() || f->second != buffer)) return;
+	buffers[target] = buffer;
+	glBindBuffer(target, buffer);
+}
+
+void GLState::bind_buffer_range(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+	uint64_t key = (uint64_t(target) << 32) | uint64_t(index);
+	auto f = buffer_ranges.find(key);
+	if (!changed(f == buffer_ranges.end() || f->second.buffer != buffer || f->second.offset != offset || f->second.size != size)) return;
+	BufferRange &range = buffer_ranges[key];
+	range.buffer = buffer;
+	range.offset = offset;
+	range.size = size;
+	buffers[target] = buffer;
+	glBindBufferRange(target, index, buffer, offset, size);
+}
+
+void GLState::bind_texture(GLuint unit, GLenum target, GLuint texture) {
+	uint64_t key = (uint64_t(unit) << 32) | uint64_t(target);
+	auto f = textures.find(key);
+	if (!changed(f == textures.end() || f->second != texture)) return;
+	textures[key] = texture;
+	if (changed(active_unit != unit)) {
+		active_unit = unit;
+		glActiveTexture(GL_TEXTURE0 + unit);
+	}
+	glBindTexture(target, texture);
+}
+
+bool GLState::uniform_changed(GLint location, void const *data, uint32_t size) {
+	if (location == -1) return false;
+	if (program == -1U) return changed(true); //don't know which program these belong to
+	uint64_t key = (uint64_t(program) << 32) | uint64_t(uint32_t(location));
+	UniformValue &value = uniforms[key];
+	if (!changed(value.size != size || std::memcmp(value.data, data, size) != 0)) return false;
+	value.size = size;
+	std::memcpy(value.data, data, size);
+	return true;
+}
+
+void GLState::uniform(GLint location, GLint value) {
+	if (uniform_changed(location, &value, sizeof(value))) {
+		glUniform1i(location, value);
+	}
+}
+
+void GLState::uniform(GLint location, glm::uvec3 const &value) {
+	if (uniform_changed(location, glm::value_ptr(value), sizeof(value))) {
+		glUniform3ui(location, value.x, value.y, value.z);
+	}
+}
+
+void GLState::uniform(GLint location, glm::vec2 const &value) {
+	if (uniform_changed(location, glm::value_ptr(value), sizeof(value))) {
+		glUniform2fv(location, 1, glm::value_ptr(value));
+	}
+}
+
+void GLState::uniform(GLint location, glm::mat3 const &value) {
+	if (uniform_changed(location, glm::value_ptr(value), sizeof(value))) {
+		glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+	}
+}
+
+void GLState::uniform(GLint location, glm::mat4 const &value) {
+	if (uniform_changed(location, glm::value_ptr(value), sizeof(value))) {
+		glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+	}
+}
+
+void GLState::invalidate() {
+	capabilities.clear();
+	blend_known = false;
+	clear_color_known = false;
+	program = -1U;
+	vao = -1U;
+	buffers.clear();
+	buffer_ranges.clear();
+	active_unit = -1U;
+	textures.clear();
+	uniforms.clear();
+}
+
+void GLState::forget_program(GLuint program_) {
+	for (auto u = uniforms.begin(); u != uniforms.end(); ) {
+		if ((u->first >> 32) == program_) u = uniforms.erase(u);
+		else ++u;
+	}
+	if (program == program_) program = -1U;
+}
+
+void GLState::begin_frame() {
+	last_frame = frame;
+	frame = Counters();
+}
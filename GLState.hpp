@@ -0,0 +1,74 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <cstdint>
+
+//"GLState" shadows the bits of OpenGL state that rendering sets, and drops calls that wouldn't change anything.
+// Everything that draws should set state through one of these, or call 'invalidate' after touching GL directly.
+//Uniform values are remembered per (program, location); they are compared byte-for-byte.
+
+struct GLState {
+	//capabilities (glEnable / glDisable):
+	void enable(GLenum cap) { set_capability(cap, true); }
+	void disable(GLenum cap) { set_capability(cap, false); }
+
+	void blend_func(GLenum src, GLenum dst);
+	void clear_color(glm::vec4 const &color);
+
+	void use_program(GLuint program);
+	void bind_vertex_array(GLuint vao);
+	void bind_buffer(GLenum target, GLuint buffer);
+	//binds [offset, offset+size) of 'buffer' to indexed binding point 'index' of 'target' (also binds 'target' itself, like GL does):
+	void bind_buffer_range(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+	//binds 'texture' to texture unit 'unit' (switching the active unit only if needed):
+	void bind_texture(GLuint unit, GLenum target, GLuint texture);
+
+	//uniforms of the program currently in use (location -1 is ignored, like GL does):
+	void uniform(GLint location, GLint value);
+	void uniform(GLint location, glm::uvec3 const &value);
+	void uniform(GLint location, glm::vec2 const &value);
+	void uniform(GLint location, glm::mat3 const &value);
+	void uniform(GLint location, glm::mat4 const &value);
+
+	//forget everything known about GL state (e.g., after code that calls GL directly):
+	void invalidate();
+	//forget remembered uniform values for a program (e.g., after it is relinked or deleted):
+	void forget_program(GLuint program);
+
+	//call counts, reset by 'begin_frame' (which keeps the previous frame's counts in 'last_frame'):
+	struct Counters {
+		uint32_t issued = 0;
+		uint32_t skipped = 0;
+	} frame, last_frame;
+	void begin_frame();
+
+	//internals:
+	void set_capability(GLenum cap, bool enabled);
+	bool changed(bool differs); //counts the call, returns 'differs'
+	bool uniform_changed(GLint location, void const *data, uint32_t size);
+
+	std::unordered_map< GLenum, bool > capabilities;
+	bool blend_known = false;
+	GLenum blend_src = 0, blend_dst = 0;
+	bool clear_color_known = false;
+	glm::vec4 clear_color_value = glm::vec4(0.0f);
+	GLuint program = -1U; //-1U == unknown
+	GLuint vao = -1U;
+	std::unordered_map< GLenum, GLuint > buffers; //target -> buffer
+	struct BufferRange {
+		GLuint buffer = 0;
+		GLintptr offset = 0;
+		GLsizeiptr size = 0;
+	};
+	std::unordered_map< uint64_t, BufferRange > buffer_ranges; //(target << 32 | index) -> range
+	GLuint active_unit = -1U;
+	std::unordered_map< uint64_t, GLuint > textures; //(unit << 32 | target) -> texture
+	struct UniformValue {
+		uint32_t size = 0;
+		uint8_t data[sizeof(glm::mat4)];
+	};
+	std::unordered_map< uint64_t, UniformValue > uniforms; //(program << 32 | location) -> value
+};
@@ -0,0 +1,632 @@
+#define GL_TRACE_NO_REDIRECT
+#include "GLTrace.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <map>
+#include <cstring>
+
+namespace {
+	struct Capture {
+		bool active = false;
+		uint32_t frames_left = 0;
+		std::string filename;
+		std::ofstream out;
+		std::vector< char > data; //records since the last flush
+
+		//ranges mapped for writing, by target (written into the trace when unmapped):
+		struct Mapping {
+			void *pointer = nullptr;
+			GLintptr offset = 0;
+			GLsizeiptr length = 0;
+			GLbitfield access = 0;
+		};
+		std::map< GLenum, Mapping > mappings;
+
+		void op(GLTrace::Op o) {
+			uint16_t v = o;
+			bytes(&v, sizeof(v));
+		}
+		void u32(uint32_t v) { bytes(&v, sizeof(v)); }
+		void u64(uint64_t v) { bytes(&v, sizeof(v)); }
+		void f32(float v) { bytes(&v, sizeof(v)); }
+		void blob(void const *src, size_t size) {
+			u32(uint32_t(size));
+			bytes(src, size);
+		}
+		void bytes(void const *src, size_t size) {
+			data.insert(data.end(), reinterpret_cast< char const * >(src), reinterpret_cast< char const * >(src) + size);
+		}
+		void flush() {
+			out.write(data.data(), data.size());
+			data.clear();
+		}
+	} capture;
+}
+
+char const *GLTrace::op_name(uint16_t op) {
+	static char const *names[OpCount] = {
+		"FrameEnd",
+		"ActiveTexture", "AttachShader", "BindBuffer", "BindBufferRange", "BindFramebuffer", "BindRenderbuffer", "BindTexture", "BindVertexArray",
+		"BlendFunc", "BufferData", "BufferSubData", "Clear", "ClearColor", "ClientWaitSync", "CompileShader",
+		"CreateProgram", "CreateShader", "DeleteBuffers", "DeleteFramebuffers", "DeleteProgram", "DeleteRenderbuffers", "DeleteShader",
+		"DeleteSync", "DeleteTextures", "DeleteVertexArrays", "Disable", "DrawArraysInstanced", "Enable", "EnableVertexAttribArray",
+		"FenceSync", "FramebufferRenderbuffer", "GenBuffers", "GenFramebuffers", "GenRenderbuffers",
+		"GenTextures", "GenVertexArrays", "GetAttribLocation", "GetUniformBlockIndex", "GetUniformLocation",
+		"LinkProgram", "MappedWrite", "PixelStorei", "ReadBuffer", "ReadPixels", "RenderbufferStorage",
+		"ShaderSource", "TexBuffer", "TexImage2D", "TexParameteri", "Uniform1i", "Uniform2fv", "Uniform3ui",
+		"UniformBlockBinding", "UniformMatrix3fv", "UniformMatrix4fv", "UseProgram", "VertexAttribDivisor",
+		"VertexAttribPointer", "Viewport",
+	};
+	return (op < OpCount ? names[op] : "(unknown)");
+}
+
+void GLTrace::start(std::string const &filename, uint32_t frames) {
+	if (capture.active) throw std::runtime_error("GLTrace already capturing to '" + capture.filename + "'.");
+	if (frames == 0) throw std::runtime_error("GLTrace needs at least one frame to capture.");
+	capture.out.open(filename, std::ios::binary);
+	if (!capture.out) throw std::runtime_error("Failed to open '" + filename + "' for writing a GL trace.");
+	capture.filename = filename;
+	capture.frames_left = frames;
+	capture.active = true;
+	capture.bytes("gltr", 4);
+	capture.u32(Version);
+}
+
+void GLTrace::frame() {
+	if (!capture.active) return;
+	capture.op(FrameEnd);
+	capture.flush();
+	capture.frames_left -= 1;
+	if (capture.frames_left == 0) {
+		capture.active = false;
+		capture.mappings.clear();
+		bool ok = bool(capture.out);
+		capture.out.close();
+		if (ok) {
+			std::cout << "Wrote GL trace to '" << capture.filename << "'." << std::endl;
+		} else {
+			std::cerr << "WARNING: failed to write GL trace to '" << capture.filename << "'." << std::endl;
+		}
+	}
+}
+
+bool GLTrace::capturing() {
+	return capture.active;
+}
+
+//------------ wrappers ------------
+
+void APIENTRY GLTrace::ActiveTexture_(GLenum texture) {
+	glActiveTexture(texture);
+	if (!capture.active) return;
+	capture.op(ActiveTexture);
+	capture.u32(texture);
+}
+
+void APIENTRY GLTrace::AttachShader_(GLuint program, GLuint shader) {
+	glAttachShader(program, shader);
+	if (!capture.active) return;
+	capture.op(AttachShader);
+	capture.u32(program);
+	capture.u32(shader);
+}
+
+void APIENTRY GLTrace::BindBuffer_(GLenum target, GLuint buffer) {
+	glBindBuffer(target, buffer);
+	if (!capture.active) return;
+	capture.op(BindBuffer);
+	capture.u32(target);
+	capture.u32(buffer);
+}
+
+void APIENTRY GLTrace::BindBufferRange_(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+	glBindBufferRange(target, index, buffer, offset, size);
+	if (!capture.active) return;
+	capture.op(BindBufferRange);
+	capture.u32(target);
+	capture.u32(index);
+	capture.u32(buffer);
+	capture.u64(uint64_t(offset));
+	capture.u64(uint64_t(size));
+}
+
+void APIENTRY GLTrace::BindFramebuffer_(GLenum target, GLuint framebuffer) {
+	glBindFramebuffer(target, framebuffer);
+	if (!capture.active) return;
+	capture.op(BindFramebuffer);
+	capture.u32(target);
+	capture.u32(framebuffer);
+}
+
+void APIENTRY GLTrace::BindRenderbuffer_(GLenum target, GLuint renderbuffer) {
+	glBindRenderbuffer(target, renderbuffer);
+	if (!capture.active) return;
+	capture.op(BindRenderbuffer);
+	capture.u32(target);
+	capture.u32(renderbuffer);
+}
+
+void APIENTRY GLTrace::BindTexture_(GLenum target, GLuint texture) {
+	glBindTexture(target, texture);
+	if (!capture.active) return;
+	capture.op(BindTexture);
+	capture.u32(target);
+	capture.u32(texture);
+}
+
+void APIENTRY GLTrace::BindVertexArray_(GLuint array) {
+	glBindVertexArray(array);
+	if (!capture.active) return;
+	capture.op(BindVertexArray);
+	capture.u32(array);
+}
+
+void APIENTRY GLTrace::BlendFunc_(GLenum sfactor, GLenum dfactor) {
+	glBlendFunc(sfactor, dfactor);
+	if (!capture.active) return;
+	capture.op(BlendFunc);
+	capture.u32(sfactor);
+	capture.u32(dfactor);
+}
+
+void APIENTRY GLTrace::BufferData_(GLenum target, GLsizeiptr size, void const *data, GLenum usage) {
+	glBufferData(target, size, data, usage);
+	if (!capture.active) return;
+	capture.op(BufferData);
+	capture.u32(target);
+	capture.u64(uint64_t(size));
+	capture.u32(usage);
+	//(no data is recorded as an empty blob)
+	capture.blob(data, (data ? size_t(size) : 0));
+}
+
+void APIENTRY GLTrace::BufferSubData_(GLenum target, GLintptr offset, GLsizeiptr size, void const *data) {
+	glBufferSubData(target, offset, size, data);
+	if (!capture.active) return;
+	capture.op(BufferSubData);
+	capture.u32(target);
+	capture.u64(uint64_t(offset));
+	capture.blob(data, size_t(size));
+}
+
+void APIENTRY GLTrace::Clear_(GLbitfield mask) {
+	glClear(mask);
+	if (!capture.active) return;
+	capture.op(Clear);
+	capture.u32(mask);
+}
+
+void APIENTRY GLTrace::ClearColor_(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+	glClearColor(red, green, blue, alpha);
+	if (!capture.active) return;
+	capture.op(ClearColor);
+	capture.f32(red);
+	capture.f32(green);
+	capture.f32(blue);
+	capture.f32(alpha);
+}
+
+GLenum APIENTRY GLTrace::ClientWaitSync_(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+	GLenum ret = glClientWaitSync(sync, flags, timeout);
+	if (!capture.active) return ret;
+	capture.op(ClientWaitSync);
+	capture.u64(uint64_t(reinterpret_cast< uintptr_t >(sync)));
+	capture.u32(flags);
+	capture.u64(timeout);
+	return ret;
+}
+
+void APIENTRY GLTrace::CompileShader_(GLuint shader) {
+	glCompileShader(shader);
+	if (!capture.active) return;
+	capture.op(CompileShader);
+	capture.u32(shader);
+}
+
+GLuint APIENTRY GLTrace::CreateProgram_() {
+	GLuint ret = glCreateProgram();
+	if (!capture.active) return ret;
+	capture.op(CreateProgram);
+	capture.u32(ret);
+	return ret;
+}
+
+GLuint APIENTRY GLTrace::CreateShader_(GLenum type) {
+	GLuint ret = glCreateShader(type);
+	if (!capture.active) return ret;
+	capture.op(CreateShader);
+	capture.u32(type);
+	capture.u32(ret);
+	return ret;
+}
+
+void APIENTRY GLTrace::DeleteBuffers_(GLsizei n, GLuint const *buffers) {
+	glDeleteBuffers(n, buffers);
+	if (!capture.active) return;
+	capture.op(DeleteBuffers);
+	capture.blob(buffers, n * sizeof(GLuint));
+}
+
+void APIENTRY GLTrace::DeleteFramebuffers_(GLsizei n, GLuint const *framebuffers) {
+	glDeleteFramebuffers(n, framebuffers);
+	if (!capture.active) return;
+	capture.op(DeleteFramebuffers);
+	capture.blob(framebuffers, n * sizeof(GLuint));
+}
+
+void APIENTRY GLTrace::DeleteProgram_(GLuint program) {
+	glDeleteProgram(program);
+	if (!capture.active) return;
+	capture.op(DeleteProgram);
+	capture.u32(program);
+}
+
+void APIENTRY GLTrace::DeleteRenderbuffers_(GLsizei n, GLuint const *renderbuffers) {
+	glDeleteRenderbuffers(n, renderbuffers);
+	if (!capture.active) return;
+	capture.op(DeleteRenderbuffers);
+	capture.blob(renderbuffers, n * sizeof(GLuint));
+}
+
+void APIENTRY GLTrace::DeleteShader_(GLuint shader) {
+	glDeleteShader(shader);
+	if (!capture.active) return;
+	capture.op(DeleteShader);
+	capture.u32(shader);
+}
+
+void APIENTRY GLTrace::DeleteSync_(GLsync sync) {
+	glDeleteSync(sync);
+	if (!capture.active) return;
+	capture.op(DeleteSync);
+	capture.u64(uint64_t(reinterpret_cast< uintptr_t >(sync)));
+}
+
+void APIENTRY GLTrace::DeleteTextures_(GLsizei n, GLuint const *textures) {
+	glDeleteTextures(n, textures);
+	if (!capture.active) return;
+	capture.op(DeleteTextures);
+	capture.blob(textures, n * sizeof(GLuint));
+}
+
+void APIENTRY GLTrace::DeleteVertexArrays_(GLsizei n, GLuint const *arrays) {
+	glDeleteVertexArrays(n, arrays);
+	if (!capture.active) return;
+	capture.op(DeleteVertexArrays);
+	capture.blob(arrays, n * sizeof(GLuint));
+}
+
+void APIENTRY GLTrace::Disable_(GLenum cap) {
+	glDisable(cap);
+	if (!capture.active) return;
+	capture.op(Disable);
+	capture.u32(cap);
+}
+
+void APIENTRY GLTrace::DrawArraysInstanced_(GLenum mode, GLint first, GLsizei count, GLsizei instancecount) {
+	glDrawArraysInstanced(mode, first, count, instancecount);
+	if (!capture.active) return;
+	capture.op(DrawArraysInstanced);
+	capture.u32(mode);
+	capture.u32(uint32_t(first));
+	capture.u32(uint32_t(count));
+	capture.u32(uint32_t(instancecount));
+}
+
+void APIENTRY GLTrace::Enable_(GLenum cap) {
+	glEnable(cap);
+	if (!capture.active) return;
+	capture.op(Enable);
+	capture.u32(cap);
+}
+
+void APIENTRY GLTrace::EnableVertexAttribArray_(GLuint index) {
+	glEnableVertexAttribArray(index);
+	if (!capture.active) return;
+	capture.op(EnableVertexAttribArray);
+	capture.u32(index);
+}
+
+GLsync APIENTRY GLTrace::FenceSync_(GLenum condition, GLbitfield flags) {
+	GLsync ret = glFenceSync(condition, flags);
+	if (!capture.active) return ret;
+	capture.op(FenceSync);
+	capture.u32(condition);
+	capture.u32(flags);
+	capture.u64(uint64_t(reinterpret_cast< uintptr_t >(ret)));
+	return ret;
+}
+
+void APIENTRY GLTrace::FramebufferRenderbuffer_(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer) {
+	glFramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
+	if (!capture.active) return;
+	capture.op(FramebufferRenderbuffer);
+	capture.u32(target);
+	capture.u32(attachment);
+	capture.u32(renderbuffertarget);
+	capture.u32(renderbuffer);
+}
+
+void APIENTRY GLTrace::GenBuffers_(GLsizei n, GLuint *buffers) {
+	glGenBuffers(n, buffers);
+	if (!capture.active) return;
+	capture.op(GenBuffers);
+	capture.blob(buffers, n * sizeof(GLuint));
+}
+
+void APIENTRY GLTrace::GenFramebuffers_(GLsizei n, GLuint *framebuffers) {
+	glGenFramebuffers(n, framebuffers);
+	if (!capture.active) return;
+	capture.op(GenFramebuffers);
+	capture.blob(framebuffers, n * sizeof(GLuint));
+}
+
+void APIENTRY GLTrace::GenRenderbuffers_(GLsizei n, GLuint *renderbuffers) {
+	glGenRenderbuffers(n, renderbuffers);
+	if (!capture.active) return;
+	capture.op(GenRenderbuffers);
+	capture.blob(renderbuffers, n * sizeof(GLuint));
+}
+
+void APIENTRY GLTrace::GenTextures_(GLsizei n, GLuint *textures) {
+	glGenTextures(n, textures);
+	if (!capture.active) return;
+	capture.op(GenTextures);
+	capture.blob(textures, n * sizeof(GLuint));
+}
+
+void APIENTRY GLTrace::GenVertexArrays_(GLsizei n, GLuint *arrays) {
+	glGenVertexArrays(n, arrays);
+	if (!capture.active) return;
+	capture.op(GenVertexArrays);
+	capture.blob(arrays, n * sizeof(GLuint));
+}
+
+GLint APIENTRY GLTrace::GetAttribLocation_(GLuint program, GLchar const *name) {
+	GLint ret = glGetAttribLocation(program, name);
+	if (!capture.active) return ret;
+	capture.op(GetAttribLocation);
+	capture.u32(program);
+	capture.blob(name, std::strlen(name));
+	capture.u32(uint32_t(ret));
+	return ret;
+}
+
+GLuint APIENTRY GLTrace::GetUniformBlockIndex_(GLuint program, GLchar const *name) {
+	GLuint ret = glGetUniformBlockIndex(program, name);
+	if (!capture.active) return ret;
+	capture.op(GetUniformBlockIndex);
+	capture.u32(program);
+	capture.blob(name, std::strlen(name));
+	capture.u32(ret);
+	return ret;
+}
+
+GLint APIENTRY GLTrace::GetUniformLocation_(GLuint program, GLchar const *name) {
+	GLint ret = glGetUniformLocation(program, name);
+	if (!capture.active) return ret;
+	capture.op(GetUniformLocation);
+	capture.u32(program);
+	capture.blob(name, std::strlen(name));
+	capture.u32(uint32_t(ret));
+	return ret;
+}
+
+void APIENTRY GLTrace::LinkProgram_(GLuint program) {
+	glLinkProgram(program);
+	if (!capture.active) return;
+	capture.op(LinkProgram);
+	capture.u32(program);
+}
+
+void *APIENTRY GLTrace::MapBufferRange_(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+	void *ret = glMapBufferRange(target, offset, length, access);
+	if (!capture.active || !ret || !(access & GL_MAP_WRITE_BIT)) return ret;
+	//nothing is recorded until unmap, when the written bytes are known:
+	Capture::Mapping &mapping = capture.mappings[target];
+	mapping.pointer = ret;
+	mapping.offset = offset;
+	mapping.length = length;
+	mapping.access = access;
+	return ret;
+}
+
+void APIENTRY GLTrace::PixelStorei_(GLenum pname, GLint param) {
+	glPixelStorei(pname, param);
+	if (!capture.active) return;
+	capture.op(PixelStorei);
+	capture.u32(pname);
+	capture.u32(uint32_t(param));
+}
+
+void APIENTRY GLTrace::ReadBuffer_(GLenum src) {
+	glReadBuffer(src);
+	if (!capture.active) return;
+	capture.op(ReadBuffer);
+	capture.u32(src);
+}
+
+void APIENTRY GLTrace::ReadPixels_(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void *pixels) {
+	glReadPixels(x, y, width, height, format, type, pixels);
+	if (!capture.active) return;
+	GLint pack_buffer = 0;
+	glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &pack_buffer);
+	capture.op(ReadPixels);
+	capture.u32(uint32_t(x));
+	capture.u32(uint32_t(y));
+	capture.u32(uint32_t(width));
+	capture.u32(uint32_t(height));
+	capture.u32(format);
+	capture.u32(type);
+	//offset into the pack buffer, if one is bound (client memory is replaced by the replayer's own):
+	capture.u32(pack_buffer != 0);
+	capture.u64(pack_buffer != 0 ? uint64_t(reinterpret_cast< uintptr_t >(pixels)) : 0);
+}
+
+void APIENTRY GLTrace::RenderbufferStorage_(GLenum target, GLenum internalformat, GLsizei width, GLsizei height) {
+	glRenderbufferStorage(target, internalformat, width, height);
+	if (!capture.active) return;
+	capture.op(RenderbufferStorage);
+	capture.u32(target);
+	capture.u32(internalformat);
+	capture.u32(uint32_t(width));
+	capture.u32(uint32_t(height));
+}
+
+void APIENTRY GLTrace::ShaderSource_(GLuint shader, GLsizei count, GLchar const *const *string, GLint const *length) {
+	glShaderSource(shader, count, string, length);
+	if (!capture.active) return;
+	//recorded as one concatenated string:
+	std::string source;
+	for (GLsizei i = 0; i < count; ++i) {
+		if (length && length[i] >= 0) source.append(string[i], length[i]);
+		else source.append(string[i]);
+	}
+	capture.op(ShaderSource);
+	capture.u32(shader);
+	capture.blob(source.data(), source.size());
+}
+
+void APIENTRY GLTrace::TexBuffer_(GLenum target, GLenum internalformat, GLuint buffer) {
+	glTexBuffer(target, internalformat, buffer);
+	if (!capture.active) return;
+	capture.op(TexBuffer);
+	capture.u32(target);
+	capture.u32(internalformat);
+	capture.u32(buffer);
+}
+
+void APIENTRY GLTrace::TexImage2D_(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, void const *pixels) {
+	glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+	if (!capture.active) return;
+	capture.op(TexImage2D);
+	capture.u32(target);
+	capture.u32(uint32_t(level));
+	capture.u32(uint32_t(internalformat));
+	capture.u32(uint32_t(width));
+	capture.u32(uint32_t(height));
+	capture.u32(format);
+	capture.u32(type);
+	//(assumes the default unpack state and no bound GL_PIXEL_UNPACK_BUFFER)
+	bool recorded = (pixels && format == GL_RGBA && type == GL_UNSIGNED_BYTE);
+	capture.blob(pixels, (recorded ? size_t(width) * size_t(height) * 4 : 0));
+}
+
+void APIENTRY GLTrace::TexParameteri_(GLenum target, GLenum pname, GLint param) {
+	glTexParameteri(target, pname, param);
+	if (!capture.active) return;
+	capture.op(TexParameteri);
+	capture.u32(target);
+	capture.u32(pname);
+	capture.u32(uint32_t(param));
+}
+
+void APIENTRY GLTrace::Uniform1i_(GLint location, GLint v0) {
+	glUniform1i(location, v0);
+	if (!capture.active) return;
+	capture.op(Uniform1i);
+	capture.u32(uint32_t(location));
+	capture.u32(uint32_t(v0));
+}
+
+void APIENTRY GLTrace::Uniform2fv_(GLint location, GLsizei count, GLfloat const *value) {
+	glUniform2fv(location, count, value);
+	if (!capture.active) return;
+	capture.op(Uniform2fv);
+	capture.u32(uint32_t(location));
+	capture.blob(value, count * 2 * sizeof(GLfloat));
+}
+
+void APIENTRY GLTrace::Uniform3ui_(GLint location, GLuint v0, GLuint v1, GLuint v2) {
+	glUniform3ui(location, v0, v1, v2);
+	if (!capture.active) return;
+	capture.op(Uniform3ui);
+	capture.u32(uint32_t(location));
+	capture.u32(v0);
+	capture.u32(v1);
+	capture.u32(v2);
+}
+
+void APIENTRY GLTrace::UniformBlockBinding_(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding) {
+	glUniformBlockBinding(program, uniformBlockIndex, uniformBlockBinding);
+	if (!capture.active) return;
+	capture.op(UniformBlockBinding);
+	capture.u32(program);
+	capture.u32(uniformBlockIndex);
+	capture.u32(uniformBlockBinding);
+}
+
+void APIENTRY GLTrace::UniformMatrix3fv_(GLint location, GLsizei count, GLboolean transpose, GLfloat const *value) {
+	glUniformMatrix3fv(location, count, transpose, value);
+	if (!capture.active) return;
+	capture.op(UniformMatrix3fv);
+	capture.u32(uint32_t(location));
+	capture.u32(transpose);
+	capture.blob(value, count * 9 * sizeof(GLfloat));
+}
+
+void APIENTRY GLTrace::UniformMatrix4fv_(GLint location, GLsizei count, GLboolean transpose, GLfloat const *value) {
+	glUniformMatrix4fv(location, count, transpose, value);
+	if (!capture.active) return;
+	capture.op(UniformMatrix4fv);
+	capture.u32(uint32_t(location));
+	capture.u32(transpose);
+	capture.blob(value, count * 16 * sizeof(GLfloat));
+}
+
+GLboolean APIENTRY GLTrace::UnmapBuffer_(GLenum target) {
+	if (capture.active) {
+		auto f = capture.mappings.find(target);
+		if (f != capture.mappings.end()) {
+			//the replayer maps the same range with the same access and copies these bytes in:
+			Capture::Mapping const &mapping = f->second;
+			capture.op(MappedWrite);
+			capture.u32(target);
+			capture.u64(uint64_t(mapping.offset));
+			capture.u32(mapping.access);
+			capture.blob(mapping.pointer, size_t(mapping.length));
+			capture.mappings.erase(f);
+		}
+	}
+	return glUnmapBuffer(target);
+}
+
+void APIENTRY GLTrace::UseProgram_(GLuint program) {
+	glUseProgram(program);
+	if (!capture.active) return;
+	capture.op(UseProgram);
+	capture.u32(program);
+}
+
+void APIENTRY GLTrace::VertexAttribDivisor_(GLuint index, GLuint divisor) {
+	glVertexAttribDivisor(index, divisor);
+	if (!capture.active) return;
+	capture.op(VertexAttribDivisor);
+	capture.u32(index);
+	capture.u32(divisor);
+}
+
+void APIENTRY GLTrace::VertexAttribPointer_(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, void const *pointer) {
+	glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+	if (!capture.active) return;
+	capture.op(VertexAttribPointer);
+	capture.u32(index);
+	capture.u32(uint32_t(size));
+	capture.u32(type);
+	capture.u32(normalized);
+	capture.u32(uint32_t(stride));
+	capture.u64(uint64_t(reinterpret_cast< uintptr_t >(pointer)));
+}
+
+void APIENTRY GLTrace::Viewport_(GLint x, GLint y, GLsizei width, GLsizei height) {
+	glViewport(x, y, width, height);
+	if (!capture.active) return;
+	capture.op(Viewport);
+	capture.u32(uint32_t(x));
+	capture.u32(uint32_t(y));
+	capture.u32(uint32_t(width));
+	capture.u32(uint32_t(height));
+}
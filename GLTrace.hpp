@@ -0,0 +1,183 @@
+#pragma once
+
+//"GLTrace" records the GL calls a program makes into a compact binary trace, for replay by gl-replay.
+// GL.hpp includes this header, and (unless GL_TRACE_NO_REDIRECT is defined) the macros at the
+// bottom route the calls listed there through GLTrace's wrappers. The wrappers make the real call,
+// then append it to the trace if one is being captured; otherwise the cost is a single branch.
+//
+//Only calls that change GL state are recorded. Queries (glGet*, info logs) are passed through
+// untouched, except those whose results later calls depend on (locations, indices).
+// Calls not listed below are neither redirected nor recorded; of those the game makes, that's
+// queries only (glGet*, glCheckFramebufferStatus) plus glFinish, which changes no state.
+//Texture uploads are recorded with their pixels only for tightly-packed GL_RGBA / GL_UNSIGNED_BYTE data
+// from client memory (what Textures uploads); anything else is recorded without data.
+//Pixel reads are recorded without the pixels read; the replayer reads into the same pack buffer
+// offset or, for reads into client memory, into scratch memory of its own.
+//Mapped buffer writes are recorded at unmap time by reading back the whole mapped range, which can
+// be slow for write-only mappings -- fine for capture, but a trace's frame timings shouldn't be trusted.
+//
+//Trace format (native byte order):
+// "gltr" magic, uint32_t version, then records of: uint16_t op, followed by the op's arguments.
+// Enums, names, and integers are stored as uint32_t; sizes/offsets/pointers as uint64_t; floats as float;
+// data (buffer contents, uniform values, source, names) as uint32_t byte count + bytes.
+// Names GL hands back (buffers, shaders, locations, syncs, ...) are recorded as returned,
+// and the replayer maps them to the names its own context hands back.
+
+#include "GL.hpp"
+
+#include <string>
+#include <cstdint>
+
+struct GLTrace {
+	enum Op : uint16_t {
+		FrameEnd = 0,
+		ActiveTexture, AttachShader, BindBuffer, BindBufferRange, BindFramebuffer, BindRenderbuffer, BindTexture, BindVertexArray,
+		BlendFunc, BufferData, BufferSubData, Clear, ClearColor, ClientWaitSync, CompileShader,
+		CreateProgram, CreateShader, DeleteBuffers, DeleteFramebuffers, DeleteProgram, DeleteRenderbuffers, DeleteShader,
+		DeleteSync, DeleteTextures, DeleteVertexArrays, Disable, DrawArraysInstanced, Enable, EnableVertexAttribArray,
+		FenceSync, FramebufferRenderbuffer, GenBuffers, GenFramebuffers, GenRenderbuffers,
+		GenTextures, GenVertexArrays, GetAttribLocation, GetUniformBlockIndex, GetUniformLocation,
+		LinkProgram, MappedWrite, PixelStorei, ReadBuffer, ReadPixels, RenderbufferStorage,
+		ShaderSource, TexBuffer, TexImage2D, TexParameteri, Uniform1i, Uniform2fv, Uniform3ui,
+		UniformBlockBinding, UniformMatrix3fv, UniformMatrix4fv, UseProgram, VertexAttribDivisor,
+		VertexAttribPointer, Viewport,
+		OpCount
+	};
+	static char const *op_name(uint16_t op);
+
+	enum : uint32_t { Version = 3 };
+
+	//start capturing into 'filename' for 'frames' frames (must be called before any GL calls, so
+	// the trace includes the creation of everything later frames use):
+	// note: will throw if the file can't be opened.
+	static void start(std::string const &filename, uint32_t frames);
+	//mark the end of a frame (call after swapping); stops capturing after the requested number of frames:
+	static void frame();
+	//true while capturing:
+	static bool capturing();
+
+	//wrappers (see macros below):
+	static void APIENTRY ActiveTexture_(GLenum texture);
+	static void APIENTRY AttachShader_(GLuint program, GLuint shader);
+	static void APIENTRY BindBuffer_(GLenum target, GLuint buffer);
+	static void APIENTRY BindBufferRange_(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+	static void APIENTRY BindFramebuffer_(GLenum target, GLuint framebuffer);
+	static void APIENTRY BindRenderbuffer_(GLenum target, GLuint renderbuffer);
+	static void APIENTRY BindTexture_(GLenum target, GLuint texture);
+	static void APIENTRY BindVertexArray_(GLuint array);
+	static void APIENTRY BlendFunc_(GLenum sfactor, GLenum dfactor);
+	static void APIENTRY BufferData_(GLenum target, GLsizeiptr size, void const *data, GLenum usage);
+	static void APIENTRY BufferSubData_(GLenum target, GLintptr offset, GLsizeiptr size, void const *data);
+	static void APIENTRY Clear_(GLbitfield mask);
+	static void APIENTRY ClearColor_(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+	static GLenum APIENTRY ClientWaitSync_(GLsync sync, GLbitfield flags, GLuint64 timeout);
+	static void APIENTRY CompileShader_(GLuint shader);
+	static GLuint APIENTRY CreateProgram_();
+	static GLuint APIENTRY CreateShader_(GLenum type);
+	static void APIENTRY DeleteBuffers_(GLsizei n, GLuint const *buffers);
+	static void APIENTRY DeleteFramebuffers_(GLsizei n, GLuint const *framebuffers);
+	static void APIENTRY DeleteProgram_(GLuint program);
+	static void APIENTRY DeleteRenderbuffers_(GLsizei n, GLuint const *renderbuffers);
+	static void APIENTRY DeleteShader_(GLuint shader);
+	static void APIENTRY DeleteSync_(GLsync sync);
+	static void APIENTRY DeleteTextures_(GLsizei n, GLuint const *textures);
+	static void APIENTRY DeleteVertexArrays_(GLsizei n, GLuint const *arrays);
+	static void APIENTRY Disable_(GLenum cap);
+	static void APIENTRY DrawArraysInstanced_(GLenum mode, GLint first, GLsizei count, GLsizei instancecount);
+	static void APIENTRY Enable_(GLenum cap);
+	static void APIENTRY EnableVertexAttribArray_(GLuint index);
+	static GLsync APIENTRY FenceSync_(GLenum condition, GLbitfield flags);
+	static void APIENTRY FramebufferRenderbuffer_(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer);
+	static void APIENTRY GenBuffers_(GLsizei n, GLuint *buffers);
+	static void APIENTRY GenFramebuffers_(GLsizei n, GLuint *framebuffers);
+	static void APIENTRY GenRenderbuffers_(GLsizei n, GLuint *renderbuffers);
+	static void APIENTRY GenTextures_(GLsizei n, GLuint *textures);
+	static void APIENTRY GenVertexArrays_(GLsizei n, GLuint *arrays);
+	static GLint APIENTRY GetAttribLocation_(GLuint program, GLchar const *name);
+	static GLuint APIENTRY GetUniformBlockIndex_(GLuint program, GLchar const *name);
+	static GLint APIENTRY GetUniformLocation_(GLuint program, GLchar const *name);
+	static void APIENTRY LinkProgram_(GLuint program);
+	static void *APIENTRY MapBufferRange_(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+	static void APIENTRY PixelStorei_(GLenum pname, GLint param);
+	static void APIENTRY ReadBuffer_(GLenum src);
+	static void APIENTRY ReadPixels_(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void *pixels);
+	static void APIENTRY RenderbufferStorage_(GLenum target, GLenum internalformat, GLsizei width, GLsizei height);
+	static void APIENTRY ShaderSource_(GLuint shader, GLsizei count, GLchar const *const *string, GLint const *length);
+	static void APIENTRY TexBuffer_(GLenum target, GLenum internalformat, GLuint buffer);
+	static void APIENTRY TexImage2D_(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, void const *pixels);
+	static void APIENTRY TexParameteri_(GLenum target, GLenum pname, GLint param);
+	static void APIENTRY Uniform1i_(GLint location, GLint v0);
+	static void APIENTRY Uniform2fv_(GLint location, GLsizei count, GLfloat const *value);
+	static void APIENTRY Uniform3ui_(GLint location, GLuint v0, GLuint v1, GLuint v2);
+	static void APIENTRY UniformBlockBinding_(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding);
+	static void APIENTRY UniformMatrix3fv_(GLint location, GLsizei count, GLboolean transpose, GLfloat const *value);
+	static void APIENTRY UniformMatrix4fv_(GLint location, GLsizei count, GLboolean transpose, GLfloat const *value);
+	static GLboolean APIENTRY UnmapBuffer_(GLenum target);
+	static void APIENTRY UseProgram_(GLuint program);
+	static void APIENTRY VertexAttribDivisor_(GLuint index, GLuint divisor);
+	static void APIENTRY VertexAttribPointer_(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, void const *pointer);
+	static void APIENTRY Viewport_(GLint x, GLint y, GLsizei width, GLsizei height);
+};
+
+#ifndef GL_TRACE_NO_REDIRECT
+#define glActiveTexture GLTrace::ActiveTexture_
+#define glAttachShader GLTrace::AttachShader_
+#define glBindBuffer GLTrace::BindBuffer_
+#define glBindBufferRange GLTrace::BindBufferRange_
+#define glBindFramebuffer GLTrace::BindFramebuffer_
+#define glBindRenderbuffer GLTrace::BindRenderbuffer_
+#define glBindTexture GLTrace::BindTexture_
+#define glBindVertexArray GLTrace::BindVertexArray_
+#define glBlendFunc GLTrace::BlendFunc_
+#define glBufferData GLTrace::BufferData_
+#define glBufferSubData GLTrace::BufferSubData_
+#define glClear GLTrace::Clear_
+#define glClearColor GLTrace::ClearColor_
+#define glClientWaitSync GLTrace::ClientWaitSync_
+#define glCompileShader GLTrace::CompileShader_
+#define glCreateProgram GLTrace::CreateProgram_
+#define glCreateShader GLTrace::CreateShader_
+#define glDeleteBuffers GLTrace::DeleteBuffers_
+#define glDeleteFramebuffers GLTrace::DeleteFramebuffers_
+#define glDeleteProgram GLTrace::DeleteProgram_
+#define glDeleteRenderbuffers GLTrace::DeleteRenderbuffers_
+#define glDeleteShader GLTrace::DeleteShader_
+#define glDeleteSync GLTrace::DeleteSync_
+#define glDeleteTextures GLTrace::DeleteTextures_
+#define glDeleteVertexArrays GLTrace::DeleteVertexArrays_
+#define glDisable GLTrace::Disable_
+#define glDrawArraysInstanced GLTrace::DrawArraysInstanced_
+#define glEnable GLTrace::Enable_
+#define glEnableVertexAttribArray GLTrace::EnableVertexAttribArray_
+#define glFenceSync GLTrace::FenceSync_
+#define glFramebufferRenderbuffer GLTrace::FramebufferRenderbuffer_
+#define glGenBuffers GLTrace::GenBuffers_
+#define glGenFramebuffers GLTrace::GenFramebuffers_
+#define glGenRenderbuffers GLTrace::GenRenderbuffers_
+#define glGenTextures GLTrace::GenTextures_
+#define glGenVertexArrays GLTrace::GenVertexArrays_
+#define glGetAttribLocation GLTrace::GetAttribLocation_
+#define glGetUniformBlockIndex GLTrace::GetUniformBlockIndex_
+#define glGetUniformLocation GLTrace::GetUniformLocation_
+#define glLinkProgram GLTrace::LinkProgram_
+#define glMapBufferRange GLTrace::MapBufferRange_
+#define glPixelStorei GLTrace::PixelStorei_
+#define glReadBuffer GLTrace::ReadBuffer_
+#define glReadPixels GLTrace::ReadPixels_
+#define glRenderbufferStorage GLTrace::RenderbufferStorage_
+#define glShaderSource GLTrace::ShaderSource_
+#define glTexBuffer GLTrace::TexBuffer_
+#define glTexImage2D GLTrace::TexImage2D_
+#define glTexParameteri GLTrace::TexParameteri_
+#define glUniform1i GLTrace::Uniform1i_
+#define glUniform2fv GLTrace::Uniform2fv_
+#define glUniform3ui GLTrace::Uniform3ui_
+#define glUniformBlockBinding GLTrace::UniformBlockBinding_
+#define glUniformMatrix3fv GLTrace::UniformMatrix3fv_
+#define glUniformMatrix4fv GLTrace::UniformMatrix4fv_
+#define glUnmapBuffer GLTrace::UnmapBuffer_
+#define glUseProgram GLTrace::UseProgram_
+#define glVertexAttribDivisor GLTrace::VertexAttribDivisor_
+#define glVertexAttribPointer GLTrace::VertexAttribPointer_
+#define glViewport GLTrace::Viewport_
+#endif
@@ -0,0 +1,130 @@
+#include "HeadlessContext.hpp"
+#include "GL.hpp"
+
+#include <stdexcept>
+
+#if defined(__linux__)
+#define HEADLESS_USE_EGL 1
+//(keep X11's macros out of the way)
+#define EGL_NO_X11 1
+#define MESA_EGL_NO_X11_HEADERS 1
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#else
+#include <SDL.h>
+#endif
+
+#ifdef HEADLESS_USE_EGL
+
+HeadlessContext::HeadlessContext() {
+	//prefer the surfaceless platform, which needs no display server at all:
+	EGLDisplay egl_display = EGL_NO_DISPLAY;
+	auto get_platform_display = reinterpret_cast< PFNEGLGETPLATFORMDISPLAYEXTPROC >(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+	if (get_platform_display) {
+		egl_display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+	if (egl_display == EGL_NO_DISPLAY) {
+		egl_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+	if (egl_display == EGL_NO_DISPLAY) {
+		throw std::runtime_error("Failed to get an EGL display.");
+	}
+	EGLint major = 0, minor = 0;
+	if (!eglInitialize(egl_display, &major, &minor)) {
+		throw std::runtime_error("Failed to initialize EGL.");
+	}
+	display = egl_display;
+
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		eglTerminate(egl_display);
+		throw std::runtime_error("EGL doesn't support desktop OpenGL.");
+	}
+
+	//(no surface will ever be made, but surfaceless configs still advertise pbuffer support)
+	EGLint const config_attributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8,
+		EGL_NONE
+	};
+	EGLConfig config = nullptr;
+	EGLint configs = 0;
+	if (!eglChooseConfig(egl_display, config_attributes, &config, 1, &configs) || configs == 0) {
+		eglTerminate(egl_display);
+		throw std::runtime_error("No suitable EGL config.");
+	}
+
+	EGLint const context_attributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION_KHR, 3,
+		EGL_CONTEXT_MINOR_VERSION_KHR, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+		EGL_NONE
+	};
+	EGLContext egl_context = eglCreateContext(egl_display, config, EGL_NO_CONTEXT, context_attributes);
+	if (egl_context == EGL_NO_CONTEXT) {
+		eglTerminate(egl_display);
+		throw std::runtime_error("Failed to create an OpenGL 3.3 core context with EGL.");
+	}
+	context = egl_context;
+
+	//(needs EGL_KHR_surfaceless_context, which Mesa always has)
+	if (!eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, egl_context)) {
+		eglDestroyContext(egl_display, egl_context);
+		eglTerminate(egl_display);
+		throw std::runtime_error("Failed to make EGL context current without a surface.");
+	}
+
+	renderer = std::string(reinterpret_cast< char const * >(glGetString(GL_RENDERER)))
+		+ " (" + reinterpret_cast< char const * >(glGetString(GL_VERSION)) + ", EGL)";
+}
+
+HeadlessContext::~HeadlessContext() {
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglDestroyContext(display, context);
+	eglTerminate(display);
+}
+
+#else
+
+HeadlessContext::HeadlessContext() {
+	SDL_Init(SDL_INIT_VIDEO);
+
+	SDL_GL_ResetAttributes();
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+
+	SDL_Window *sdl_window = SDL_CreateWindow("headless",
+		SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 64, 64,
+		SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN
+	);
+	if (!sdl_window) {
+		throw std::runtime_error(std::string("Error creating SDL window: ") + SDL_GetError());
+	}
+	SDL_GLContext sdl_context = SDL_GL_CreateContext(sdl_window);
+	if (!sdl_context) {
+		SDL_DestroyWindow(sdl_window);
+		throw std::runtime_error(std::string("Error creating OpenGL context: ") + SDL_GetError());
+	}
+	window = sdl_window;
+	context = sdl_context;
+
+#ifdef _WIN32
+	if (!init_gl_shims()) {
+		throw std::runtime_error("Failed to initialize shims.");
+	}
+#endif
+
+	renderer = std::string(reinterpret_cast< char const * >(glGetString(GL_RENDERER)))
+		+ " (" + reinterpret_cast< char const * >(glGetString(GL_VERSION)) + ", hidden SDL window)";
+}
+
+HeadlessContext::~HeadlessContext() {
+	SDL_GL_DeleteContext(context);
+	SDL_DestroyWindow(reinterpret_cast< SDL_Window * >(window));
+}
+
+#endif
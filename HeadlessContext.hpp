@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+//"HeadlessContext" makes an OpenGL 3.3 core context current without a window, for rendering
+// into framebuffer objects (see Offscreen.hpp) on machines with no display or GPU:
+// on Linux it uses EGL on Mesa's surfaceless platform (falling back to the default EGL display),
+// which works with software rasterizers like llvmpipe;
+// elsewhere it uses a hidden SDL window, whose default framebuffer is simply never shown.
+
+struct HeadlessContext {
+	//note: will throw if no context can be created.
+	HeadlessContext();
+	HeadlessContext(HeadlessContext const &) = delete;
+	~HeadlessContext();
+
+	//GL_RENDERER and GL_VERSION strings, for logs:
+	std::string renderer;
+
+	//internals:
+	void *display = nullptr; //EGLDisplay
+	void *context = nullptr; //EGLContext or SDL_GLContext
+	void *window = nullptr; //SDL_Window (non-EGL only)
+};
@@ -0,0 +1,39 @@
+#include "InstanceBuffer.hpp"
+#include "GLState.hpp"
+#include "StreamingBuffer.hpp"
+
+#include <cstddef>
+
+void InstanceBuffer::upload(std::vector< Instance > const &instances, StreamingBuffer &streaming) {
+	if (instances.empty()) return;
+	offset = streaming.write(&instances[0], instances.size() * sizeof(Instance), sizeof(glm::vec4));
+	buffer = streaming.buffer;
+}
+
+void InstanceBuffer::point(GLuint vao, uint32_t first, GLState &gl) {
+	gl.bind_buffer(GL_ARRAY_BUFFER, buffer);
+	GLbyte const *base = (GLbyte const *)0 + offset + first * sizeof(Instance);
+	for (GLuint c = 0; c < 4; ++c) {
+		glVertexAttribPointer(ModelviewLocation + c, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), base + offsetof(Instance, mv) + c * sizeof(glm::vec4));
+	}
+	for (GLuint c = 0; c < 3; ++c) {
+		glVertexAttribPointer(NormalMatrixLocation + c, 3, GL_FLOAT, GL_FALSE, sizeof(Instance), base + offsetof(Instance, itmv) + c * sizeof(glm::vec3));
+	}
+	glVertexAttribPointer(ColorLocation, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), base + offsetof(Instance, color));
+
+	if (enabled_vaos.insert(vao).second) {
+		GLuint locations[8] = {
+			ModelviewLocation + 0, ModelviewLocation + 1, ModelviewLocation + 2, ModelviewLocation + 3,
+			NormalMatrixLocation + 0, NormalMatrixLocation + 1, NormalMatrixLocation + 2,
+			ColorLocation,
+		};
+		for (GLuint location : locations) {
+			glEnableVertexAttribArray(location);
+			glVertexAttribDivisor(location, 1);
+		}
+	}
+}
+
+void InstanceBuffer::forget(GLuint vao) {
+	enabled_vaos.erase(vao);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <unordered_set>
+#include <cstdint>
+
+struct GLState;
+struct StreamingBuffer;
+
+//"InstanceBuffer" streams per-instance data for glDrawArraysInstanced.
+// Programs that draw instanced read it from fixed attribute locations:
+//   layout(location = 4) in mat4 InstanceMV;   //object to camera (locations 4-7)
+//   layout(location = 8) in mat3 InstanceITMV; //inverse(transpose(mat3(mv))) (locations 8-10)
+//   layout(location = 11) in vec4 InstanceColor; //tint
+//All of a frame's instances are written at once; each draw then points the attributes at its own range.
+
+struct InstanceBuffer {
+	enum : GLuint {
+		ModelviewLocation = 4,
+		NormalMatrixLocation = 8,
+		ColorLocation = 11,
+	};
+
+	struct Instance {
+		glm::mat4 mv;
+		glm::mat3 itmv;
+		glm::vec4 color;
+	};
+	static_assert(sizeof(Instance) == 64 + 36 + 16, "Instance should be packed");
+
+	//write 'instances' into the streaming buffer (replacing the previous upload):
+	void upload(std::vector< Instance > const &instances, StreamingBuffer &streaming);
+
+	//point the instance attributes of 'vao' (which must be bound) at uploaded instances [first, ...):
+	void point(GLuint vao, uint32_t first, GLState &gl);
+	//'vao' was deleted (so its name may come back as a vao without instance attributes):
+	void forget(GLuint vao);
+
+	//internals:
+	GLuint buffer = 0; //buffer + offset of the last upload
+	GLintptr offset = 0;
+	std::unordered_set< GLuint > enabled_vaos; //vaos with instance attributes enabled
+};
@@ -0,0 +1,181 @@
+#include "LightClusters.hpp"
+#include "WorkerPool.hpp"
+#include "GLState.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+LightClusters::LightClusters() {
+	GLuint *buffers[3] = { &lights_buffer, &ranges_buffer, &indices_buffer };
+	GLuint *texs[3] = { &lights_tex, &ranges_tex, &indices_tex };
+	GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+	for (uint32_t i = 0; i < 3; ++i) {
+		glGenBuffers(1, buffers[i]);
+		glBindBuffer(GL_TEXTURE_BUFFER, *buffers[i]);
+		glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+		glGenTextures(1, texs[i]);
+		glBindTexture(GL_TEXTURE_BUFFER, *texs[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, formats[i], *buffers[i]);
+	}
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+LightClusters::~LightClusters() {
+	GLuint texs[3] = { lights_tex, ranges_tex, indices_tex };
+	glDeleteTextures(3, texs);
+	GLuint buffers[3] = { lights_buffer, ranges_buffer, indices_buffer };
+	glDeleteBuffers(3, buffers);
+}
+
+void LightClusters::update(Scene::Snapshot const &scene, glm::uvec2 const &viewport, WorkerPool &workers, GLState &gl) {
+	glm::mat4 const &world_to_camera = scene.camera.world_to_camera;
+
+	//gather camera-space lights, directional first:
+	light_data.clear();
+	for (auto const &light : scene.lights) {
+		if (light.type != Scene::Light::Directional) continue;
+		glm::vec3 to_light = glm::mat3(world_to_camera) * (glm::mat3(light.local_to_world) * glm::vec3(0.0f, 0.0f, 1.0f));
+		LightData data;
+		data.position_range = glm::vec4(glm::normalize(to_light), 0.0f);
+		data.intensity = glm::vec4(light.intensity, 0.0f);
+		light_data.emplace_back(data);
+	}
+	directional_count = uint32_t(light_data.size());
+	for (auto const &light : scene.lights) {
+		if (light.type != Scene::Light::Point) continue;
+		glm::vec4 position = world_to_camera * light.local_to_world * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		LightData data;
+		data.position_range = glm::vec4(glm::vec3(position), light.range);
+		data.intensity = glm::vec4(light.intensity, 0.0f);
+		light_data.emplace_back(data);
+	}
+	point_count = uint32_t(light_data.size()) - directional_count;
+
+	//cluster grid parameters:
+	float near_plane = scene.camera.near_plane;
+	float log_ratio = std::log(std::max(far_plane, 2.0f * near_plane) / near_plane);
+	float tan_y = std::tan(0.5f * scene.camera.fovy);
+	float tan_x = tan_y * scene.camera.aspect;
+	tile_scale = glm::vec2(float(grid.x) / float(viewport.x), float(grid.y) / float(viewport.y));
+	depth_params = glm::vec2(near_plane, float(grid.z) / log_ratio);
+
+	//bin point lights, one depth slice per job:
+	uint32_t tiles = grid.x * grid.y;
+	slices.resize(grid.z);
+	workers.parallel_for(grid.z, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t s = begin; s < end; ++s) {
+			Slice &slice = slices[s];
+			float slice_near = near_plane * std::exp(log_ratio * float(s) / float(grid.z));
+			float slice_far = (s + 1 == grid.z ? std::numeric_limits< float >::infinity()
+				: near_plane * std::exp(log_ratio * float(s + 1) / float(grid.z)));
+
+			//tile rectangle covered by a point light's bounds within this slice:
+			auto tile_span = [](float lo, float hi, float tan_half, uint32_t count, uint32_t *first, uint32_t *last) {
+				lo /= tan_half;
+				hi /= tan_half;
+				if (hi < -1.0f || lo > 1.0f) return false;
+				*first = uint32_t(std::max(0.0f, std::floor((0.5f * lo + 0.5f) * count)));
+				*last = uint32_t(std::min(float(count - 1), std::floor((0.5f * hi + 0.5f) * count)));
+				return true;
+			};
+
+			slice.rects.assign(point_count, glm::uvec4(1, 0, 0, 0));
+			slice.ranges.assign(tiles, glm::uvec2(0));
+			for (uint32_t i = 0; i < point_count; ++i) {
+				glm::vec4 const &pr = light_data[directional_count + i].position_range;
+				float depth = -pr.z;
+				float r = pr.w;
+				if (depth + r < slice_near || depth - r > slice_far) continue;
+				float d0 = std::max(depth - r, slice_near);
+				float d1 = std::min(depth + r, slice_far);
+				//x / d over the box [x-r,x+r] x [d0,d1] is extremal at the corners:
+				glm::vec2 lo = glm::min((glm::vec2(pr.x, pr.y) - r) / d0, (glm::vec2(pr.x, pr.y) - r) / d1);
+				glm::vec2 hi = glm::max((glm::vec2(pr.x, pr.y) + r) / d0, (glm::vec2(pr.x, pr.y) + r) / d1);
+				glm::uvec4 rect;
+				if (!tile_span(lo.x, hi.x, tan_x, grid.x, &rect.x, &rect.z)) continue;
+				if (!tile_span(lo.y, hi.y, tan_y, grid.y, &rect.y, &rect.w)) continue;
+				slice.rects[i] = rect;
+				for (uint32_t y = rect.y; y <= rect.w; ++y) {
+					for (uint32_t x = rect.x; x <= rect.z; ++x) {
+						slice.ranges[y * grid.x + x].y += 1;
+					}
+				}
+			}
+
+			//prefix sum counts into (slice-local) offsets, then fill indices:
+			uint32_t total = 0;
+			for (auto &range : slice.ranges) {
+				range.x = total;
+				total += range.y;
+				range.y = 0;
+			}
+			slice.indices.resize(total);
+			for (uint32_t i = 0; i < point_count; ++i) {
+				glm::uvec4 const &rect = slice.rects[i];
+				if (rect.x > rect.z) continue;
+				for (uint32_t y = rect.y; y <= rect.w; ++y) {
+					for (uint32_t x = rect.x; x <= rect.z; ++x) {
+						glm::uvec2 &range = slice.ranges[y * grid.x + x];
+						slice.indices[range.x + range.y] = directional_count + i;
+						range.y += 1;
+					}
+				}
+			}
+		}
+	});
+
+	//merge slices:
+	range_data.clear();
+	index_data.clear();
+	for (auto const &slice : slices) {
+		uint32_t base = uint32_t(index_data.size());
+		for (auto const &range : slice.ranges) {
+			range_data.emplace_back(base + range.x, range.y);
+		}
+		index_data.insert(index_data.end(), slice.indices.begin(), slice.indices.end());
+	}
+	index_count = uint32_t(index_data.size());
+
+	//upload (texture buffers may not be zero-sized, so pad empty lists):
+	if (light_data.empty()) light_data.emplace_back(LightData());
+	if (index_data.empty()) index_data.emplace_back(0);
+
+	gl.bind_buffer(GL_TEXTURE_BUFFER, lights_buffer);
+	glBufferData(GL_TEXTURE_BUFFER, light_data.size() * sizeof(LightData), &light_data[0], GL_STREAM_DRAW);
+	gl.bind_buffer(GL_TEXTURE_BUFFER, ranges_buffer);
+	glBufferData(GL_TEXTURE_BUFFER, range_data.size() * sizeof(glm::uvec2), &range_data[0], GL_STREAM_DRAW);
+	gl.bind_buffer(GL_TEXTURE_BUFFER, indices_buffer);
+	glBufferData(GL_TEXTURE_BUFFER, index_data.size() * sizeof(uint32_t), &index_data[0], GL_STREAM_DRAW);
+}
+
+void LightClusters::attach(GLuint program, GLState &gl, bool partial) {
+	auto get = [program, partial](char const *name) {
+		GLint location = glGetUniformLocation(program, name);
+		if (location == -1 && !partial) throw std::runtime_error("no uniform named " + std::string(name));
+		return location;
+	};
+	GLint lights = get("cluster_lights");
+	GLint ranges = get("cluster_ranges");
+	GLint indices = get("cluster_indices");
+
+	//samplers always read from the same units (GLState ignores location -1):
+	gl.use_program(program);
+	gl.uniform(lights, GLint(TextureUnit + 0));
+	gl.uniform(ranges, GLint(TextureUnit + 1));
+	gl.uniform(indices, GLint(TextureUnit + 2));
+}
+
+void LightClusters::bind(GLState &gl) const {
+	GLuint texs[3] = { lights_tex, ranges_tex, indices_tex };
+	for (uint32_t i = 0; i < 3; ++i) {
+		gl.bind_texture(TextureUnit + i, GL_TEXTURE_BUFFER, texs[i]);
+	}
+}
+
+void LightClusters::write(FrameUniforms::Block *block) const {
+	block->cluster_grid = glm::uvec4(grid, directional_count);
+	block->cluster_params = glm::vec4(tile_scale, depth_params);
+}
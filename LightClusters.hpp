@@ -0,0 +1,78 @@
+#pragma once
+
+#include "GL.hpp"
+#include "Scene.hpp"
+#include "FrameUniforms.hpp"
+
+#include <glm/glm.hpp>
+#include <vector>
+
+struct WorkerPool;
+struct GLState;
+
+//"LightClusters" bins a scene's point lights into a camera-space cluster grid
+// (screen tiles in x,y; exponentially-spaced depth slices in z) so each fragment
+// only evaluates the lights that can reach it.
+//Results are uploaded as texture buffers:
+// lights: RGBA32F, two texels per light: (position.xyz, range), (intensity.rgb, 0)
+//   -- directional lights come first, with their camera-space direction *to* the light in place of position.
+// ranges: RG32UI, one texel per cluster: (first index, index count)
+// indices: R32UI, light indices for each cluster, packed
+
+struct LightClusters {
+	LightClusters();
+	LightClusters(LightClusters const &) = delete;
+	~LightClusters();
+
+	//grid dimensions:
+	glm::uvec3 grid = glm::uvec3(16, 9, 24);
+	//depth slices span [camera.near_plane, far_plane]; anything further lands in the last slice:
+	float far_plane = 100.0f;
+
+	//bin lights for the scene's current camera and upload the results:
+	void update(Scene::Snapshot const &scene, glm::uvec2 const &viewport, WorkerPool &workers, GLState &gl);
+
+	//point a clustered-lighting program's samplers (cluster_lights, cluster_ranges, cluster_indices) at the units used by 'bind':
+	// note: will throw if the program doesn't use clustered lighting, unless 'partial' is set, in which case
+	//  samplers the program doesn't use (e.g., shader variants without point lights) are skipped.
+	static void attach(GLuint program, GLState &gl, bool partial = false);
+
+	//bind the light buffers to their texture units:
+	void bind(GLState &gl) const;
+
+	//fill in the cluster grid fields of the per-frame uniform block:
+	void write(FrameUniforms::Block *block) const;
+
+	//texture units used for the light buffers (TextureUnit + 0, 1, 2):
+	enum : GLuint { TextureUnit = 4 };
+
+	//counts from the last update:
+	uint32_t directional_count = 0;
+	uint32_t point_count = 0;
+	uint32_t index_count = 0;
+
+	//internals:
+	glm::vec2 tile_scale = glm::vec2(0.0f);
+	glm::vec2 depth_params = glm::vec2(0.0f);
+
+	struct LightData {
+		glm::vec4 position_range;
+		glm::vec4 intensity;
+	};
+	static_assert(sizeof(LightData) == 32, "LightData is packed");
+	std::vector< LightData > light_data;
+	std::vector< glm::uvec2 > range_data;
+	std::vector< uint32_t > index_data;
+
+	//per-slice binning results, merged into range_data/index_data:
+	struct Slice {
+		std::vector< glm::uvec2 > ranges;
+		std::vector< uint32_t > indices;
+		std::vector< glm::uvec4 > rects; //scratch: tile rect (x0,y0,x1,y1) per light, empty if x0 > x1
+	};
+	std::vector< Slice > slices;
+
+	GLuint lights_buffer = 0, lights_tex = 0;
+	GLuint ranges_buffer = 0, ranges_tex = 0;
+	GLuint indices_buffer = 0, indices_tex = 0;
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+//"MappedFile" maps a whole file read-only into memory for the lifetime of the object:
+struct MappedFile {
+	//note: will throw if the file can't be opened or mapped.
+	MappedFile(std::string const &filename);
+	MappedFile(MappedFile const &) = delete;
+	~MappedFile();
+
+	char const *data = nullptr;
+	size_t size = 0;
+
+	//internals:
+#ifdef _WIN32
+	void *file = nullptr;
+	void *mapping = nullptr;
+#endif
+};
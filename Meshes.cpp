@@ -1,5 +1,7 @@
 #include "Meshes.hpp"
 #include "read_chunk.hpp"
+#include "GLState.hpp"
+#include "fnv1a.hpp"
 
 #include <glm/glm.hpp>
 
@@ -7,33 +9,96 @@
 #include <fstream>
 #include <iostream>
 #include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstring>
+
+namespace {
+	struct v3n3 {
+		glm::vec3 v;
+		glm::vec3 n;
+		glm::vec3 c;
+	};
+	static_assert(sizeof(v3n3) == 36, "v3n3 is packed");
+
+	//read vertex data and named mesh ranges (with bounds + hash, but no vao) from a mesh file:
+	void read_meshes(std::string const &filename, std::vector< v3n3 > *data_, std::vector< std::pair< std::string, Mesh > > *entries_) {
+		auto &data = *data_;
+		auto &entries = *entries_;
+		std::ifstream file(filename, std::ios::binary);
 
-void Meshes::load(std::string const &filename, Attributes const &attributes) {
-	std::ifstream file(filename, std::ios::binary);
-
-	GLuint vao = 0;
-	GLuint total = 0;
-	{ //read + upload data chunk:
-		struct v3n3 {
-			glm::vec3 v;
-			glm::vec3 n;
-			glm::vec3 c;
-		};
-		
-		static_assert(sizeof(v3n3) == 36, "v3n3 is packed");
-		std::vector< v3n3 > data;
 		read_chunk(file, "v3n3", &data);
-		//upload data:
-		GLuint buffer = 0;
-		glGenBuffers(1, &buffer);
-		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		GLuint total = data.size(); //store total for later checks on index
+
+		std::vector< char > strings;
+		read_chunk(file, "str0", &strings);
+
+		{ //read index chunk:
+			struct IndexEntry {
+				uint32_t name_begin, name_end;
+				uint32_t vertex_start, vertex_count;
+			};
+			static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
+
+			std::vector< IndexEntry > index;
+			read_chunk(file, "idx0", &index);
+
+			for (auto const &entry : index) {
+				if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
+					throw std::runtime_error("index entry has out-of-range name begin/end");
+				}
+				if (!(entry.vertex_start < entry.vertex_start + entry.vertex_count && entry.vertex_start + entry.vertex_count <= total)) {
+					throw std::runtime_error("index entry has out-of-range vertex start/count");
+				}
+				std::string name(&strings[0] + entry.name_begin, &strings[0] + entry.name_end);
+				Mesh mesh;
+				mesh.start = entry.vertex_start;
+				mesh.count = entry.vertex_count;
+				for (uint32_t v = mesh.start; v < mesh.start + mesh.count; ++v) {
+					mesh.bounds.enclose(data[v].v);
+				}
+				mesh.sphere.center = 0.5f * (mesh.bounds.min + mesh.bounds.max);
+				for (uint32_t v = mesh.start; v < mesh.start + mesh.count; ++v) {
+					mesh.sphere.radius = std::max(mesh.sphere.radius, glm::length(data[v].v - mesh.sphere.center));
+				}
+				mesh.hash = fnv1a(&data[mesh.start], sizeof(v3n3) * mesh.count);
+				entries.emplace_back(name, mesh);
+			}
+		}
+
+		//meshes with identical vertex data share the first copy's range, so they can be drawn instanced:
+		std::unordered_map< uint64_t, uint32_t > first_with_hash;
+		for (uint32_t i = 0; i < entries.size(); ++i) {
+			Mesh &mesh = entries[i].second;
+			auto f = first_with_hash.insert(std::make_pair(mesh.hash, i));
+			if (f.second) continue;
+			Mesh const &first = entries[f.first->second].second;
+			if (first.count == mesh.count
+			 && std::memcmp(&data[first.start], &data[mesh.start], sizeof(v3n3) * mesh.count) == 0) {
+				mesh.start = first.start;
+			}
+		}
+
+		if (file.peek() != EOF) {
+			std::cerr << "WARNING: trailing data in mesh file '" << filename.c_str() << "'" << std::endl;
+		}
+	}
+
+	//upload vertex data into a new buffer and build a vao for it (leaving both bound):
+	void upload(std::vector< v3n3 > const &data, std::string const &filename, Meshes::File *file_) {
+		auto &file = *file_;
+		auto const &attributes = file.attributes;
+
+		glGenBuffers(1, &file.buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, file.buffer);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(v3n3) * data.size(), &data[0], GL_STATIC_DRAW);
 
-		total = data.size(); //store total for later checks on index
-		
+		file.total = data.size();
+
 		//store binding:
-		glGenVertexArrays(1, &vao);
-		glBindVertexArray(vao);
+		glGenVertexArrays(1, &file.vao);
+		glBindVertexArray(file.vao);
 		if (attributes.Position != -1U) {
 			glVertexAttribPointer(attributes.Position, 3, GL_FLOAT, GL_FALSE, sizeof(v3n3), (GLbyte *)0);
 			glEnableVertexAttribArray(attributes.Position);
@@ -54,42 +119,121 @@ void Meshes::load(std::string const &filename, Attributes const &attributes) {
 			std::cerr << "WARNING: loading v3n3 data from '" << filename.c_str() << "', but not using the Color attribute." << std::endl;
 		}
 	}
-	
-	std::vector< char > strings;
-	read_chunk(file, "str0", &strings);
-
-	{ //read index chunk, add to meshes:
-		struct IndexEntry {
-			uint32_t name_begin, name_end;
-			uint32_t vertex_start, vertex_count;
-		};
-		static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
-
-		std::vector< IndexEntry > index;
-		read_chunk(file, "idx0", &index);
-
-		for (auto const &entry : index) {
-			if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
-				throw std::runtime_error("index entry has out-of-range name begin/end");
-			}
-			if (!(entry.vertex_start < entry.vertex_start + entry.vertex_count && entry.vertex_start + entry.vertex_count <= total)) {
-				throw std::runtime_error("index entry has out-of-range vertex start/count");
-			}
-			std::string name(&strings[0] + entry.name_begin, &strings[0] + entry.name_end);
-			Mesh mesh;
-			mesh.vao = vao;
-			mesh.start = entry.vertex_start;
-			mesh.count = entry.vertex_count;
-			bool inserted = meshes.insert(std::make_pair(name, mesh)).second;
-			if (!inserted) {
-				std::cerr << "WARNING: mesh name '" << name.c_str() << "' in filename '" << filename.c_str() << "' collides with existing mesh." << std::endl;
-			}
+}
+
+void Meshes::load(std::string const &filename, Attributes const &attributes) {
+	std::vector< v3n3 > data;
+	std::vector< std::pair< std::string, Mesh > > entries;
+	read_meshes(filename, &data, &entries);
+
+	File &loaded = files[filename];
+	if (loaded.vao != 0) {
+		throw std::runtime_error("Mesh file '" + filename + "' was already loaded; use reload.");
+	}
+	loaded.attributes = attributes;
+
+	upload(data, filename, &loaded);
+
+	//add to meshes:
+	for (auto &entry : entries) {
+		entry.second.vao = loaded.vao;
+		bool inserted = meshes.insert(entry).second;
+		if (!inserted) {
+			std::cerr << "WARNING: mesh name '" << entry.first.c_str() << "' in filename '" << filename.c_str() << "' collides with existing mesh." << std::endl;
 		}
 	}
+}
+
+std::vector< std::string > Meshes::reload(std::string const &filename, GLState &gl) {
+	auto f = files.find(filename);
+	if (f == files.end()) {
+		throw std::runtime_error("Mesh file '" + filename + "' was never loaded.");
+	}
+	File &loaded = f->second;
+
+	std::vector< v3n3 > data;
+	std::vector< std::pair< std::string, Mesh > > entries;
+	read_meshes(filename, &data, &entries);
 
-	if (file.peek() != EOF) {
-		std::cerr << "WARNING: trailing data in mesh file '" << filename.c_str() << "'" << std::endl;
+	//if every mesh kept its place in the buffer, only changed ranges need uploading:
+	bool same_layout = (data.size() == loaded.total);
+	for (auto const &entry : entries) {
+		auto m = meshes.find(entry.first);
+		if (m == meshes.end() || m->second.vao != loaded.vao
+		 || m->second.start != entry.second.start || m->second.count != entry.second.count) {
+			same_layout = false;
+		}
+	}
+
+	GLuint old_vao = loaded.vao;
+	std::vector< std::string > changed;
+	if (same_layout) {
+		gl.bind_buffer(GL_ARRAY_BUFFER, loaded.buffer);
+	} else {
+		//snapshots already handed to the render thread still draw old ranges from the old buffer,
+		// so upload into a new buffer + vao and keep the old ones until those snapshots are done (see 'retire'):
+		Retired old;
+		old.buffer = loaded.buffer;
+		old.vao = loaded.vao;
+		old.generation = ++generation;
+		retired.emplace_back(old);
+		upload(data, filename, &loaded);
+		gl.invalidate(); //(upload binds directly)
+
+		//meshes dropped from the file draw nothing from now on:
+		std::unordered_set< std::string > names;
+		for (auto const &entry : entries) {
+			names.insert(entry.first);
+		}
+		for (auto &kv : meshes) {
+			if (kv.second.vao != old_vao || names.count(kv.first)) continue;
+			kv.second = Mesh();
+			kv.second.vao = loaded.vao;
+			changed.emplace_back(kv.first);
+		}
+	}
+
+	for (auto &entry : entries) {
+		entry.second.vao = loaded.vao;
+		auto m = meshes.find(entry.first);
+		if (m == meshes.end()) {
+			meshes.insert(entry);
+		} else if (m->second.vao != old_vao) {
+			std::cerr << "WARNING: mesh name '" << entry.first.c_str() << "' in filename '" << filename.c_str() << "' collides with existing mesh." << std::endl;
+			continue;
+		} else if (same_layout && m->second.hash == entry.second.hash
+		 && m->second.start == entry.second.start && m->second.count == entry.second.count) {
+			continue; //unchanged
+		} else {
+			m->second = entry.second;
+		}
+		if (same_layout) {
+			glBufferSubData(GL_ARRAY_BUFFER, sizeof(v3n3) * entry.second.start, sizeof(v3n3) * entry.second.count, &data[entry.second.start]);
+		}
+		changed.emplace_back(entry.first);
+	}
+
+	return changed;
+}
+
+std::vector< GLuint > Meshes::retire(uint32_t drawn, GLState &gl) {
+	std::vector< GLuint > deleted;
+	for (auto r = retired.begin(); r != retired.end(); ) {
+		if (r->generation <= drawn) {
+			if (deleted.empty()) {
+				//(deleting bound objects would leave 'gl' remembering stale bindings)
+				gl.bind_vertex_array(0);
+				gl.bind_buffer(GL_ARRAY_BUFFER, 0);
+			}
+			glDeleteVertexArrays(1, &r->vao);
+			glDeleteBuffers(1, &r->buffer);
+			deleted.emplace_back(r->vao);
+			r = retired.erase(r);
+		} else {
+			++r;
+		}
 	}
+	return deleted;
 }
 
 Mesh const &Meshes::get(std::string const &name) const {
@@ -1,13 +1,22 @@
 #pragma once
 
 #include "GL.hpp"
+#include "Bounds.hpp"
 #include <map>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+struct GLState;
 
 //Mesh is a lightweight handle to some OpenGL vertex data:
 struct Mesh {
 	GLuint vao = 0;
 	GLuint start = 0;
 	GLuint count = 0;
+	AABB bounds; //object-space bounds of the vertex positions
+	Sphere sphere; //object-space bounding sphere (centered on 'bounds')
+	uint64_t hash = 0; //hash of the vertex data, to detect changes on reload
 };
 
 //"Meshes" loads a collection of meshes and builds VAOs for 'em
@@ -23,10 +32,37 @@ struct Meshes {
 	// note: will throw if file fails to read.
 	void load(std::string const &filename, Attributes const &attributes);
 
+	//re-read a file passed to 'load', re-uploading only the meshes whose data changed:
+	// returns the names of changed (or new) meshes, whose entries are updated in place.
+	// If any mesh moved or was resized, the whole file goes into a new buffer + vao (and every mesh of the file counts as changed;
+	// meshes no longer in the file are left empty); the old ones are retired as of the new 'generation'.
+	// (buffer bindings go through 'gl', so its remembered state stays correct)
+	// note: will throw if file fails to read.
+	std::vector< std::string > reload(std::string const &filename, GLState &gl);
+
+	//delete buffers + vaos retired as of generation 'drawn' or earlier, once nothing will draw with them again
+	// (i.e., after drawing a snapshot taken with every object re-pointed at generation 'drawn' meshes):
+	// returns the names of the deleted vaos (GL may hand them out again).
+	std::vector< GLuint > retire(uint32_t drawn, GLState &gl);
+	uint32_t generation = 0; //bumped whenever 'reload' retires a buffer
+
 	//look up a particular mesh in the DB:
 	// note: will throw if mesh not found.
 	Mesh const &get(std::string const &name) const;
 
 	//internals:
 	std::map< std::string, Mesh > meshes;
+	struct File {
+		GLuint buffer = 0;
+		GLuint vao = 0;
+		GLuint total = 0; //vertex count
+		Attributes attributes;
+	};
+	std::map< std::string, File > files;
+	struct Retired {
+		GLuint buffer = 0;
+		GLuint vao = 0;
+		uint32_t generation = 0; //'generation' as of retiring
+	};
+	std::vector< Retired > retired;
 };
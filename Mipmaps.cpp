@@ -0,0 +1,234 @@
+#include "Mipmaps.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIPMAPS_USE_SSE2 1
+#endif
+
+uint32_t mip_levels(glm::uvec2 const &size) {
+	uint32_t levels = 1;
+	for (uint32_t largest = std::max(size.x, size.y); largest > 1; largest /= 2) {
+		levels += 1;
+	}
+	return levels;
+}
+
+namespace {
+	//2x2 average, rounded; the last row/column repeats for odd sizes:
+	void downsample_box(uint32_t const *src, glm::uvec2 const &size, uint32_t *dst) {
+		glm::uvec2 out = mip_size(size);
+		for (uint32_t y = 0; y < out.y; ++y) {
+			uint8_t const *row0 = reinterpret_cast< uint8_t const * >(src + size_t(std::min(2 * y, size.y - 1)) * size.x);
+			uint8_t const *row1 = reinterpret_cast< uint8_t const * >(src + size_t(std::min(2 * y + 1, size.y - 1)) * size.x);
+			uint8_t *o = reinterpret_cast< uint8_t * >(dst + size_t(y) * out.x);
+			uint32_t x = 0;
+#ifdef MIPMAPS_USE_SSE2
+			//four source pixels from each row make two output pixels:
+			__m128i zero = _mm_setzero_si128();
+			__m128i two = _mm_set1_epi16(2);
+			for (; 2 * x + 4 <= size.x && x + 2 <= out.x; x += 2) {
+				__m128i a = _mm_loadu_si128(reinterpret_cast< __m128i const * >(row0 + 8 * x));
+				__m128i b = _mm_loadu_si128(reinterpret_cast< __m128i const * >(row1 + 8 * x));
+				__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)); //pixels 0, 1
+				__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)); //pixels 2, 3
+				__m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi)); //0+1, 2+3
+				sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+				_mm_storel_epi64(reinterpret_cast< __m128i * >(o + 4 * x), _mm_packus_epi16(sum, zero));
+			}
+#endif
+			for (; x < out.x; ++x) {
+				uint32_t x0 = 4 * std::min(2 * x, size.x - 1);
+				uint32_t x1 = 4 * std::min(2 * x + 1, size.x - 1);
+				for (uint32_t c = 0; c < 4; ++c) {
+					o[4 * x + c] = uint8_t((uint32_t(row0[x0 + c]) + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+				}
+			}
+		}
+	}
+
+	//Kaiser-windowed sinc, evaluated at the source pixels around each output pixel:
+	struct Taps {
+		uint32_t count = 0; //per output pixel
+		std::vector< int32_t > first; //first source pixel for each output pixel (may be out of range; clamped when used)
+		std::vector< float > weights; //count per output pixel, normalized
+	};
+
+	double bessel_i0(double x) {
+		double sum = 1.0, term = 1.0;
+		for (uint32_t k = 1; k < 32; ++k) {
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+			if (term < 1e-12 * sum) break;
+		}
+		return sum;
+	}
+
+	Taps kaiser_taps(uint32_t from, uint32_t to) {
+		//(width in output pixels, and the window's shape parameter)
+		double const Width = 2.0;
+		double const Alpha = 4.0;
+		double const Pi = 3.14159265358979323846;
+		double scale = double(from) / double(to);
+		double radius = Width * scale; //in source pixels
+
+		Taps taps;
+		taps.count = uint32_t(std::ceil(2.0 * radius)) + 1;
+		taps.first.resize(to);
+		taps.weights.resize(size_t(to) * taps.count);
+		for (uint32_t i = 0; i < to; ++i) {
+			double center = (i + 0.5) * scale;
+			int32_t first = int32_t(std::floor(center - radius));
+			taps.first[i] = first;
+			float *weights = &taps.weights[size_t(i) * taps.count];
+			double total = 0.0;
+			for (uint32_t k = 0; k < taps.count; ++k) {
+				double d = ((first + int32_t(k) + 0.5) - center) / scale;
+				double w = 0.0;
+				if (std::abs(d) < Width) {
+					double sinc = (d == 0.0 ? 1.0 : std::sin(Pi * d) / (Pi * d));
+					double t = d / Width;
+					w = sinc * bessel_i0(Alpha * std::sqrt(1.0 - t * t)) / bessel_i0(Alpha);
+				}
+				weights[k] = float(w);
+				total += w;
+			}
+			for (uint32_t k = 0; k < taps.count; ++k) {
+				weights[k] = float(weights[k] / total);
+			}
+		}
+		return taps;
+	}
+
+	//RGBA8 pixels to four floats each:
+	void to_float(uint32_t const *src, uint32_t count, float *dst) {
+		uint32_t i = 0;
+#ifdef MIPMAPS_USE_SSE2
+		__m128i zero = _mm_setzero_si128();
+		for (; i + 4 <= count; i += 4) {
+			__m128i px = _mm_loadu_si128(reinterpret_cast< __m128i const * >(src + i));
+			__m128i lo = _mm_unpacklo_epi8(px, zero);
+			__m128i hi = _mm_unpackhi_epi8(px, zero);
+			_mm_storeu_ps(dst + 4 * i + 0, _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)));
+			_mm_storeu_ps(dst + 4 * i + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)));
+			_mm_storeu_ps(dst + 4 * i + 8, _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)));
+			_mm_storeu_ps(dst + 4 * i + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)));
+		}
+#endif
+		uint8_t const *bytes = reinterpret_cast< uint8_t const * >(src);
+		for (; i < count; ++i) {
+			for (uint32_t c = 0; c < 4; ++c) dst[4 * i + c] = float(bytes[4 * i + c]);
+		}
+	}
+
+	//and back (rounded and clamped, since the kernel's negative lobes can overshoot):
+	void from_float(float const *src, uint32_t count, uint32_t *dst) {
+		uint32_t i = 0;
+#ifdef MIPMAPS_USE_SSE2
+		for (; i + 2 <= count; i += 2) {
+			__m128i a = _mm_cvtps_epi32(_mm_loadu_ps(src + 4 * i));
+			__m128i b = _mm_cvtps_epi32(_mm_loadu_ps(src + 4 * i + 4));
+			__m128i packed = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_setzero_si128());
+			_mm_storel_epi64(reinterpret_cast< __m128i * >(dst + i), packed);
+		}
+#endif
+		uint8_t *bytes = reinterpret_cast< uint8_t * >(dst);
+		for (; i < count; ++i) {
+			for (uint32_t c = 0; c < 4; ++c) {
+				float v = std::floor(src[4 * i + c] + 0.5f);
+				bytes[4 * i + c] = uint8_t(std::min(255.0f, std::max(0.0f, v)));
+			}
+		}
+	}
+
+	//acc[i] += weight * src[i], for 'count' floats (a multiple of four):
+	void accumulate(float *acc, float const *src, float weight, uint32_t count) {
+		uint32_t i = 0;
+#ifdef MIPMAPS_USE_SSE2
+		__m128 w = _mm_set1_ps(weight);
+		for (; i + 4 <= count; i += 4) {
+			_mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(w, _mm_loadu_ps(src + i))));
+		}
+#endif
+		for (; i < count; ++i) {
+			acc[i] += weight * src[i];
+		}
+	}
+
+	void downsample_kaiser(uint32_t const *src, glm::uvec2 const &size, uint32_t *dst) {
+		glm::uvec2 out = mip_size(size);
+		Taps taps_x = kaiser_taps(size.x, out.x);
+		Taps taps_y = kaiser_taps(size.y, out.y);
+
+		//horizontal pass, every source row into 'wide' (out.x by size.y, four floats per pixel):
+		// (rows are converted into the middle of 'row', with edge pixels repeated on either side, so taps need no clamping)
+		int32_t pad = 0;
+		for (uint32_t x = 0; x < out.x; ++x) {
+			pad = std::max(pad, -taps_x.first[x]);
+			pad = std::max(pad, taps_x.first[x] + int32_t(taps_x.count) - int32_t(size.x));
+		}
+		std::vector< float > wide(size_t(out.x) * size.y * 4);
+		std::vector< float > row((size_t(size.x) + 2 * pad) * 4);
+		for (uint32_t y = 0; y < size.y; ++y) {
+			float *middle = &row[4 * pad];
+			to_float(src + size_t(y) * size.x, size.x, middle);
+			for (int32_t p = 1; p <= pad; ++p) {
+				std::copy(middle, middle + 4, middle - 4 * p);
+				std::copy(middle + 4 * (size.x - 1), middle + 4 * size.x, middle + 4 * (size.x - 1 + p));
+			}
+			float *o = &wide[size_t(y) * out.x * 4];
+			for (uint32_t x = 0; x < out.x; ++x) {
+				float const *weights = &taps_x.weights[size_t(x) * taps_x.count];
+				float const *from = middle + 4 * taps_x.first[x];
+#ifdef MIPMAPS_USE_SSE2
+				__m128 acc = _mm_setzero_ps();
+				for (uint32_t k = 0; k < taps_x.count; ++k) {
+					acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(from + 4 * k)));
+				}
+				_mm_storeu_ps(o + 4 * x, acc);
+#else
+				float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				for (uint32_t k = 0; k < taps_x.count; ++k) {
+					for (uint32_t c = 0; c < 4; ++c) acc[c] += weights[k] * from[4 * k + c];
+				}
+				for (uint32_t c = 0; c < 4; ++c) o[4 * x + c] = acc[c];
+#endif
+			}
+		}
+
+		//vertical pass, whole rows at a time:
+		std::vector< float > acc(size_t(out.x) * 4);
+		for (uint32_t y = 0; y < out.y; ++y) {
+			std::fill(acc.begin(), acc.end(), 0.0f);
+			float const *weights = &taps_y.weights[size_t(y) * taps_y.count];
+			for (uint32_t k = 0; k < taps_y.count; ++k) {
+				if (weights[k] == 0.0f) continue;
+				int32_t i = std::min(std::max(taps_y.first[y] + int32_t(k), 0), int32_t(size.y) - 1);
+				accumulate(acc.data(), &wide[size_t(i) * out.x * 4], weights[k], out.x * 4);
+			}
+			from_float(acc.data(), out.x, dst + size_t(y) * out.x);
+		}
+	}
+}
+
+void downsample(uint32_t const *src, glm::uvec2 const &size, uint32_t *dst, MipFilter filter) {
+	if (filter == KaiserFilter) downsample_kaiser(src, size, dst);
+	else downsample_box(src, size, dst);
+}
+
+std::vector< std::vector< uint32_t > > build_mips(uint32_t const *level0, glm::uvec2 const &size, uint32_t levels, MipFilter filter) {
+	std::vector< std::vector< uint32_t > > mips;
+	if (levels > 1) mips.reserve(levels - 1);
+	uint32_t const *from = level0;
+	glm::uvec2 from_size = size;
+	for (uint32_t level = 1; level < levels; ++level) {
+		glm::uvec2 to_size = mip_size(from_size);
+		mips.emplace_back(size_t(to_size.x) * to_size.y);
+		downsample(from, from_size, mips.back().data(), filter);
+		from = mips.back().data();
+		from_size = to_size;
+	}
+	return mips;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+//"Mipmaps" builds mip chains for RGBA8 images on the CPU.
+// Each level is half the size of the one before it (rounding down, but never below 1x1), and is
+// filtered from that previous level.
+//Box filtering averages 2x2 blocks (with SSE2, two output pixels per step); it never mixes pixels from
+// different 2^k-aligned blocks within the first k levels, which texture atlases rely on.
+//Kaiser filtering applies a Kaiser-windowed sinc, separably and in floating point (with SSE, one pixel
+// per vector); it is sharper and aliases less, but reaches a few pixels past each block.
+
+enum MipFilter {
+	BoxFilter,
+	KaiserFilter,
+};
+
+inline glm::uvec2 mip_size(glm::uvec2 const &size) {
+	return glm::max(size / 2U, glm::uvec2(1));
+}
+
+//number of levels in a full chain, from 'size' down to 1x1:
+uint32_t mip_levels(glm::uvec2 const &size);
+
+//filter 'src' ('size' pixels) down into 'dst', which must hold mip_size(size) pixels:
+void downsample(uint32_t const *src, glm::uvec2 const &size, uint32_t *dst, MipFilter filter);
+
+//levels 1 through levels-1 of the chain that starts with 'level0' (which is not copied):
+std::vector< std::vector< uint32_t > > build_mips(uint32_t const *level0, glm::uvec2 const &size, uint32_t levels, MipFilter filter);
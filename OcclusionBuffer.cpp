@@ -0,0 +1,223 @@
+#include "OcclusionBuffer.hpp"
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define OCCLUSION_USE_SSE 1
+#endif
+
+OcclusionBuffer::OcclusionBuffer(WorkerPool &workers_, glm::uvec2 const &size_) : workers(workers_) {
+	size.x = (size_.x + TileSize - 1) / TileSize * TileSize;
+	size.y = (size_.y + TileSize - 1) / TileSize * TileSize;
+	depth.assign(size.x * size.y, 0.0f);
+	tile_min.assign((size.x / TileSize) * (size.y / TileSize), 0.0f);
+}
+
+void OcclusionBuffer::clear() {
+	triangles.clear();
+	std::fill(depth.begin(), depth.end(), 0.0f);
+	std::fill(tile_min.begin(), tile_min.end(), 0.0f);
+}
+
+void OcclusionBuffer::add_occluder(AABB const &bounds, glm::mat4 const &local_to_clip) {
+	if (bounds.empty()) return;
+
+	glm::vec4 corners[8];
+	for (uint32_t i = 0; i < 8; ++i) {
+		glm::vec3 corner(
+			(i & 1 ? bounds.max.x : bounds.min.x),
+			(i & 2 ? bounds.max.y : bounds.min.y),
+			(i & 4 ? bounds.max.z : bounds.min.z)
+		);
+		corners[i] = local_to_clip * glm::vec4(corner, 1.0f);
+	}
+
+	//two triangles per face (winding doesn't matter; rasterize_band handles both):
+	static const uint8_t faces[6][4] = {
+		{0,2,6,4}, {1,5,7,3}, //-x, +x
+		{0,4,5,1}, {2,3,7,6}, //-y, +y
+		{0,1,3,2}, {4,6,7,5}, //-z, +z
+	};
+	for (auto const &face : faces) {
+		for (uint32_t t = 0; t < 2; ++t) {
+			glm::vec4 tri[3] = { corners[face[0]], corners[face[t+1]], corners[face[t+2]] };
+
+			//clip against the near plane (z + w >= 0):
+			glm::vec4 poly[4];
+			uint32_t count = 0;
+			for (uint32_t i = 0; i < 3; ++i) {
+				glm::vec4 const &cur = tri[i];
+				glm::vec4 const &next = tri[(i + 1) % 3];
+				float dc = cur.z + cur.w;
+				float dn = next.z + next.w;
+				if (dc >= 0.0f) poly[count++] = cur;
+				if ((dc >= 0.0f) != (dn >= 0.0f)) {
+					poly[count++] = cur + (dc / (dc - dn)) * (next - cur);
+				}
+			}
+
+			//to pixel coordinates + 1/w, then fan-triangulate:
+			glm::vec3 screen[4];
+			for (uint32_t i = 0; i < count; ++i) {
+				float inv_w = 1.0f / poly[i].w;
+				screen[i] = glm::vec3(
+					(poly[i].x * inv_w * 0.5f + 0.5f) * size.x,
+					(poly[i].y * inv_w * 0.5f + 0.5f) * size.y,
+					inv_w
+				);
+			}
+			for (uint32_t i = 1; i + 1 < count; ++i) {
+				Triangle triangle;
+				triangle.a = screen[0];
+				triangle.b = screen[i];
+				triangle.c = screen[i+1];
+				triangles.emplace_back(triangle);
+			}
+		}
+	}
+}
+
+void OcclusionBuffer::rasterize() {
+	workers.parallel_for(size.y / TileSize, [this](uint32_t begin, uint32_t end) {
+		rasterize_band(begin * TileSize, end * TileSize);
+	});
+}
+
+void OcclusionBuffer::rasterize_band(uint32_t y_begin, uint32_t y_end) {
+	for (auto const &triangle : triangles) {
+		glm::vec3 a = triangle.a;
+		glm::vec3 b = triangle.b;
+		glm::vec3 c = triangle.c;
+		float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+		if (!(area != 0.0f && std::isfinite(area))) continue;
+		if (area < 0.0f) {
+			std::swap(b, c);
+			area = -area;
+		}
+
+		//pixels whose centers might be covered, restricted to this band:
+		float min_x = std::max(std::min(a.x, std::min(b.x, c.x)), 0.0f);
+		float max_x = std::min(std::max(a.x, std::max(b.x, c.x)), float(size.x));
+		float min_y = std::max(std::min(a.y, std::min(b.y, c.y)), float(y_begin));
+		float max_y = std::min(std::max(a.y, std::max(b.y, c.y)), float(y_end));
+		if (min_x >= max_x || min_y >= max_y) continue;
+		int32_t x0 = int32_t(std::floor(min_x)) & ~3; //whole groups of four pixels
+		int32_t x1 = std::min(int32_t(std::ceil(max_x)), int32_t(size.x) - 1);
+		int32_t y0 = int32_t(std::floor(min_y));
+		int32_t y1 = std::min(int32_t(std::ceil(max_y)), int32_t(y_end) - 1);
+
+		//edge functions (E = A x + B y + C, non-negative inside) and the 1/w plane:
+		glm::vec3 const *verts[3] = { &a, &b, &c };
+		float A[3], B[3], C[3];
+		for (uint32_t e = 0; e < 3; ++e) {
+			glm::vec3 const &v0 = *verts[e];
+			glm::vec3 const &v1 = *verts[(e + 1) % 3];
+			A[e] = -(v1.y - v0.y);
+			B[e] = (v1.x - v0.x);
+			C[e] = -(A[e] * v0.x + B[e] * v0.y);
+		}
+		//barycentric weight of a vertex is the edge function of the opposite edge, over the area:
+		float inv_area = 1.0f / area;
+		float zA = (A[1] * a.z + A[2] * b.z + A[0] * c.z) * inv_area;
+		float zB = (B[1] * a.z + B[2] * b.z + B[0] * c.z) * inv_area;
+		float zC = (C[1] * a.z + C[2] * b.z + C[0] * c.z) * inv_area;
+
+		for (int32_t y = y0; y <= y1; ++y) {
+			float py = y + 0.5f;
+			float *row = &depth[y * size.x];
+#ifdef OCCLUSION_USE_SSE
+			__m128 step = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+			__m128 zero = _mm_setzero_ps();
+			__m128 e_row[3], e_dx[3];
+			for (uint32_t e = 0; e < 3; ++e) {
+				e_row[e] = _mm_set1_ps(B[e] * py + C[e]);
+				e_dx[e] = _mm_set1_ps(A[e]);
+			}
+			__m128 z_row = _mm_set1_ps(zB * py + zC);
+			__m128 z_dx = _mm_set1_ps(zA);
+			for (int32_t x = x0; x <= x1; x += 4) {
+				__m128 px = _mm_add_ps(_mm_set1_ps(float(x)), step);
+				__m128 mask = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(e_dx[0], px), e_row[0]), zero);
+				mask = _mm_and_ps(mask, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(e_dx[1], px), e_row[1]), zero));
+				mask = _mm_and_ps(mask, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(e_dx[2], px), e_row[2]), zero));
+				if (_mm_movemask_ps(mask) == 0) continue;
+				__m128 z = _mm_add_ps(_mm_mul_ps(z_dx, px), z_row);
+				__m128 old = _mm_loadu_ps(row + x);
+				__m128 merged = _mm_or_ps(_mm_and_ps(mask, _mm_max_ps(old, z)), _mm_andnot_ps(mask, old));
+				_mm_storeu_ps(row + x, merged);
+			}
+#else
+			for (int32_t x = x0; x <= x1; ++x) {
+				float px = x + 0.5f;
+				if (A[0] * px + B[0] * py + C[0] < 0.0f) continue;
+				if (A[1] * px + B[1] * py + C[1] < 0.0f) continue;
+				if (A[2] * px + B[2] * py + C[2] < 0.0f) continue;
+				row[x] = std::max(row[x], zA * px + zB * py + zC);
+			}
+#endif
+		}
+	}
+
+	//update per-tile minimums for this band:
+	uint32_t tiles_x = size.x / TileSize;
+	for (uint32_t ty = y_begin / TileSize; ty < y_end / TileSize; ++ty) {
+		for (uint32_t tx = 0; tx < tiles_x; ++tx) {
+			float min = depth[(ty * TileSize) * size.x + tx * TileSize];
+			for (uint32_t y = ty * TileSize; y < (ty + 1) * TileSize; ++y) {
+				float const *row = &depth[y * size.x + tx * TileSize];
+				for (uint32_t x = 0; x < TileSize; ++x) {
+					min = std::min(min, row[x]);
+				}
+			}
+			tile_min[ty * tiles_x + tx] = min;
+		}
+	}
+}
+
+bool OcclusionBuffer::occluded(AABB const &bounds, glm::mat4 const &local_to_clip) const {
+	if (bounds.empty()) return false;
+
+	//screen rectangle and nearest depth of the box:
+	glm::vec2 lo(std::numeric_limits< float >::infinity());
+	glm::vec2 hi(-std::numeric_limits< float >::infinity());
+	float nearest = 0.0f;
+	for (uint32_t i = 0; i < 8; ++i) {
+		glm::vec3 corner(
+			(i & 1 ? bounds.max.x : bounds.min.x),
+			(i & 2 ? bounds.max.y : bounds.min.y),
+			(i & 4 ? bounds.max.z : bounds.min.z)
+		);
+		glm::vec4 clip = local_to_clip * glm::vec4(corner, 1.0f);
+		//boxes crossing the near plane are treated as visible:
+		if (clip.z + clip.w < 0.0f || clip.w <= 0.0f) return false;
+		float inv_w = 1.0f / clip.w;
+		glm::vec2 px((clip.x * inv_w * 0.5f + 0.5f) * size.x, (clip.y * inv_w * 0.5f + 0.5f) * size.y);
+		lo = glm::min(lo, px);
+		hi = glm::max(hi, px);
+		nearest = std::max(nearest, inv_w);
+	}
+
+	//grow by a pixel to make up for occluder coverage being sampled at pixel centers:
+	lo = glm::max(lo - 1.0f, glm::vec2(0.0f));
+	hi = glm::min(hi + 1.0f, glm::vec2(size) - 1.0f);
+	if (lo.x > hi.x || lo.y > hi.y) return false;
+	uint32_t x0 = uint32_t(lo.x), x1 = uint32_t(hi.x);
+	uint32_t y0 = uint32_t(lo.y), y1 = uint32_t(hi.y);
+
+	uint32_t tiles_x = size.x / TileSize;
+	for (uint32_t ty = y0 / TileSize; ty <= y1 / TileSize; ++ty) {
+		for (uint32_t tx = x0 / TileSize; tx <= x1 / TileSize; ++tx) {
+			//whole tile is in front of the box:
+			if (tile_min[ty * tiles_x + tx] > nearest) continue;
+			for (uint32_t y = std::max(y0, ty * TileSize); y <= std::min(y1, (ty + 1) * TileSize - 1); ++y) {
+				for (uint32_t x = std::max(x0, tx * TileSize); x <= std::min(x1, (tx + 1) * TileSize - 1); ++x) {
+					if (depth[y * size.x + x] <= nearest) return false;
+				}
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Bounds.hpp"
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+struct WorkerPool;
+
+//"OcclusionBuffer" is a low-resolution CPU depth buffer for occlusion culling:
+// a few large occluders are rasterized into it each frame (as their bounding boxes),
+// then other objects' bounds are tested against it before being drawn.
+//Depth is stored as 1/w (larger is closer), which interpolates linearly in screen space;
+// pixels without an occluder hold 0.
+//Rasterization uses SSE (four pixels per step, with masked depth writes) where available,
+// and is split across workers in horizontal bands of tiles.
+
+struct OcclusionBuffer {
+	OcclusionBuffer(WorkerPool &workers, glm::uvec2 const &size = glm::uvec2(256, 128));
+
+	//start a new frame:
+	void clear();
+	//queue the object-space box of an occluder; 'local_to_clip' maps it to clip space:
+	void add_occluder(AABB const &bounds, glm::mat4 const &local_to_clip);
+	//rasterize all queued occluders:
+	void rasterize();
+
+	//true if the object-space box is certainly hidden behind the rasterized occluders:
+	bool occluded(AABB const &bounds, glm::mat4 const &local_to_clip) const;
+
+	enum : uint32_t { TileSize = 8 };
+
+	WorkerPool &workers;
+	glm::uvec2 size; //rounded up to whole tiles
+
+	//internals:
+	struct Triangle {
+		glm::vec3 a, b, c; //pixel x, y, and 1/w
+	};
+	std::vector< Triangle > triangles;
+	std::vector< float > depth; //per pixel, row-major
+	std::vector< float > tile_min; //minimum of 'depth' over each tile
+	void rasterize_band(uint32_t y_begin, uint32_t y_end);
+};
@@ -0,0 +1,49 @@
+#include "Offscreen.hpp"
+
+#include <stdexcept>
+#include <cassert>
+
+Offscreen::Offscreen(glm::uvec2 const &size_) : size(size_) {
+	glGenRenderbuffers(1, &color);
+	glBindRenderbuffer(GL_RENDERBUFFER, color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size.x, size.y);
+
+	glGenRenderbuffers(1, &depth);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, size.x, size.y);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(1, &depth);
+		glDeleteRenderbuffers(1, &color);
+		throw std::runtime_error("Offscreen framebuffer is incomplete.");
+	}
+}
+
+Offscreen::~Offscreen() {
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &depth);
+	glDeleteRenderbuffers(1, &color);
+}
+
+void Offscreen::bind() {
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, size.x, size.y);
+}
+
+void Offscreen::read(std::vector< uint32_t > *pixels) const {
+	assert(pixels);
+	pixels->resize(size.x * size.y);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, pixels->data());
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
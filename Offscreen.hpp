@@ -0,0 +1,30 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+//"Offscreen" is a framebuffer object with RGBA8 color and 24-bit depth (+ stencil) renderbuffers,
+// for rendering without a window (see HeadlessContext.hpp) and reading the result back.
+
+struct Offscreen {
+	//note: will throw if the framebuffer isn't complete.
+	Offscreen(glm::uvec2 const &size);
+	Offscreen(Offscreen const &) = delete;
+	~Offscreen();
+
+	//draw into the framebuffer (also sets the viewport to cover it):
+	void bind();
+
+	//copy the color buffer out as RGBA8 pixels, bottom row first (i.e., save with LowerLeftOrigin):
+	void read(std::vector< uint32_t > *pixels) const;
+
+	glm::uvec2 size;
+
+	//internals:
+	GLuint framebuffer = 0;
+	GLuint color = 0;
+	GLuint depth = 0;
+};
@@ -0,0 +1,183 @@
+#include "ProgramCache.hpp"
+#include "SceneShader.hpp"
+#include "read_chunk.hpp"
+#include "write_chunk.hpp"
+#include "fnv1a.hpp"
+
+#ifdef _WIN32
+#include <SDL.h> //(gl_shims only binds core 3.3 functions)
+#endif
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <cstdio>
+
+namespace {
+	uint64_t hash_string(uint64_t hash, std::string const &str) {
+		//(including the terminator, so consecutive strings can't run together)
+		return fnv1a(str.c_str(), str.size() + 1, hash);
+	}
+	std::string gl_string(GLenum name) {
+		GLubyte const *str = glGetString(name);
+		return str ? reinterpret_cast< char const * >(str) : "";
+	}
+}
+
+ProgramCache::ProgramCache(std::string const &filename_) : filename(filename_) {
+	//binaries need GL 4.1 or ARB_get_program_binary:
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	supported = (major > 4 || (major == 4 && minor >= 1));
+	if (!supported) supported = has_extension("GL_ARB_get_program_binary");
+	//...and at least one binary format (some drivers support the calls but no formats):
+	if (supported) {
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		supported = (formats > 0);
+	}
+	if (supported) {
+		#ifdef _WIN32
+		GetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)SDL_GL_GetProcAddress("glGetProgramBinary");
+		ProgramBinary = (PFNGLPROGRAMBINARYPROC)SDL_GL_GetProcAddress("glProgramBinary");
+		ProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)SDL_GL_GetProcAddress("glProgramParameteri");
+		#else
+		GetProgramBinary = glGetProgramBinary;
+		ProgramBinary = glProgramBinary;
+		ProgramParameteri = glProgramParameteri;
+		#endif
+		supported = (GetProgramBinary && ProgramBinary && ProgramParameteri);
+	}
+	if (!supported) {
+		std::cerr << "NOTE: program binaries aren't supported; shaders will be compiled from source on every launch." << std::endl;
+		return;
+	}
+
+	driver = FNV1aBasis;
+	driver = hash_string(driver, gl_string(GL_VENDOR));
+	driver = hash_string(driver, gl_string(GL_RENDERER));
+	driver = hash_string(driver, gl_string(GL_VERSION));
+
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) return; //(nothing cached yet)
+	try {
+		std::vector< PackedProgram > programs;
+		std::vector< char > data;
+		read_chunk(file, "pgm0", &programs);
+		read_chunk(file, "pgd0", &data);
+		for (auto const &packed : programs) {
+			//binaries from other drivers are dropped (and so won't be written back):
+			if ((uint64_t(packed.driver_high) << 32 | packed.driver_low) != driver) continue;
+			if (!(packed.data_begin <= packed.data_end && packed.data_end <= data.size())) {
+				throw std::runtime_error("binary has out-of-range data begin/end");
+			}
+			Binary &binary = binaries[uint64_t(packed.key_high) << 32 | packed.key_low];
+			binary.format = packed.format;
+			binary.data.assign(data.begin() + packed.data_begin, data.begin() + packed.data_end);
+		}
+	} catch (std::exception &e) {
+		std::cerr << "WARNING: ignoring program cache '" << filename << "' (" << e.what() << ")." << std::endl;
+		binaries.clear();
+	}
+}
+
+ProgramCache::~ProgramCache() {
+	flush();
+}
+
+GLuint ProgramCache::program(std::string const &vertex_source, std::string const &fragment_source) {
+	bool use_cache = supported && !GLTrace::capturing();
+
+	uint64_t key = driver;
+	key = hash_string(key, vertex_source);
+	key = hash_string(key, fragment_source);
+
+	if (use_cache) {
+		auto f = binaries.find(key);
+		if (f != binaries.end()) {
+			GLuint program = glCreateProgram();
+			ProgramBinary(program, f->second.format, f->second.data.data(), GLsizei(f->second.data.size()));
+			GLint link_status = GL_FALSE;
+			glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+			if (link_status == GL_TRUE) {
+				hits += 1;
+				return program;
+			}
+			//rejected; rebuild below, which replaces the binary:
+			// (the program never left this function, so no GLState has uniform values remembered for it)
+			glDeleteProgram(program);
+			binaries.erase(f);
+		}
+	}
+	misses += 1;
+
+	GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, vertex_source);
+	GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER, fragment_source);
+	GLuint program = glCreateProgram();
+	if (use_cache) ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	link_program(fragment_shader, vertex_shader, program);
+	//(the program keeps what it needs; the shaders go when it does)
+	glDeleteShader(vertex_shader);
+	glDeleteShader(fragment_shader);
+
+	if (use_cache) {
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length > 0) {
+			Binary &binary = binaries[key];
+			binary.data.resize(size_t(length));
+			GLsizei written = 0;
+			GetProgramBinary(program, length, &written, &binary.format, binary.data.data());
+			binary.data.resize(size_t(written));
+			if (binary.data.empty()) {
+				binaries.erase(key);
+			} else {
+				dirty = true;
+			}
+		}
+	}
+	return program;
+}
+
+void ProgramCache::flush() {
+	if (!dirty) return;
+	dirty = false; //(a failed write isn't retried for the same binaries)
+	try {
+		save();
+	} catch (std::exception &e) {
+		std::cerr << "WARNING: failed to write program cache '" << filename << "': " << e.what() << std::endl;
+	}
+}
+
+void ProgramCache::save() const {
+	std::vector< PackedProgram > programs;
+	std::vector< char > data;
+	programs.reserve(binaries.size());
+	for (auto const &kv : binaries) {
+		PackedProgram packed;
+		packed.key_low = uint32_t(kv.first);
+		packed.key_high = uint32_t(kv.first >> 32);
+		packed.driver_low = uint32_t(driver);
+		packed.driver_high = uint32_t(driver >> 32);
+		packed.format = kv.second.format;
+		packed.data_begin = uint32_t(data.size());
+		data.insert(data.end(), kv.second.data.begin(), kv.second.data.end());
+		packed.data_end = uint32_t(data.size());
+		programs.emplace_back(packed);
+	}
+
+	//write to a temporary file and then replace, so a crash mid-write can't leave a truncated cache:
+	std::string temp = filename + ".tmp";
+	{
+		std::ofstream file(temp, std::ios::binary);
+		if (!file) throw std::runtime_error("Failed to open '" + temp + "' for writing.");
+		write_chunk(file, "pgm0", programs);
+		write_chunk(file, "pgd0", data);
+		if (!file.flush()) throw std::runtime_error("Failed to write '" + temp + "'.");
+	}
+	std::remove(filename.c_str()); //(rename won't replace an existing file on windows)
+	if (std::rename(temp.c_str(), filename.c_str()) != 0) {
+		throw std::runtime_error("Failed to rename '" + temp + "' to '" + filename + "'.");
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+//"ProgramCache" keeps linked programs on disk as driver binaries (glGetProgramBinary / glProgramBinary,
+// core in GL 4.1 and available on 3.3 contexts through ARB_get_program_binary), so later launches skip compiling and linking.
+//Binaries are keyed by a hash of the program's sources and of the driver's vendor/renderer/version strings.
+// If the driver rejects a binary anyway (drivers may, e.g., after an update that didn't change those strings),
+// the program is compiled from source as usual and the binary replaced.
+//Without driver support, or while a GLTrace is capturing (replays need the source), every program is compiled from source.
+//
+//Cache file format (chunks as in read_chunk.hpp, native byte order):
+// "pgm0": PackedProgram per binary
+// "pgd0": binary data
+
+struct ProgramCache {
+	//read cached binaries for the current context's driver (a missing or unreadable file is just an empty cache):
+	ProgramCache(std::string const &filename);
+	ProgramCache(ProgramCache const &) = delete;
+	//writes any new binaries (see 'flush'):
+	~ProgramCache();
+
+	//program from vertex and fragment source, from the cache if possible; new binaries are kept until the next 'flush':
+	// returns a new program each call (programs the driver rejected are deleted before anything else sees them,
+	// so GLState never needs to forget them; callers deleting returned programs must call GLState::forget_program).
+	// note: will throw (after printing the info log) if the sources fail to compile or link.
+	GLuint program(std::string const &vertex_source, std::string const &fragment_source);
+
+	//counts, for reporting:
+	uint32_t hits = 0; //programs made from binaries
+	uint32_t misses = 0; //programs compiled from source (including rejected binaries)
+
+	//write the file if binaries were added since it was last written (once per batch, since each write is the whole cache):
+	// note: reports, rather than throws, if the file can't be written.
+	void flush();
+
+	struct PackedProgram {
+		uint32_t key_low, key_high;
+		uint32_t driver_low, driver_high;
+		uint32_t format;
+		uint32_t data_begin, data_end;
+	};
+	static_assert(sizeof(PackedProgram) == 4 * 7, "PackedProgram is packed.");
+
+	//internals:
+	std::string filename;
+	bool supported = false;
+	uint64_t driver = 0; //hash of the vendor/renderer/version strings
+	struct Binary {
+		GLenum format = 0;
+		std::vector< char > data;
+	};
+	std::unordered_map< uint64_t, Binary > binaries; //by key
+	bool dirty = false; //binaries changed since the file was written
+	PFNGLGETPROGRAMBINARYPROC GetProgramBinary = nullptr;
+	PFNGLPROGRAMBINARYPROC ProgramBinary = nullptr;
+	PFNGLPROGRAMPARAMETERIPROC ProgramParameteri = nullptr;
+	void save() const;
+};
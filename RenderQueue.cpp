@@ -0,0 +1,56 @@
+#include "RenderQueue.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <cassert>
+
+uint64_t RenderQueue::make_key(GLuint program, GLuint vao, uint32_t material, uint32_t mesh, float depth) {
+	//non-negative floats sort the same as their bit patterns; keep the top 16 bits:
+	depth = std::max(depth, 0.0f);
+	uint32_t depth_bits;
+	static_assert(sizeof(depth_bits) == sizeof(depth), "float is 32 bits");
+	std::memcpy(&depth_bits, &depth, sizeof(depth));
+
+	return (uint64_t(program & 0xfff) << 52)
+	     | (uint64_t(vao & 0xfff) << 40)
+	     | (uint64_t(material & 0xff) << 32)
+	     | (uint64_t(mesh & 0xffff) << 16)
+	     | uint64_t(depth_bits >> 16);
+}
+
+void RenderQueue::sort() {
+	if (items.size() < 2) return;
+	scratch.resize(items.size());
+
+	//histograms for all eight digits in one pass:
+	uint32_t counts[8][256];
+	std::memset(counts, 0, sizeof(counts));
+	for (auto const &item : items) {
+		for (uint32_t d = 0; d < 8; ++d) {
+			counts[d][(item.key >> (8 * d)) & 0xff] += 1;
+		}
+	}
+
+	Item *from = &items[0];
+	Item *to = &scratch[0];
+	for (uint32_t d = 0; d < 8; ++d) {
+		uint32_t shift = 8 * d;
+		//every key has the same digit here, so this pass wouldn't move anything:
+		if (counts[d][(from[0].key >> shift) & 0xff] == items.size()) continue;
+
+		uint32_t offsets[256];
+		uint32_t total = 0;
+		for (uint32_t b = 0; b < 256; ++b) {
+			offsets[b] = total;
+			total += counts[d][b];
+		}
+		for (Item const *i = from; i != from + items.size(); ++i) {
+			to[offsets[(i->key >> shift) & 0xff]++] = *i;
+		}
+		std::swap(from, to);
+	}
+
+	if (from != &items[0]) {
+		std::copy(from, from + items.size(), items.begin());
+	}
+}
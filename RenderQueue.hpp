@@ -0,0 +1,38 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <vector>
+#include <cstdint>
+
+//"RenderQueue" orders draws by a 64-bit sort key so that objects sharing state end up adjacent:
+// [63..52] program (12 bits) [51..40] vao (12 bits) [39..32] material (8 bits) [31..16] mesh (16 bits) [15..0] depth (16 bits)
+//Keys are sorted with an LSD radix sort (eight 8-bit digits; digits that are the same for every key are skipped).
+//Names too large for their field are truncated, which only costs grouping, not correctness:
+// callers should still compare actual state before issuing a change.
+
+struct RenderQueue {
+	struct Item {
+		uint64_t key;
+		uint32_t index; //caller-defined (e.g., index of the object to draw)
+	};
+
+	//pack a sort key; 'mesh' identifies the vertex range (so instances of a mesh sort together),
+	// 'depth' is camera-space distance (>= 0), sorted near-to-far:
+	static uint64_t make_key(GLuint program, GLuint vao, uint32_t material, uint32_t mesh, float depth);
+
+	void clear() { items.clear(); }
+	void push(uint64_t key, uint32_t index) {
+		Item item;
+		item.key = key;
+		item.index = index;
+		items.emplace_back(item);
+	}
+	//sort 'items' by ascending key (stable):
+	void sort();
+
+	std::vector< Item > items;
+
+	//internals:
+	std::vector< Item > scratch;
+};
@@ -1,7 +1,12 @@
 #include "Scene.hpp"
+#include "OcclusionBuffer.hpp"
+#include "SceneShader.hpp"
+#include "GLState.hpp"
+#include "WorkerPool.hpp"
+
+#include <algorithm>
 
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
 
 #include <iostream>
 
@@ -109,43 +114,156 @@ glm::mat4 Scene::Camera::make_projection() const {
 	return glm::infinitePerspective(fovy, aspect, near_plane);
 }
 
+glm::mat4 Scene::Snapshot::Camera::make_projection() const {
+	return glm::infinitePerspective(fovy, aspect, near_plane);
+}
+
 //---------------------------
 
-void Scene::render() {
-	glm::mat4 world_to_camera = camera.transform.make_world_to_local();
-	glm::mat4 world_to_clip = camera.make_projection() * world_to_camera;
+void Scene::snapshot(Snapshot *snapshot_) const {
+	Snapshot &out = *snapshot_;
+	out.camera.world_to_camera = camera.transform.make_world_to_local();
+	out.camera.fovy = camera.fovy;
+	out.camera.aspect = camera.aspect;
+	out.camera.near_plane = camera.near_plane;
+
+	out.objects.resize(objects.size());
+	uint32_t i = 0;
+	for (auto const &kv : objects) {
+		Object const &object = kv.second;
+		Snapshot::Object &o = out.objects[i++];
+		o.local_to_world = object.transform.make_local_to_world();
+		o.program = object.program;
+		o.features = object.features;
+		o.vao = object.vao;
+		o.start = object.start;
+		o.count = object.count;
+		o.material = object.material;
+		o.color = object.color;
+		o.bounds = object.bounds;
+		o.sphere = object.sphere;
+		o.occluder = object.occluder;
+	}
 
-	//Get world-space position of all lights:
+	out.mesh_generation = mesh_generation;
+	out.program_generation = program_generation;
+
+	out.lights.resize(lights.size());
+	i = 0;
 	for (auto const &light : lights) {
-		glm::mat4 mv = world_to_camera * light.transform.make_local_to_world();
-		(void)mv;
+		Snapshot::Light &l = out.lights[i++];
+		l.type = light.type;
+		l.local_to_world = light.transform.make_local_to_world();
+		l.intensity = light.intensity;
+		l.range = light.range;
 	}
+}
 
-	for (auto const &kv : objects) {
-		auto const &object = kv.second;
-		glm::mat4 local_to_world = object.transform.make_local_to_world();
+//---------------------------
 
-		//compute modelview+projection (object space to clip space) matrix for this object:
-		glm::mat4 mvp = world_to_clip * local_to_world;
+void Scene::render(GLState &gl, StreamingBuffer &streaming, WorkerPool &workers) {
+	snapshot(&render_snapshot);
+	render(render_snapshot, gl, streaming, workers);
+}
 
-		//compute modelview (object space to camera local space) matrix for this object:
-		glm::mat4 mv = world_to_camera * local_to_world;
+void Scene::render(Snapshot const &snapshot, GLState &gl, StreamingBuffer &streaming, WorkerPool &workers) {
+	record(snapshot, &render_commands, workers);
 
-		//NOTE: inverse cancels out transpose unless there is scale involved
-		glm::mat3 itmv = glm::inverse(glm::transpose(glm::mat3(mv)));
+	CommandList::Counts counts = render_commands.execute(gl, streaming, render_instance_buffer);
+	stats.program_changes = counts.program_changes;
+	stats.vao_changes = counts.vao_changes;
+	stats.draws = counts.draws;
+}
 
-		//set up program uniforms:
-		glUseProgram(object.program);
-		if (object.program_mvp != -1U) {
-			glUniformMatrix4fv(object.program_mvp, 1, GL_FALSE, glm::value_ptr(mvp));
+void Scene::record(Snapshot const &snapshot, CommandList *commands, WorkerPool &workers) {
+	glm::mat4 const &world_to_camera = snapshot.camera.world_to_camera;
+	glm::mat4 world_to_clip = snapshot.camera.make_projection() * world_to_camera;
+
+	//NOTE: lights are binned and uploaded separately (see LightClusters.hpp)
+
+	auto const &objects = snapshot.objects;
+	uint32_t count = uint32_t(objects.size());
+
+	//gather world-space bounds:
+	render_bounds.resize(count);
+	workers.parallel_for(count, [this, &objects](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i) {
+			Snapshot::Object const &object = objects[i];
+			render_bounds.set(i, object.bounds.transformed(object.local_to_world), object.sphere.transformed(object.local_to_world));
 		}
-		if (object.program_itmv != -1U) {
-			glUniformMatrix3fv(object.program_itmv, 1, GL_FALSE, glm::value_ptr(itmv));
+	}, 64);
+
+	//drop objects outside the view frustum (in groups of four, for the SIMD test):
+	Frustum frustum = Frustum::from_clip(world_to_clip);
+	render_visible.resize(count);
+	workers.parallel_for((count + 3) / 4, [this, &frustum](uint32_t begin, uint32_t end) {
+		render_bounds.cull(frustum, &render_visible[0], begin * 4, end * 4);
+	}, 64);
+
+	//rasterize the (visible) occluders:
+	if (occlusion) {
+		occlusion->clear();
+		for (uint32_t i = 0; i < count; ++i) {
+			if (render_visible[i] && objects[i].occluder) {
+				occlusion->add_occluder(objects[i].bounds, world_to_clip * objects[i].local_to_world);
+			}
 		}
+		occlusion->rasterize();
+	}
 
-		glBindVertexArray(object.vao);
+	//each slice of objects is occlusion-tested and recorded into its own list:
+	uint32_t slice_count = std::max(1U, std::min(workers.size() + 1, (count + 63) / 64));
+	render_slices.resize(slice_count);
+	render_slice_stats.assign(slice_count, Stats());
+	workers.parallel_for(slice_count, [&](uint32_t slice_begin, uint32_t slice_end) {
+		for (uint32_t slice = slice_begin; slice < slice_end; ++slice) {
+			CommandList &list = render_slices[slice];
+			Stats &slice_stats = render_slice_stats[slice];
+			list.clear();
+			for (uint32_t i = uint64_t(count) * slice / slice_count; i < uint64_t(count) * (slice + 1) / slice_count; ++i) {
+				if (!render_visible[i]) {
+					slice_stats.culled += 1;
+					continue;
+				}
+				Snapshot::Object const &object = objects[i];
+				glm::mat4 const &local_to_world = object.local_to_world;
+				if (occlusion && !object.occluder && occlusion->occluded(object.bounds, world_to_clip * local_to_world)) {
+					slice_stats.occluded += 1;
+					continue;
+				}
+				slice_stats.visible += 1;
 
-		//draw the object:
-		glDrawArrays(GL_TRIANGLES, object.start, object.count);
+				InstanceBuffer::Instance instance;
+				//compute modelview (object space to camera local space) matrix for this object:
+				instance.mv = world_to_camera * local_to_world;
+				//NOTE: inverse cancels out transpose unless there is scale involved
+				instance.itmv = glm::inverse(glm::transpose(glm::mat3(instance.mv)));
+				instance.color = object.color;
+
+				//sort so that objects sharing a program, vao, and mesh are adjacent (then front-to-back):
+				glm::vec3 center = 0.5f * (object.bounds.min + object.bounds.max);
+				float depth = -(instance.mv * glm::vec4(center, 1.0f)).z;
+				uint32_t mesh = object.start * 31 + object.count;
+				GLuint program = object.program;
+				if (variants) {
+					GLuint variant = variants->find(object.features & variant_mask);
+					if (variant) program = variant;
+				}
+				uint64_t key = RenderQueue::make_key(program, object.vao, object.material, mesh, depth);
+
+				list.draw(key, program, object.vao, object.start, object.count, instance);
+			}
+		}
+	});
+
+	stats.visible = 0;
+	stats.culled = 0;
+	stats.occluded = 0;
+	for (auto const &slice_stats : render_slice_stats) {
+		stats.visible += slice_stats.visible;
+		stats.culled += slice_stats.culled;
+		stats.occluded += slice_stats.occluded;
 	}
-}
\ No newline at end of file
+
+	commands->merge(render_slices, &render_queue);
+}
@@ -1,12 +1,22 @@
 #pragma once
 
 #include "GL.hpp"
+#include "Bounds.hpp"
+#include "RenderQueue.hpp"
+#include "InstanceBuffer.hpp"
+#include "CommandList.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <vector>
 #include <list>
 #include <unordered_map>
 
+struct OcclusionBuffer;
+struct SceneShader;
+struct GLState;
+struct StreamingBuffer;
+struct WorkerPool;
+
 //Describes a 3D scene for rendering:
 struct Scene {
 	struct Transform {
@@ -60,20 +70,109 @@ struct Scene {
 		GLuint vao = 0;
 		GLuint start = 0;
 		GLuint count = 0;
+		bool occluder = false; //large object to rasterize into the occlusion buffer (if any)
+		AABB bounds; //object-space bounds of the geometry
+		Sphere sphere; //object-space bounding sphere of the geometry
+		uint32_t material = 0; //objects with equal material (and program, vao) are drawn together
+		glm::vec4 color = glm::vec4(1.0f); //per-instance tint
 		//program info:
 		GLuint program = 0;
-		GLuint program_mvp = -1U; //uniform index for MVP matrix
-		GLuint program_itmv = -1U; //uniform index for inverse(transpose(mv)) matrix
+		uint32_t features = -1U; //shader features wanted, if drawn through 'variants' (see SceneShader::Feature)
+		//NOTE: programs are drawn instanced, reading modelview matrices from the instance buffer (see InstanceBuffer.hpp)
+		// and the projection from the per-frame uniform block (see FrameUniforms.hpp)
 	};
 	struct Light {
 		Transform transform;
-		//light parameters (directional):
+		//directional lights shine along their local -z axis, point lights outward from their origin:
+		enum Type {
+			Directional,
+			Point,
+		} type = Directional;
+		//light parameters:
 		glm::vec3 intensity = glm::vec3(1.0f, 1.0f, 1.0f); //effectively, color
+		float range = 10.0f; //(point lights only) distance at which the light fades to zero
 	};
 
 	Camera camera;
 	std::unordered_map<std::string, Object > objects;
 	std::list< Light > lights;
+	uint32_t mesh_generation = 0; //Meshes::generation that objects' vaos were last pointed at
+	uint32_t program_generation = 0; //SceneShader::generation that objects' programs were last pointed at
+
+	//Everything rendering reads from the scene, flattened to world space and copied out,
+	// so that one thread can render it while another keeps updating the scene:
+	struct Snapshot {
+		struct Camera {
+			glm::mat4 world_to_camera = glm::mat4(1.0f);
+			float fovy = glm::radians(60.0f);
+			float aspect = 1.0f;
+			float near_plane = 0.01f;
+			glm::mat4 make_projection() const;
+		} camera;
+		struct Object {
+			glm::mat4 local_to_world;
+			GLuint program = 0;
+			uint32_t features = -1U;
+			GLuint vao = 0;
+			GLuint start = 0;
+			GLuint count = 0;
+			uint32_t material = 0;
+			glm::vec4 color = glm::vec4(1.0f);
+			AABB bounds;
+			Sphere sphere;
+			bool occluder = false;
+		};
+		std::vector< Object > objects;
+		struct Light {
+			Scene::Light::Type type = Scene::Light::Directional;
+			glm::mat4 local_to_world;
+			glm::vec3 intensity = glm::vec3(1.0f);
+			float range = 10.0f;
+		};
+		std::vector< Light > lights;
+		uint32_t mesh_generation = 0;
+		uint32_t program_generation = 0;
+	};
+	//fill *snapshot with the current state of the scene (reusing its storage):
+	void snapshot(Snapshot *snapshot) const;
+
+	//if set, objects hidden behind occluders are skipped as well:
+	OcclusionBuffer *occlusion = nullptr;
+
+	//if set, each object is drawn with the shader variant for (its features & variant_mask), where that variant
+	// has been built (see SceneShader::variant), instead of its 'program':
+	SceneShader const *variants = nullptr;
+	uint32_t variant_mask = -1U;
+
+	//draw every object that might be visible from the camera
+	// (setting GL state through 'gl' and writing per-instance data into 'streaming'):
+	void render(GLState &gl, StreamingBuffer &streaming, WorkerPool &workers);
+	//same, but from a snapshot:
+	// only touches 'occlusion', 'stats', and the render scratch space below -- never the objects, camera, or lights --
+	// so it may run on a render thread while another thread updates the scene.
+	void render(Snapshot const &snapshot, GLState &gl, StreamingBuffer &streaming, WorkerPool &workers);
+
+	//the CPU half of 'render': cull, compute instance data, and sort, spread over 'workers';
+	// makes no GL calls (the occlusion buffer, if any, must use the same workers).
+	void record(Snapshot const &snapshot, CommandList *commands, WorkerPool &workers);
+
+	//counts from the most recent render:
+	struct Stats {
+		uint32_t visible = 0;
+		uint32_t culled = 0; //outside the view frustum
+		uint32_t occluded = 0; //inside the frustum, but behind occluders
+		uint32_t program_changes = 0; //glUseProgram calls
+		uint32_t vao_changes = 0; //glBindVertexArray calls
+		uint32_t draws = 0; //glDrawArraysInstanced calls
+	} stats;
 
-	void render();
+	//internals (scratch space reused by render):
+	Snapshot render_snapshot;
+	BoundsList render_bounds;
+	std::vector< uint8_t > render_visible;
+	std::vector< CommandList > render_slices; //recorded in parallel, then merged into render_commands
+	std::vector< Stats > render_slice_stats;
+	RenderQueue render_queue;
+	CommandList render_commands;
+	InstanceBuffer render_instance_buffer;
 };
\ No newline at end of file
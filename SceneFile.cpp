@@ -0,0 +1,63 @@
+#include "SceneFile.hpp"
+#include "read_chunk.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <cassert>
+
+std::vector< std::string > SceneFile::read(std::string const &filename, Scene *scene_,
+	std::function< void(std::string const &name, Scene::Object &object) > const &add) {
+	assert(scene_);
+	Scene &scene = *scene_;
+
+	std::ifstream file(filename, std::ios::binary);
+
+	std::vector< char > strings;
+	//read strings chunk:
+	read_chunk(file, "str0", &strings);
+
+	std::vector< Entry > data;
+	read_chunk(file, "scn0", &data);
+
+	std::map< std::string, Entry > read_entries;
+	for (auto const &entry : data) {
+		if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
+			throw std::runtime_error("index entry has out-of-range name begin/end");
+		}
+		std::string name(&strings[0] + entry.name_begin, &strings[0] + entry.name_end);
+		read_entries[name] = entry;
+	}
+
+	std::vector< std::string > changed;
+	for (auto const &kv : read_entries) {
+		Entry const &entry = kv.second;
+		auto f = entries.find(kv.first);
+		if (f != entries.end()
+		 && f->second.position == entry.position && f->second.rotation == entry.rotation && f->second.scale == entry.scale) {
+			continue;
+		}
+		auto o = scene.objects.find(kv.first);
+		bool added = (o == scene.objects.end());
+		Scene::Object &object = scene.objects[kv.first];
+		object.transform.position = entry.position;
+		object.transform.rotation = entry.rotation;
+		object.transform.scale = entry.scale;
+		if (added) {
+			try {
+				add(kv.first, object);
+			} catch (...) {
+				scene.objects.erase(kv.first);
+				throw;
+			}
+		}
+		changed.emplace_back(kv.first);
+	}
+	for (auto const &kv : entries) {
+		if (!read_entries.count(kv.first)) {
+			std::cerr << "WARNING: object '" << kv.first << "' was removed from " << filename << "; keeping it in the running scene." << std::endl;
+		}
+	}
+	entries = read_entries;
+	return changed;
+}
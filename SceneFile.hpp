@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Scene.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <functional>
+#include <map>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+//"SceneFile" reads the object placements exported to "scene.blob" (a "str0" chunk of names and
+// a "scn0" chunk of entries; see read_chunk.hpp) into a scene.
+//It remembers what it read, so reading again (e.g., after the exporter rewrites the file)
+// only touches, and reports, the entries that changed.
+
+struct SceneFile {
+	struct Entry {
+		uint32_t name_begin, name_end;
+		glm::vec3 position;
+		glm::quat rotation;
+		glm::vec3 scale;
+	};
+	static_assert(sizeof(Entry) == 48, "Scene entry should be packed");
+
+	//read 'filename', moving existing objects in place (so pointers to them stay valid) and
+	// creating missing ones, which are passed to 'add' to be given a mesh and program:
+	// returns the names of entries that changed since the last read.
+	// note: will throw if the file fails to read.
+	std::vector< std::string > read(std::string const &filename, Scene *scene,
+		std::function< void(std::string const &name, Scene::Object &object) > const &add);
+
+	//entries as last read:
+	std::map< std::string, Entry > entries;
+};
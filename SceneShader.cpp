@@ -0,0 +1,350 @@
+#include "SceneShader.hpp"
+#include "FrameUniforms.hpp"
+#include "LightClusters.hpp"
+#include "ProgramCache.hpp"
+#include "GLState.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <cstring>
+
+char const *SceneShader::VertexPath = "shaders/scene.vert";
+char const *SceneShader::FragmentPath = "shaders/scene.frag";
+
+namespace {
+	struct FeatureInfo {
+		uint32_t bit;
+		char const *define; //in shader source
+		char const *name; //in manifests and messages
+	};
+	FeatureInfo const Features[] = {
+		{ SceneShader::DirectionalLights, "DIRECTIONAL_LIGHTS", "directional" },
+		{ SceneShader::PointLights, "POINT_LIGHTS", "point" },
+		{ SceneShader::Fog, "FOG", "fog" },
+	};
+
+	//e.g., "directional+fog" (or "none"), for messages:
+	std::string describe(uint32_t features) {
+		std::string ret;
+		for (auto const &feature : Features) {
+			if (features & feature.bit) ret += (ret.empty() ? "" : "+") + std::string(feature.name);
+		}
+		return (ret.empty() ? "none" : ret);
+	}
+
+	std::string read_file(char const *path) {
+		std::ifstream file(path, std::ios::binary);
+		std::ostringstream contents;
+		if (!file || !(contents << file.rdbuf())) {
+			throw std::runtime_error("Failed to read shader source '" + std::string(path) + "'.");
+		}
+		return contents.str();
+	}
+
+	//file contents, after the common prefix:
+	std::string variant_source(std::string const &text, uint32_t features) {
+		std::string source = "#version 330\n";
+		for (auto const &feature : Features) {
+			if (features & feature.bit) source += "#define " + std::string(feature.define) + " 1\n";
+		}
+		source += FrameUniforms::declaration();
+		source += "#line 1\n";
+		source += text;
+		return source;
+	}
+
+	std::string shader_info_log(GLuint shader) {
+		GLint info_log_length = 0;
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &info_log_length);
+		std::vector< GLchar > info_log(info_log_length + 1, 0);
+		GLsizei length = 0;
+		glGetShaderInfoLog(shader, info_log.size(), &length, &info_log[0]);
+		return std::string(info_log.begin(), info_log.begin() + length);
+	}
+
+	std::string program_info_log(GLuint program) {
+		GLint info_log_length = 0;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &info_log_length);
+		std::vector< GLchar > info_log(info_log_length + 1, 0);
+		GLsizei length = 0;
+		glGetProgramInfoLog(program, info_log.size(), &length, &info_log[0]);
+		return std::string(info_log.begin(), info_log.begin() + length);
+	}
+
+	//note: will throw if any are missing
+	Meshes::Attributes lookup_attributes(GLuint program) {
+		Meshes::Attributes attributes;
+		attributes.Position = glGetAttribLocation(program, "Position");
+		if (attributes.Position == -1U) throw std::runtime_error("no attribute named Position");
+		attributes.Normal = glGetAttribLocation(program, "Normal");
+		if (attributes.Normal == -1U) throw std::runtime_error("no attribute named Normal");
+		attributes.Color = glGetAttribLocation(program, "Color");
+		if (attributes.Color == -1U) throw std::runtime_error("no attribute named Color");
+		return attributes;
+	}
+}
+
+SceneShader::SceneShader(GLState &gl, ProgramCache *cache_) : cache(cache_) {
+	vertex_text = read_file(VertexPath);
+	fragment_text = read_file(FragmentPath);
+
+	program = compile_variant(DefaultFeatures);
+
+	//look up attribute locations:
+	attributes = lookup_attributes(program);
+
+	//look up uniform locations:
+	hook_up(program, DefaultFeatures, gl);
+
+	variants.insert(std::make_pair(uint32_t(DefaultFeatures), program));
+
+	parallel_compile = has_extension("GL_KHR_parallel_shader_compile") || has_extension("GL_ARB_parallel_shader_compile");
+}
+
+GLuint SceneShader::variant(uint32_t features, GLState &gl) {
+	features &= AllFeatures;
+	auto f = variants.find(features);
+	if (f != variants.end()) return f->second;
+
+	GLuint built = 0;
+	try {
+		built = compile_variant(features);
+		hook_up(built, features, gl);
+	} catch (std::exception const &e) {
+		std::cerr << "WARNING: failed to build scene shader variant '" << describe(features) << "': " << e.what() << std::endl;
+		if (built) {
+			gl.forget_program(built); //(hook_up may have set uniforms through 'gl')
+			glDeleteProgram(built);
+		}
+		built = 0;
+	}
+	variants.insert(std::make_pair(features, built));
+	return built;
+}
+
+GLuint SceneShader::find(uint32_t features) const {
+	auto f = variants.find(features & AllFeatures);
+	return (f == variants.end() ? 0 : f->second);
+}
+
+void SceneShader::prewarm(std::string const &manifest, GLState &gl) {
+	//binaries of everything built here (and of the constructor's variant) are written to the cache in one go at the end:
+	std::ifstream file(manifest, std::ios::binary);
+	if (!file) {
+		if (cache) cache->flush();
+		return; //(nothing to prewarm)
+	}
+
+	std::string line;
+	uint32_t line_number = 0;
+	while (std::getline(file, line)) {
+		line_number += 1;
+		std::istringstream words(line.substr(0, line.find('#')));
+		std::string word;
+		uint32_t features = 0;
+		bool empty = true;
+		bool bad = false;
+		while (words >> word) {
+			empty = false;
+			if (word == "none") continue;
+			uint32_t bit = 0;
+			for (auto const &feature : Features) {
+				if (word == feature.name) bit = feature.bit;
+			}
+			if (bit == 0) {
+				std::cerr << "WARNING: unknown shader feature '" << word << "' on line " << line_number << " of '" << manifest << "'; skipping line." << std::endl;
+				bad = true;
+				break;
+			}
+			features |= bit;
+		}
+		if (!empty && !bad) variant(features, gl);
+	}
+	if (cache) cache->flush();
+}
+
+void SceneShader::reload(GLState &gl) {
+	std::string new_vertex_text = read_file(VertexPath);
+	std::string new_fragment_text = read_file(FragmentPath);
+
+	discard_pending(gl);
+	pending_vertex_text = new_vertex_text;
+	pending_fragment_text = new_fragment_text;
+
+	//submit everything, but don't ask for results (that would wait for the compiler):
+	auto submit = [](GLenum type, std::string const &source) {
+		GLuint shader = glCreateShader(type);
+		GLchar const *str = source.c_str();
+		GLint length = source.size();
+		glShaderSource(shader, 1, &str, &length);
+		glCompileShader(shader);
+		return shader;
+	};
+	for (auto const &kv : variants) {
+		//(variants that failed to build are left out, so they can't hold up the rest; see 'poll')
+		if (kv.second == 0) continue;
+		Pending &rebuild = pending[kv.first];
+		rebuild.vertex_shader = submit(GL_VERTEX_SHADER, variant_source(pending_vertex_text, kv.first));
+		rebuild.fragment_shader = submit(GL_FRAGMENT_SHADER, variant_source(pending_fragment_text, kv.first));
+		rebuild.program = glCreateProgram();
+		glAttachShader(rebuild.program, rebuild.vertex_shader);
+		glAttachShader(rebuild.program, rebuild.fragment_shader);
+		glLinkProgram(rebuild.program);
+	}
+}
+
+bool SceneShader::poll(GLState &gl) {
+	if (pending.empty()) return false;
+
+	if (parallel_compile) {
+		for (auto const &kv : pending) {
+			GLint done = GL_FALSE;
+			glGetProgramiv(kv.second.program, GL_COMPLETION_STATUS_ARB, &done); //(== GL_COMPLETION_STATUS_KHR)
+			if (done != GL_TRUE) return false;
+		}
+	}
+
+	try {
+		for (auto const &kv : pending) {
+			Pending const &rebuild = kv.second;
+			std::string variant_name = " (variant '" + describe(kv.first) + "')";
+			//report compile errors first (they're what the link log would complain about, less helpfully):
+			for (auto const &shader : { std::make_pair(rebuild.vertex_shader, VertexPath), std::make_pair(rebuild.fragment_shader, FragmentPath) }) {
+				GLint compile_status = GL_FALSE;
+				glGetShaderiv(shader.first, GL_COMPILE_STATUS, &compile_status);
+				if (compile_status != GL_TRUE) {
+					throw std::runtime_error("'" + std::string(shader.second) + "' failed to compile" + variant_name + ":\n" + shader_info_log(shader.first));
+				}
+			}
+			GLint link_status = GL_FALSE;
+			glGetProgramiv(rebuild.program, GL_LINK_STATUS, &link_status);
+			if (link_status != GL_TRUE) {
+				throw std::runtime_error("failed to link" + variant_name + ":\n" + program_info_log(rebuild.program));
+			}
+			hook_up(rebuild.program, kv.first, gl);
+		}
+	} catch (std::exception const &e) {
+		std::cerr << "Failed to reload shaders: " << e.what() << std::endl;
+		discard_pending(gl);
+		return false;
+	}
+
+	++generation;
+	for (auto const &kv : pending) {
+		GLuint &current = variants[kv.first];
+		if (current) {
+			Retired old;
+			old.program = current;
+			old.generation = generation;
+			retired.emplace_back(old);
+		}
+		current = kv.second.program;
+		glDeleteShader(kv.second.vertex_shader);
+		glDeleteShader(kv.second.fragment_shader);
+	}
+	pending.clear();
+	vertex_text.swap(pending_vertex_text);
+	fragment_text.swap(pending_fragment_text);
+	program = variants[DefaultFeatures];
+
+	//variants that failed to build get another try (from the new files) when next requested:
+	for (auto v = variants.begin(); v != variants.end(); ) {
+		if (v->second == 0) v = variants.erase(v);
+		else ++v;
+	}
+	return true;
+}
+
+void SceneShader::retire(uint32_t drawn, GLState &gl) {
+	for (auto r = retired.begin(); r != retired.end(); ) {
+		if (r->generation <= drawn) {
+			gl.forget_program(r->program); //(so 'gl' doesn't skip binding, or setting uniforms in, a program that reuses the name)
+			glDeleteProgram(r->program);
+			r = retired.erase(r);
+		} else {
+			++r;
+		}
+	}
+}
+
+GLuint SceneShader::compile_variant(uint32_t features) const {
+	std::string vertex_source = variant_source(vertex_text, features);
+	std::string fragment_source = variant_source(fragment_text, features);
+	if (cache) {
+		return cache->program(vertex_source, fragment_source);
+	} else {
+		GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, vertex_source);
+		GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER, fragment_source);
+		return link_program(fragment_shader, vertex_shader);
+	}
+}
+
+void SceneShader::hook_up(GLuint program, uint32_t features, GLState &gl) const {
+	//vertex arrays are shared by every variant, so attributes (where used) must be where they were:
+	for (auto const &attribute : { std::make_pair("Position", attributes.Position), std::make_pair("Normal", attributes.Normal), std::make_pair("Color", attributes.Color) }) {
+		GLint location = glGetAttribLocation(program, attribute.first);
+		if (location != -1 && GLuint(location) != attribute.second) {
+			throw std::runtime_error("attribute locations changed (restart to pick up this edit)");
+		}
+	}
+
+	FrameUniforms::attach(program);
+
+	//(variants without point lights don't use every light buffer)
+	LightClusters::attach(program, gl, !(features & PointLights));
+}
+
+void SceneShader::discard_pending(GLState &gl) {
+	for (auto const &kv : pending) {
+		gl.forget_program(kv.second.program); //('poll' may have hooked it up before a later variant failed)
+		glDeleteProgram(kv.second.program);
+		glDeleteShader(kv.second.vertex_shader);
+		glDeleteShader(kv.second.fragment_shader);
+	}
+	pending.clear();
+}
+
+GLuint compile_shader(GLenum type, std::string const &source) {
+	GLuint shader = glCreateShader(type);
+	GLchar const *str = source.c_str();
+	GLint length = source.size();
+	glShaderSource(shader, 1, &str, &length);
+	glCompileShader(shader);
+	GLint compile_status = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compile_status);
+	if (compile_status != GL_TRUE) {
+		std::cerr << "Failed to compile shader." << std::endl;
+		std::cerr << "Info log: " << shader_info_log(shader);
+		glDeleteShader(shader);
+		throw std::runtime_error("Failed to compile shader.");
+	}
+	return shader;
+}
+
+GLuint link_program(GLuint fragment_shader, GLuint vertex_shader, GLuint program) {
+	if (program == 0) program = glCreateProgram();
+	glAttachShader(program, vertex_shader);
+	glAttachShader(program, fragment_shader);
+	glLinkProgram(program);
+	GLint link_status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+	if (link_status != GL_TRUE) {
+		std::cerr << "Failed to link shader program." << std::endl;
+		std::cerr << "Info log: " << program_info_log(program);
+		throw std::runtime_error("Failed to link program");
+	}
+	return program;
+}
+
+bool has_extension(char const *name) {
+	GLint extensions = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+	for (GLint i = 0; i < extensions; ++i) {
+		GLubyte const *extension = glGetStringi(GL_EXTENSIONS, GLuint(i));
+		if (extension && std::strcmp(reinterpret_cast< char const * >(extension), name) == 0) return true;
+	}
+	return false;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "GL.hpp"
+#include "Meshes.hpp"
+
+#include <map>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+struct GLState;
+struct ProgramCache;
+
+//"SceneShader" is the program scene objects are drawn with: instanced (see InstanceBuffer.hpp),
+// reading the "Frame" block (FrameUniforms.hpp) and lit by LightClusters.
+//Shared by the game and the offline tools so they all render the same way.
+//Source lives in VertexPath and FragmentPath (relative to the working directory, i.e., 'dist'); "#version 330",
+// the #defines for the variant's features, and the Frame block declaration are prepended,
+// with a "#line 1" so compile errors point at lines in the files.
+//
+//Variants: each Feature is #define-selected, so a variant only pays for what it uses (rather than branching at runtime).
+// Variants are keyed by their feature bits, and built on first request or ahead of time from a manifest;
+// Scene picks one per draw from each object's features (see Scene::variants).
+//
+//Hot reload: 'reload' starts compiling the files again for every variant built so far, without waiting for the result,
+// and 'poll' swaps the new programs in once they have all linked (with KHR/ARB_parallel_shader_compile the driver compiles
+// on its own threads and 'poll' never blocks; otherwise the first 'poll' waits for the driver). If any variant fails to
+// compile or link, or moved an attribute (vertex arrays were set up with the old locations), the errors are reported
+// and drawing carries on with the old programs.
+// Variants that had failed to build aren't part of the rebuild (so they can't block it); after a successful swap they are
+// built from the new files when next requested.
+
+struct SceneShader {
+	//read, compile and link the DefaultFeatures variant (or fetch it from 'cache', if given), and hook up uniforms:
+	// note: will throw on missing files or compile or link errors.
+	SceneShader(GLState &gl, ProgramCache *cache = nullptr);
+
+	static char const *VertexPath; //"shaders/scene.vert"
+	static char const *FragmentPath; //"shaders/scene.frag"
+
+	enum Feature : uint32_t {
+		DirectionalLights = (1 << 0), //DIRECTIONAL_LIGHTS, "directional"
+		PointLights = (1 << 1), //POINT_LIGHTS, "point"
+		Fog = (1 << 2), //FOG, "fog"
+		AllFeatures = (1 << 3) - 1,
+		DefaultFeatures = DirectionalLights | PointLights,
+	};
+
+	GLuint program = 0; //the DefaultFeatures variant
+
+	//vertex attribute locations (for Meshes::load; the same in every variant):
+	Meshes::Attributes attributes;
+
+	//variant with exactly 'features' (bits outside AllFeatures are ignored), built -- blocking -- on first request:
+	// if it fails to build, reports why and returns 0 (until the next successful reload).
+	GLuint variant(uint32_t features, GLState &gl);
+	//variant that has already been built, or 0; makes no GL calls, so may be called from any thread while nothing is being built:
+	GLuint find(uint32_t features) const;
+	//build the variants listed in a manifest file, one per line as feature names separated by spaces
+	// ("none" for no features; '#' starts a comment); a missing manifest is not an error. Flushes 'cache' at the end.
+	// note: reports (and skips) lines with unknown names.
+	void prewarm(std::string const &manifest, GLState &gl);
+
+	//start rebuilding from the files (replacing any rebuild still in progress):
+	// note: will throw if the files can't be read.
+	void reload(GLState &gl);
+	//if a rebuild finished: returns true if it succeeded, in which case 'program' and every variant are the new programs.
+	// The old programs are retired as of the new 'generation' (snapshots may still name them).
+	bool poll(GLState &gl);
+
+	//delete programs retired as of generation 'drawn' or earlier, once nothing will draw with them again
+	// (i.e., after drawing a snapshot taken with every object re-pointed at generation 'drawn' programs):
+	void retire(uint32_t drawn, GLState &gl);
+	uint32_t generation = 0; //bumped whenever 'poll' swaps in new programs
+
+	//internals:
+	ProgramCache *cache = nullptr;
+	std::string vertex_text, fragment_text; //file contents the built variants came from
+	std::map< uint32_t, GLuint > variants; //features -> program (0 if it failed to build)
+	bool parallel_compile = false; //driver supports GL_COMPLETION_STATUS queries
+	struct Pending {
+		GLuint vertex_shader = 0;
+		GLuint fragment_shader = 0;
+		GLuint program = 0;
+	};
+	std::map< uint32_t, Pending > pending; //features -> rebuild in progress
+	std::string pending_vertex_text, pending_fragment_text;
+	GLuint compile_variant(uint32_t features) const; //(throws on failure)
+	void hook_up(GLuint program, uint32_t features, GLState &gl) const; //check attributes and set up uniforms (throws on failure)
+	void discard_pending(GLState &gl); //delete programs and shaders of the rebuild in progress
+	struct Retired {
+		GLuint program = 0;
+		uint32_t generation = 0; //'generation' as of retiring
+	};
+	std::vector< Retired > retired;
+};
+
+//helpers:
+//note: these throw (after printing the info log) on failure.
+GLuint compile_shader(GLenum type, std::string const &source);
+//links into 'program' if given (so parameters can be set first), otherwise into a new program:
+GLuint link_program(GLuint fragment_shader, GLuint vertex_shader, GLuint program = 0);
+
+//does the current context advertise extension 'name'?
+bool has_extension(char const *name);
@@ -0,0 +1,136 @@
+#include "Screenshots.hpp"
+#include "load_save_png.hpp"
+
+#include <iostream>
+#include <cstring>
+#include <stdexcept>
+
+Screenshots::Screenshots() {
+	for (auto &slot : slots) {
+		glGenBuffers(1, &slot.buffer);
+	}
+	thread = std::thread(&Screenshots::run, this);
+}
+
+Screenshots::~Screenshots() {
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		quit = true;
+	}
+	wake.notify_all();
+	thread.join();
+
+	for (auto &slot : slots) {
+		if (slot.fence) glDeleteSync(slot.fence);
+		glDeleteBuffers(1, &slot.buffer);
+	}
+}
+
+bool Screenshots::capture(std::string const &filename, glm::uvec2 const &size) {
+	Slot *slot = nullptr;
+	for (auto &s : slots) {
+		if (!s.fence) {
+			slot = &s;
+			break;
+		}
+	}
+	if (!slot) {
+		dropped += 1;
+		std::cerr << "WARNING: screenshot '" << filename << "' dropped (all " << Slots << " readback buffers are busy)." << std::endl;
+		return false;
+	}
+
+	slot->filename = filename;
+	slot->size = size;
+
+	//(re)size storage only when needed, then read into it -- with a pack buffer bound, glReadPixels returns right away:
+	GLsizeiptr bytes = GLsizeiptr(size.x) * size.y * 4;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+	if (slot->allocated != bytes) {
+		glBufferData(GL_PIXEL_PACK_BUFFER, bytes, NULL, GL_STREAM_READ);
+		slot->allocated = bytes;
+	}
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadBuffer(GL_BACK);
+	glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	return true;
+}
+
+void Screenshots::poll() {
+	for (auto &slot : slots) {
+		if (!slot.fence) continue;
+		//only collect readbacks that are already done (never wait):
+		GLenum result = glClientWaitSync(slot.fence, 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED) continue;
+		glDeleteSync(slot.fence);
+		slot.fence = 0;
+		if (result == GL_WAIT_FAILED) {
+			std::cerr << "WARNING: screenshot '" << slot.filename << "' lost (glClientWaitSync failed)." << std::endl;
+			continue;
+		}
+
+		Job job;
+		job.filename = slot.filename;
+		job.size = slot.size;
+		job.pixels.resize(slot.size.x * slot.size.y);
+		GLsizeiptr bytes = GLsizeiptr(job.pixels.size()) * 4;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		void const *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+		if (mapped) {
+			std::memcpy(job.pixels.data(), mapped, bytes);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		if (!mapped) {
+			std::cerr << "WARNING: screenshot '" << slot.filename << "' lost (couldn't map readback buffer)." << std::endl;
+			continue;
+		}
+
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			jobs.emplace_back(std::move(job));
+		}
+		wake.notify_one();
+	}
+}
+
+void Screenshots::flush() {
+	for (auto &slot : slots) {
+		if (!slot.fence) continue;
+		GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		while (glClientWaitSync(slot.fence, flags, 1000000000ULL /* 1s */) == GL_TIMEOUT_EXPIRED) {
+			flags = 0;
+		}
+	}
+	poll();
+}
+
+void Screenshots::run() {
+	while (true) {
+		Job job;
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			wake.wait(lock, [this]() { return quit || !jobs.empty(); });
+			//(finish writing everything queued before quitting)
+			if (jobs.empty()) return;
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		//alpha is whatever the clear left; screenshots are saved opaque:
+		for (auto &px : job.pixels) px |= 0xff000000;
+		try {
+			save_png_fast(job.filename, job.size.x, job.size.y, job.pixels.data(), LowerLeftOrigin);
+		} catch (std::exception const &e) {
+			std::cerr << "WARNING: failed to write screenshot '" << job.filename << "': " << e.what() << std::endl;
+			continue;
+		}
+		std::cout << "Saved screenshot '" << job.filename << "'." << std::endl;
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			saved += 1;
+		}
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+//"Screenshots" captures the back buffer to PNG files without stalling rendering:
+// 'capture' starts an asynchronous glReadPixels into one of a few pixel-pack buffers and fences it;
+// 'poll' (called every frame) copies out readbacks whose fences have signaled -- normally a frame or two later --
+// and hands them to a background thread that writes the file (save_png_fast flips rows as it goes).
+//If every buffer is still in flight, the capture is dropped with a warning rather than waiting.
+
+struct Screenshots {
+	Screenshots();
+	Screenshots(Screenshots const &) = delete;
+	//(waits for queued files to be written)
+	~Screenshots();
+
+	enum : uint32_t { Slots = 3 };
+
+	//read the current back buffer (lower-left 'size' pixels) for saving to 'filename':
+	// call after drawing and before swapping; returns false if the capture was dropped.
+	bool capture(std::string const &filename, glm::uvec2 const &size);
+
+	//pass finished readbacks to the saving thread (call once per frame, with the context current):
+	void poll();
+	//wait for every readback in flight, then pass them on (e.g., before the context goes away):
+	void flush();
+
+	//counts since construction:
+	uint32_t saved = 0; //(written by the saving thread)
+	uint32_t dropped = 0;
+
+	//internals:
+	struct Slot {
+		GLuint buffer = 0;
+		GLsizeiptr allocated = 0; //bytes of storage in 'buffer'
+		GLsync fence = 0; //non-zero while a readback is in flight
+		std::string filename;
+		glm::uvec2 size = glm::uvec2(0);
+	};
+	Slot slots[Slots];
+
+	struct Job {
+		std::string filename;
+		glm::uvec2 size = glm::uvec2(0);
+		std::vector< uint32_t > pixels; //bottom row first
+	};
+	void run();
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque< Job > jobs;
+	bool quit = false;
+};
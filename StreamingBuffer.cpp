@@ -0,0 +1,104 @@
+#include "StreamingBuffer.hpp"
+
+#include <stdexcept>
+#include <cstring>
+#include <iostream>
+
+StreamingBuffer::StreamingBuffer(GLsizeiptr frame_size_) : frame_size(frame_size_) {
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, frame_size * Frames, NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+StreamingBuffer::~StreamingBuffer() {
+	for (auto &fence : fences) {
+		if (fence) glDeleteSync(fence);
+		fence = 0;
+	}
+	glDeleteBuffers(1, &buffer);
+}
+
+void StreamingBuffer::begin_frame(GLsizeiptr reserve) {
+	frame = (frame + 1) % Frames;
+	head = 0;
+
+	if (reserve > frame_size) {
+		grow(reserve); //(drops every fence, including this region's)
+		return;
+	}
+
+	GLsync &fence = fences[frame];
+	if (!fence) return;
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	if (result == GL_TIMEOUT_EXPIRED) {
+		waits += 1;
+		//flush on the first wait so the fence is sure to signal eventually:
+		GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		do {
+			result = glClientWaitSync(fence, flags, 1000000000ULL /* 1s */);
+			flags = 0;
+		} while (result == GL_TIMEOUT_EXPIRED);
+	}
+	if (result == GL_WAIT_FAILED) {
+		throw std::runtime_error("glClientWaitSync failed on streaming buffer fence.");
+	}
+	glDeleteSync(fence);
+	fence = 0;
+}
+
+void StreamingBuffer::end_frame() {
+	if (fences[frame]) glDeleteSync(fences[frame]);
+	fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void StreamingBuffer::grow(GLsizeiptr at_least) {
+	grows += 1;
+	if (head != 0) {
+		std::cerr << "WARNING: streaming buffer grew mid-frame, invalidating this frame's earlier allocations (reserve more in begin_frame)." << std::endl;
+	}
+	while (frame_size < at_least) frame_size *= 2;
+	frame_size *= 2;
+
+	//fresh storage (the old storage lives on until the GPU is done with it), so no region is in flight:
+	for (auto &fence : fences) {
+		if (fence) glDeleteSync(fence);
+		fence = 0;
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, frame_size * Frames, NULL, GL_STREAM_DRAW);
+	head = 0;
+}
+
+void *StreamingBuffer::map(GLsizeiptr size, GLsizeiptr alignment, GLintptr *offset) {
+	if (alignment < 1) alignment = 1;
+	GLsizeiptr start = (head + alignment - 1) / alignment * alignment;
+	if (start + size > frame_size) {
+		grow(size + alignment);
+		start = 0;
+	}
+	head = start + size;
+
+	*offset = GLintptr(frame) * frame_size + start;
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	void *data = glMapBufferRange(GL_COPY_WRITE_BUFFER, *offset, size,
+		GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+	if (!data) throw std::runtime_error("glMapBufferRange failed on streaming buffer.");
+	return data;
+}
+
+void StreamingBuffer::unmap() {
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	if (glUnmapBuffer(GL_COPY_WRITE_BUFFER) == GL_FALSE) {
+		//(data store contents became undefined -- e.g., display mode change -- next frame will rewrite them)
+		std::cerr << "WARNING: streaming buffer contents lost during unmap." << std::endl;
+	}
+}
+
+GLintptr StreamingBuffer::write(void const *data, GLsizeiptr size, GLsizeiptr alignment) {
+	GLintptr offset = 0;
+	if (size == 0) return offset;
+	std::memcpy(map(size, alignment, &offset), data, size_t(size));
+	unmap();
+	return offset;
+}
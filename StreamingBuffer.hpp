@@ -0,0 +1,51 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <cstdint>
+
+//"StreamingBuffer" sub-allocates per-frame dynamic data (instance data, uniform blocks, ...) from one large buffer.
+// The buffer is split into one region per frame in flight; each frame writes into its own region
+// through unsynchronized glMapBufferRange, and a fence placed at the end of the frame is waited on
+// before that region is reused (Frames frames later).
+//Mapping goes through GL_COPY_WRITE_BUFFER, so other buffer bindings are left alone; bind 'buffer'
+// wherever the data is needed (e.g., glBindBufferRange, glVertexAttribPointer offsets).
+
+struct StreamingBuffer {
+	StreamingBuffer(GLsizeiptr frame_size = 1 << 20);
+	StreamingBuffer(StreamingBuffer const &) = delete;
+	~StreamingBuffer();
+
+	enum : uint32_t { Frames = 3 };
+
+	//move to the next frame's region (waiting for the GPU to finish with it, if needed):
+	// if 'reserve' is more than a region holds, the buffer grows now, before anything is allocated
+	// (pass an upper bound on the frame's total use, so allocations made early in the frame stay valid).
+	void begin_frame(GLsizeiptr reserve = 0);
+	//fence off the current frame's region:
+	void end_frame();
+
+	//reserve 'size' bytes (offset a multiple of 'alignment') and map them for writing:
+	// returns a pointer to write through and sets *offset to the data's position in 'buffer'.
+	// note: if the frame runs out of room, the buffer is re-specified at twice the size, which
+	//  invalidates earlier offsets -- so finish using one allocation (bind it, draw with it) before making the next.
+	void *map(GLsizeiptr size, GLsizeiptr alignment, GLintptr *offset);
+	//unmap after writing (must be called before drawing):
+	void unmap();
+
+	//map + copy + unmap:
+	GLintptr write(void const *data, GLsizeiptr size, GLsizeiptr alignment = 16);
+
+	GLuint buffer = 0;
+
+	//counts since construction:
+	uint32_t waits = 0; //begin_frame had to wait on the GPU
+	uint32_t grows = 0; //a frame ran out of room
+
+	//internals:
+	GLsizeiptr frame_size;
+	uint32_t frame = 0; //index of the current region
+	GLsizeiptr head = 0; //next free byte in the current region
+	GLsync fences[Frames] = { 0, 0, 0 };
+	void grow(GLsizeiptr at_least);
+};
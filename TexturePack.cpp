@@ -0,0 +1,319 @@
+#include "TexturePack.hpp"
+#include "WorkerPool.hpp"
+#include "load_save_png.hpp"
+#include "read_chunk.hpp"
+#include "write_chunk.hpp"
+#include "fnv1a.hpp"
+
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+namespace {
+	uint32_t round_up(uint32_t value, uint32_t align) {
+		return (value + align - 1) / align * align;
+	}
+}
+
+void TexturePack::clear() {
+	pages.clear();
+	entries.clear();
+	storage.clear();
+	mapping.reset();
+}
+
+void TexturePack::build(std::vector< std::string > const &paths, WorkerPool &workers, Settings const &settings,
+	std::function< bool(uint64_t hash) > const &known) {
+	clear();
+
+	struct Job {
+		std::unique_ptr< MappedFile > file;
+		uint64_t hash = 0;
+		std::string error;
+		uint32_t first = -1U; //job with the same contents that gets decoded (-1U if known)
+		glm::uvec2 size = glm::uvec2(0);
+		std::vector< uint32_t > pixels;
+		std::vector< std::vector< uint32_t > > mips; //(stand-alone pages only)
+		bool atlased = false;
+		uint32_t page = -1U;
+		glm::uvec2 slot_at = glm::uvec2(0);
+		glm::uvec2 slot_size = glm::uvec2(0);
+	};
+	std::vector< Job > jobs(paths.size());
+	auto check = [&]() {
+		for (uint32_t i = 0; i < jobs.size(); ++i) {
+			if (!jobs[i].error.empty()) throw std::runtime_error("Failed to load texture '" + paths[i] + "': " + jobs[i].error);
+		}
+	};
+
+	//map and hash every file:
+	workers.parallel_for(uint32_t(jobs.size()), [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i) {
+			try {
+				jobs[i].file.reset(new MappedFile(paths[i]));
+				jobs[i].hash = fnv1a(jobs[i].file->data, jobs[i].file->size);
+			} catch (std::exception const &e) {
+				jobs[i].error = e.what();
+			}
+		}
+	});
+	check();
+
+	//decode only contents that aren't known, once each:
+	{
+		std::unordered_map< uint64_t, uint32_t > first_with_hash;
+		for (uint32_t i = 0; i < jobs.size(); ++i) {
+			Job &job = jobs[i];
+			if (!(known && known(job.hash))) {
+				job.first = first_with_hash.insert(std::make_pair(job.hash, i)).first->second;
+			}
+			if (job.first != i) job.file.reset();
+		}
+	}
+
+	workers.parallel_for(uint32_t(jobs.size()), [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i) {
+			Job &job = jobs[i];
+			if (job.first != i) continue;
+			//(GL wants the bottom row first)
+			bool ok = load_png(job.file->data, job.file->size, &job.size.x, &job.size.y, [&job](unsigned int width, unsigned int height) {
+				job.pixels.resize(size_t(width) * height);
+				return job.pixels.data();
+			}, LowerLeftOrigin);
+			job.file.reset();
+			if (!ok) {
+				job.error = "not a readable png.";
+				continue;
+			}
+			job.atlased = (job.size.x <= settings.atlas_max_image && job.size.y <= settings.atlas_max_image);
+			if (!job.atlased) {
+				job.mips = build_mips(job.pixels.data(), job.size, mip_levels(job.size), settings.filter);
+			}
+		}
+	});
+	check();
+
+	//pack atlased images onto shelves, tallest first:
+	std::vector< std::vector< uint32_t > > atlas_pixels;
+	{
+		std::vector< uint32_t > order;
+		uint32_t width = round_up(settings.atlas_width, AtlasAlign);
+		for (uint32_t i = 0; i < jobs.size(); ++i) {
+			Job &job = jobs[i];
+			if (!(job.first == i && job.atlased)) continue;
+			job.slot_size.x = round_up(job.size.x + 2 * AtlasGutter, AtlasAlign);
+			job.slot_size.y = round_up(job.size.y + 2 * AtlasGutter, AtlasAlign);
+			width = std::max(width, job.slot_size.x);
+			order.emplace_back(i);
+		}
+		std::stable_sort(order.begin(), order.end(), [&jobs](uint32_t a, uint32_t b) {
+			return jobs[a].slot_size.y > jobs[b].slot_size.y;
+		});
+
+		uint32_t const max_height = width;
+		glm::uvec2 at = glm::uvec2(0);
+		uint32_t shelf_height = 0;
+		for (uint32_t i : order) {
+			Job &job = jobs[i];
+			if (at.x + job.slot_size.x > width) {
+				at = glm::uvec2(0, at.y + shelf_height);
+				shelf_height = 0;
+			}
+			if (pages.empty() || at.y + job.slot_size.y > max_height) {
+				pages.emplace_back();
+				pages.back().size.x = width;
+				pages.back().atlas = true;
+				at = glm::uvec2(0);
+				shelf_height = 0;
+			}
+			job.page = uint32_t(pages.size() - 1);
+			job.slot_at = at;
+			at.x += job.slot_size.x;
+			shelf_height = std::max(shelf_height, job.slot_size.y);
+			pages.back().size.y = std::max(pages.back().size.y, at.y + job.slot_size.y);
+		}
+	}
+	atlas_pixels.resize(pages.size());
+	for (uint32_t p = 0; p < pages.size(); ++p) {
+		atlas_pixels[p].assign(size_t(pages[p].size.x) * pages[p].size.y, 0);
+	}
+
+	//copy images into their slots (slots don't overlap, so any split works), repeating edges out to the slot's border:
+	workers.parallel_for(uint32_t(jobs.size()), [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i) {
+			Job &job = jobs[i];
+			if (!(job.first == i && job.atlased)) continue;
+			uint32_t atlas_width = pages[job.page].size.x;
+			for (uint32_t sy = 0; sy < job.slot_size.y; ++sy) {
+				uint32_t y = uint32_t(std::min(std::max(int32_t(sy) - int32_t(AtlasGutter), 0), int32_t(job.size.y) - 1));
+				uint32_t const *from = &job.pixels[size_t(y) * job.size.x];
+				uint32_t *to = &atlas_pixels[job.page][size_t(job.slot_at.y + sy) * atlas_width + job.slot_at.x];
+				std::fill(to, to + AtlasGutter, from[0]);
+				std::memcpy(to + AtlasGutter, from, job.size.x * sizeof(uint32_t));
+				std::fill(to + AtlasGutter + job.size.x, to + job.slot_size.x, from[job.size.x - 1]);
+			}
+			std::vector< uint32_t >().swap(job.pixels);
+		}
+	});
+
+	std::vector< std::vector< std::vector< uint32_t > > > atlas_mips(pages.size());
+	workers.parallel_for(uint32_t(pages.size()), [&](uint32_t begin, uint32_t end) {
+		for (uint32_t p = begin; p < end; ++p) {
+			uint32_t levels = std::min(uint32_t(AtlasLevels), mip_levels(pages[p].size));
+			atlas_mips[p] = build_mips(atlas_pixels[p].data(), pages[p].size, levels, BoxFilter);
+		}
+	});
+
+	//hand level data over to 'storage' (moving vectors keeps their data where it is):
+	auto keep = [this](Page *page, std::vector< uint32_t > &level0, std::vector< std::vector< uint32_t > > &mips) {
+		storage.emplace_back(std::move(level0));
+		page->levels.emplace_back(storage.back().data());
+		for (auto &mip : mips) {
+			storage.emplace_back(std::move(mip));
+			page->levels.emplace_back(storage.back().data());
+		}
+	};
+	for (uint32_t p = 0; p < pages.size(); ++p) {
+		keep(&pages[p], atlas_pixels[p], atlas_mips[p]);
+	}
+	for (uint32_t i = 0; i < jobs.size(); ++i) {
+		Job &job = jobs[i];
+		if (!(job.first == i && !job.atlased)) continue;
+		job.page = uint32_t(pages.size());
+		pages.emplace_back();
+		pages.back().size = job.size;
+		keep(&pages.back(), job.pixels, job.mips);
+	}
+
+	entries.resize(jobs.size());
+	for (uint32_t i = 0; i < jobs.size(); ++i) {
+		Entry &entry = entries[i];
+		entry.name = paths[i];
+		entry.hash = jobs[i].hash;
+		if (jobs[i].first == -1U) continue;
+		Job const &job = jobs[jobs[i].first];
+		entry.page = job.page;
+		entry.size = job.size;
+		if (job.atlased) {
+			glm::vec2 page_size = glm::vec2(pages[job.page].size);
+			entry.uv_rect = glm::vec4(
+				glm::vec2(job.slot_at + glm::uvec2(AtlasGutter)) / page_size,
+				glm::vec2(job.size) / page_size
+			);
+		}
+	}
+}
+
+void TexturePack::save(std::string const &filename) const {
+	std::vector< char > strings;
+	std::vector< PackedEntry > packed_entries;
+	for (auto const &entry : entries) {
+		if (entry.page == -1U) throw std::runtime_error("Can't save texture '" + entry.name + "', which wasn't built into the pack.");
+		PackedEntry packed;
+		packed.name_begin = uint32_t(strings.size());
+		strings.insert(strings.end(), entry.name.begin(), entry.name.end());
+		packed.name_end = uint32_t(strings.size());
+		packed.hash_low = uint32_t(entry.hash);
+		packed.hash_high = uint32_t(entry.hash >> 32);
+		packed.page = entry.page;
+		packed.width = entry.size.x;
+		packed.height = entry.size.y;
+		for (uint32_t i = 0; i < 4; ++i) packed.uv_rect[i] = entry.uv_rect[i];
+		packed_entries.emplace_back(packed);
+	}
+	//pad so the chunks that follow stay aligned for in-place reads:
+	strings.resize((strings.size() + 3) / 4 * 4, '\0');
+
+	std::vector< PackedPage > packed_pages;
+	std::vector< PackedLevel > packed_levels;
+	std::vector< uint32_t > pixels;
+	for (auto const &page : pages) {
+		PackedPage packed;
+		packed.width = page.size.x;
+		packed.height = page.size.y;
+		packed.levels = uint32_t(page.levels.size());
+		packed.flags = (page.atlas ? 1 : 0);
+		packed_pages.emplace_back(packed);
+		glm::uvec2 size = page.size;
+		for (auto const &level : page.levels) {
+			PackedLevel packed_level;
+			packed_level.width = size.x;
+			packed_level.height = size.y;
+			packed_level.first = uint32_t(pixels.size());
+			packed_levels.emplace_back(packed_level);
+			pixels.insert(pixels.end(), level, level + size_t(size.x) * size.y);
+			size = mip_size(size);
+		}
+	}
+
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) throw std::runtime_error("Failed to open '" + filename + "' for writing.");
+	write_chunk(file, "str0", strings);
+	write_chunk(file, "tpe0", packed_entries);
+	write_chunk(file, "tpg0", packed_pages);
+	write_chunk(file, "tpl0", packed_levels);
+	write_chunk(file, "tpx0", pixels);
+	if (!file.flush()) throw std::runtime_error("Failed to write '" + filename + "'.");
+}
+
+void TexturePack::load(std::string const &filename) {
+	clear();
+	mapping.reset(new MappedFile(filename));
+	char const *at = mapping->data;
+	char const *end = mapping->data + mapping->size;
+	if (!at) throw std::runtime_error("Texture pack '" + filename + "' is empty.");
+
+	char const *strings; size_t strings_size;
+	read_chunk(&at, end, "str0", &strings, &strings_size);
+	PackedEntry const *packed_entries; size_t entry_count;
+	read_chunk(&at, end, "tpe0", &packed_entries, &entry_count);
+	PackedPage const *packed_pages; size_t page_count;
+	read_chunk(&at, end, "tpg0", &packed_pages, &page_count);
+	PackedLevel const *packed_levels; size_t level_count;
+	read_chunk(&at, end, "tpl0", &packed_levels, &level_count);
+	uint32_t const *pixels; size_t pixel_count;
+	read_chunk(&at, end, "tpx0", &pixels, &pixel_count);
+	if (at != end) {
+		std::cerr << "WARNING: trailing data in texture pack '" << filename << "'" << std::endl;
+	}
+
+	size_t level = 0;
+	for (size_t p = 0; p < page_count; ++p) {
+		PackedPage const &packed = packed_pages[p];
+		Page page;
+		page.size = glm::uvec2(packed.width, packed.height);
+		page.atlas = (packed.flags & 1) != 0;
+		glm::uvec2 size = page.size;
+		for (uint32_t l = 0; l < packed.levels; ++l, ++level) {
+			if (level >= level_count) throw std::runtime_error("Texture pack '" + filename + "' has too few levels.");
+			PackedLevel const &packed_level = packed_levels[level];
+			if (glm::uvec2(packed_level.width, packed_level.height) != size
+			 || packed_level.first > pixel_count || size_t(size.x) * size.y > pixel_count - packed_level.first) {
+				throw std::runtime_error("Texture pack '" + filename + "' has a malformed level.");
+			}
+			page.levels.emplace_back(pixels + packed_level.first);
+			size = mip_size(size);
+		}
+		pages.emplace_back(page);
+	}
+
+	for (size_t i = 0; i < entry_count; ++i) {
+		PackedEntry const &packed = packed_entries[i];
+		if (!(packed.name_begin <= packed.name_end && packed.name_end <= strings_size)) {
+			throw std::runtime_error("Texture pack '" + filename + "' has an entry with out-of-range name begin/end.");
+		}
+		if (packed.page >= pages.size()) {
+			throw std::runtime_error("Texture pack '" + filename + "' has an entry with an out-of-range page.");
+		}
+		Entry entry;
+		entry.name = std::string(strings + packed.name_begin, strings + packed.name_end);
+		entry.hash = uint64_t(packed.hash_low) | (uint64_t(packed.hash_high) << 32);
+		entry.page = packed.page;
+		entry.uv_rect = glm::vec4(packed.uv_rect[0], packed.uv_rect[1], packed.uv_rect[2], packed.uv_rect[3]);
+		entry.size = glm::uvec2(packed.width, packed.height);
+		entries.emplace_back(entry);
+	}
+}
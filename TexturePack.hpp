@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Mipmaps.hpp"
+#include "MappedFile.hpp"
+
+#include <glm/glm.hpp>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+struct WorkerPool;
+
+//"TexturePack" is a set of images made ready for upload: decoded, flipped bottom-row-first (as GL wants),
+// packed into pages -- shared atlases for small images, pages of their own for large ones -- and mipmapped.
+// A pack is either built from PNG files (on worker threads), or mapped from a container file written by
+// 'save' (see pack-textures.cpp), in which case the level data points straight into the mapping.
+//
+//Container format (chunks as in read_chunk.hpp, native byte order; every chunk stays 4-byte aligned):
+// "str0": entry names
+// "tpe0": PackedEntry per image
+// "tpg0": PackedPage per page
+// "tpl0": PackedLevel per mip level, pages' levels in order
+// "tpx0": RGBA8 pixels for every level (rows are tightly packed, which meets GL's default 4-byte unpack alignment)
+
+struct TexturePack {
+	struct Settings {
+		MipFilter filter = KaiserFilter; //for stand-alone pages; atlases always use BoxFilter (see below)
+		uint32_t atlas_width = 2048; //(atlas height is trimmed to what gets used)
+		uint32_t atlas_max_image = 256; //images larger than this in either dimension get a page of their own
+	};
+	enum : uint32_t {
+		AtlasAlign = 16, //atlas slots start and end on multiples of this, so the first
+		AtlasLevels = 5, // this-many box-filtered levels never mix pixels from different slots
+		AtlasGutter = 2, //edge pixels repeated around each image in its slot, against bilinear bleeding
+	};
+
+	struct Page {
+		glm::uvec2 size = glm::uvec2(0); //of level 0
+		bool atlas = false; //atlases should clamp; stand-alone pages may repeat
+		std::vector< uint32_t const * > levels; //pixels of each mip level, bottom row first
+	};
+	struct Entry {
+		std::string name; //path the image was built from
+		uint64_t hash = 0; //of the PNG file's contents (FNV-1a)
+		uint32_t page = -1U; //-1U if the image wasn't built (see 'build')
+		glm::vec4 uv_rect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f); //maps image uvs into the page: uv * zw + xy
+		glm::uvec2 size = glm::uvec2(0); //of the image, in pixels
+	};
+	std::vector< Page > pages;
+	std::vector< Entry > entries;
+
+	//build from PNG files (one entry per path, in order; identical contents share one image):
+	// contents for which 'known(hash)' returns true are hashed but not decoded, and their entries get page -1U.
+	// note: will throw if any file fails to load.
+	void build(std::vector< std::string > const &paths, WorkerPool &workers, Settings const &settings,
+		std::function< bool(uint64_t hash) > const &known = nullptr);
+
+	//write as a container file:
+	// note: will throw on failure.
+	void save(std::string const &filename) const;
+	//map a container file (the mapping lasts as long as this pack, or until the next build/load):
+	// note: will throw if the file is missing or malformed.
+	void load(std::string const &filename);
+
+	struct PackedEntry {
+		uint32_t name_begin, name_end;
+		uint32_t hash_low, hash_high;
+		uint32_t page;
+		uint32_t width, height;
+		float uv_rect[4];
+	};
+	static_assert(sizeof(PackedEntry) == 4 * 11, "PackedEntry is packed.");
+	struct PackedPage {
+		uint32_t width, height;
+		uint32_t levels;
+		uint32_t flags; //bit 0: atlas
+	};
+	static_assert(sizeof(PackedPage) == 4 * 4, "PackedPage is packed.");
+	struct PackedLevel {
+		uint32_t width, height;
+		uint32_t first; //offset into the pixels, in pixels
+	};
+	static_assert(sizeof(PackedLevel) == 4 * 3, "PackedLevel is packed.");
+
+	//internals:
+	std::vector< std::vector< uint32_t > > storage; //level data of built packs
+	std::unique_ptr< MappedFile > mapping; //of loaded packs
+	void clear();
+};
@@ -0,0 +1,85 @@
+#include "Textures.hpp"
+#include "GLState.hpp"
+
+Textures::Textures(GLState &gl_, WorkerPool &workers_) : gl(gl_), workers(workers_) {
+}
+
+Textures::~Textures() {
+	if (!textures.empty()) glDeleteTextures(GLsizei(textures.size()), textures.data());
+}
+
+std::vector< Textures::Texture const * > Textures::load(std::vector< std::string > const &paths) {
+	TexturePack pack;
+	pack.build(paths, workers, settings, [this](uint64_t hash) {
+		return by_hash.count(hash) != 0;
+	});
+	return add(pack);
+}
+
+Textures::Texture const &Textures::load(std::string const &path) {
+	return *load(std::vector< std::string >(1, path))[0];
+}
+
+std::vector< Textures::Texture const * > Textures::load_pack(std::string const &filename) {
+	TexturePack pack;
+	pack.load(filename);
+	return add(pack);
+}
+
+Textures::Texture const *Textures::find(std::string const &path) const {
+	auto f = by_path.find(path);
+	return (f == by_path.end() ? nullptr : f->second.texture);
+}
+
+std::vector< Textures::Texture const * > Textures::add(TexturePack const &pack) {
+	//upload pages holding anything new (so a pack that is already loaded costs nothing):
+	std::vector< GLuint > page_textures(pack.pages.size(), 0);
+	for (auto const &entry : pack.entries) {
+		if (entry.page == -1U || by_hash.count(entry.hash)) continue;
+		if (page_textures[entry.page] == 0) {
+			page_textures[entry.page] = upload(pack.pages[entry.page]);
+		}
+	}
+
+	std::vector< Texture const * > results;
+	results.reserve(pack.entries.size());
+	for (auto const &entry : pack.entries) {
+		auto f = by_hash.find(entry.hash);
+		if (f != by_hash.end()) {
+			cached += 1;
+		} else {
+			f = by_hash.insert(std::make_pair(entry.hash, Texture())).first;
+			Texture &texture = f->second;
+			texture.texture = page_textures[entry.page];
+			texture.uv_rect = entry.uv_rect;
+			texture.size = entry.size;
+			texture.atlased = pack.pages[entry.page].atlas;
+			loaded += 1;
+		}
+		PathEntry &path = by_path[entry.name];
+		path.hash = entry.hash;
+		path.texture = &f->second;
+		results.emplace_back(path.texture);
+	}
+	return results;
+}
+
+GLuint Textures::upload(TexturePack::Page const &page) {
+	GLuint texture = 0;
+	glGenTextures(1, &texture);
+	gl.bind_texture(0, GL_TEXTURE_2D, texture);
+	glm::uvec2 size = page.size;
+	for (uint32_t level = 0; level < page.levels.size(); ++level) {
+		glTexImage2D(GL_TEXTURE_2D, GLint(level), GL_RGBA8, GLsizei(size.x), GLsizei(size.y), 0, GL_RGBA, GL_UNSIGNED_BYTE, page.levels[level]);
+		size = mip_size(size);
+	}
+	GLenum wrap = (page.atlas ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(page.levels.size()) - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (page.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR));
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GLint(wrap));
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GLint(wrap));
+	textures.emplace_back(texture);
+	uploaded += 1;
+	return texture;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "GL.hpp"
+#include "TexturePack.hpp"
+
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+struct GLState;
+struct WorkerPool;
+
+//"Textures" loads PNG files into GL textures.
+// Files are mapped, hashed, decoded, packed, and mipmapped on worker threads (see TexturePack.hpp):
+// small images share atlas textures, so a whole set of skins costs one bind and one upload.
+// Alternatively, a container prepared offline by pack-textures is mapped and uploaded as-is, skipping all of that.
+//Results are cached by path and by content hash: loading a path again only costs re-hashing the file
+// unless it changed, and identical files (even one from a pack and one loaded directly) share one image.
+
+struct Textures {
+	Textures(GLState &gl, WorkerPool &workers);
+	Textures(Textures const &) = delete;
+	~Textures();
+
+	//where an image ended up:
+	struct Texture {
+		GLuint texture = 0; //GL_TEXTURE_2D name (shared by every image in the same atlas)
+		glm::vec4 uv_rect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f); //maps image uvs into 'texture': uv * zw + xy
+		glm::uvec2 size = glm::uvec2(0); //of the image, in pixels
+		bool atlased = false;
+	};
+
+	//load a batch of files (or find them in the cache), returning entries in the same order:
+	// new images that fit are packed into new atlases together, so load related images in one batch.
+	// Uploads happen on the calling thread, which must have the GL context.
+	// note: will throw if any file fails to load.
+	std::vector< Texture const * > load(std::vector< std::string > const &paths);
+	Texture const &load(std::string const &path);
+
+	//load every image in a texture pack file, uploading levels straight from the mapping; entries come back in pack order
+	// (and are found later under the names they were packed with):
+	// note: will throw if the file is missing or malformed.
+	std::vector< Texture const * > load_pack(std::string const &filename);
+
+	//most recent result of loading 'path' (without touching the file), or nullptr if it was never loaded:
+	Texture const *find(std::string const &path) const;
+
+	TexturePack::Settings settings; //(apply to later loads)
+
+	//counts, for reporting:
+	uint32_t loaded = 0; //images added to the cache
+	uint32_t cached = 0; //images found in the cache (by path or by content)
+	uint32_t uploaded = 0; //textures (atlases or stand-alone) created
+
+	//internals:
+	GLState &gl;
+	WorkerPool &workers;
+	std::unordered_map< uint64_t, Texture > by_hash; //content hash -> image (references stay valid as this grows)
+	struct PathEntry {
+		uint64_t hash = 0;
+		Texture const *texture = nullptr;
+	};
+	std::unordered_map< std::string, PathEntry > by_path;
+	std::vector< GLuint > textures; //every texture created, for cleanup
+	std::vector< Texture const * > add(TexturePack const &pack);
+	GLuint upload(TexturePack::Page const &page);
+};
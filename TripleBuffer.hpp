@@ -0,0 +1,33 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+//"TripleBuffer" hands the latest value from one writer thread to one reader thread without locks:
+// the writer fills 'write_buffer()' and calls 'publish()'; the reader calls 'acquire()' and,
+// if it returns true, reads the newest published value from 'read_buffer()'.
+//Neither side ever waits for the other; values the reader never got around to acquiring are skipped.
+
+template< typename T >
+struct TripleBuffer {
+	T &write_buffer() { return buffers[write_index]; }
+	//make the write buffer the newest value (and get a fresh one to write into):
+	void publish() {
+		write_index = middle.exchange(write_index | Fresh, std::memory_order_acq_rel) & IndexMask;
+	}
+
+	//take the newest value, if one was published since the last acquire:
+	bool acquire() {
+		if (!(middle.load(std::memory_order_relaxed) & Fresh)) return false;
+		read_index = middle.exchange(read_index, std::memory_order_acq_rel) & IndexMask;
+		return true;
+	}
+	T const &read_buffer() const { return buffers[read_index]; }
+
+	//internals:
+	enum : uint32_t { IndexMask = 3, Fresh = 4 };
+	T buffers[3];
+	uint32_t write_index = 0; //(writer thread only)
+	uint32_t read_index = 1; //(reader thread only)
+	std::atomic< uint32_t > middle{2}; //buffer between the two, plus Fresh if the writer put it there
+};
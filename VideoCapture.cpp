@@ -0,0 +1,258 @@
+#include "VideoCapture.hpp"
+#include "load_save_png.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+VideoCapture::VideoCapture(uint32_t encoders_, uint32_t frame_count) : frames(frame_count), free_frames(frame_count), queued_frames(frame_count) {
+	encoder_count = encoders_;
+	if (encoder_count == 0) {
+		encoder_count = std::max(1U, std::thread::hardware_concurrency() / 4);
+	}
+	for (auto &slot : slots) {
+		glGenBuffers(1, &slot.buffer);
+	}
+}
+
+VideoCapture::~VideoCapture() {
+	//(no GL waiting here -- the context may already be gone; 'stop' should have been called)
+	stop_encoders();
+	for (auto &slot : slots) {
+		if (slot.fence) glDeleteSync(slot.fence);
+		glDeleteBuffers(1, &slot.buffer);
+	}
+}
+
+void VideoCapture::start(std::string const &prefix_, Format format_, glm::uvec2 const &size_, uint32_t fps) {
+	if (active) stop();
+
+	prefix = prefix_;
+	format = format_;
+	size = size_;
+	captured = 0;
+	dropped = 0;
+	written = 0;
+	next_index = 0;
+	y4m_next = 0;
+
+	if (format == Y4M) {
+		y4m.open(prefix + ".y4m", std::ios::binary);
+		if (!y4m) throw std::runtime_error("Failed to open '" + prefix + ".y4m' for writing.");
+		//4:2:0 with JPEG-style (full range, centered) chroma:
+		y4m << "YUV4MPEG2 W" << size.x << " H" << size.y << " F" << fps << ":1 Ip A1:1 C420jpeg\n";
+	}
+
+	GLsizeiptr bytes = GLsizeiptr(size.x) * size.y * 4;
+	for (auto &slot : slots) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, bytes, NULL, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	oldest = 0;
+	in_flight = 0;
+
+	//every frame starts out free:
+	Frame *frame;
+	while (queued_frames.pop(&frame)) { }
+	while (free_frames.pop(&frame)) { }
+	for (auto &f : frames) {
+		f.pixels.resize(size.x * size.y);
+		free_frames.push(&f);
+	}
+
+	quit = false;
+	for (uint32_t i = 0; i < encoder_count; ++i) {
+		encoders.emplace_back(&VideoCapture::run, this);
+	}
+	active = true;
+	std::cout << "Recording to '" << prefix << (format == Y4M ? ".y4m" : "-*.png") << "' with " << encoder_count << " encoder threads." << std::endl;
+}
+
+void VideoCapture::stop() {
+	if (!active) return;
+
+	//wait for readbacks in flight, then queue them:
+	for (uint32_t i = 0; i < in_flight; ++i) {
+		GLsync fence = slots[(oldest + i) % Slots].fence;
+		GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		while (glClientWaitSync(fence, flags, 1000000000ULL /* 1s */) == GL_TIMEOUT_EXPIRED) {
+			flags = 0;
+		}
+	}
+	poll();
+
+	//encoders drain the queue before exiting:
+	stop_encoders();
+	if (y4m.is_open()) y4m.close();
+	active = false;
+
+	std::cout << "Recorded " << written << " frames to '" << prefix << (format == Y4M ? ".y4m" : "-*.png") << "'; "
+		<< dropped << " of " << captured << " dropped";
+	if (captured) std::cout << " (" << std::fixed << std::setprecision(1) << (100.0f * dropped / captured) << "%)";
+	std::cout << "." << std::endl;
+}
+
+void VideoCapture::stop_encoders() {
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		quit = true;
+	}
+	wake.notify_all();
+	for (auto &encoder : encoders) {
+		encoder.join();
+	}
+	encoders.clear();
+}
+
+void VideoCapture::capture() {
+	if (!active) return;
+	captured += 1;
+	if (in_flight == Slots) {
+		//back-pressure: readbacks aren't finishing as fast as frames are drawn
+		dropped += 1;
+		return;
+	}
+	Slot &slot = slots[(oldest + in_flight) % Slots];
+	in_flight += 1;
+
+	//with a pack buffer bound, glReadPixels returns right away:
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadBuffer(GL_BACK);
+	glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void VideoCapture::poll() {
+	//readbacks finish in order, so stop at the first one that isn't done (never wait):
+	while (in_flight) {
+		Slot &slot = slots[oldest];
+		GLenum result = glClientWaitSync(slot.fence, 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED) break;
+		glDeleteSync(slot.fence);
+		slot.fence = 0;
+		oldest = (oldest + 1) % Slots;
+		in_flight -= 1;
+		if (result == GL_WAIT_FAILED) {
+			dropped += 1;
+			continue;
+		}
+		collect(slot);
+	}
+}
+
+void VideoCapture::collect(Slot &slot) {
+	Frame *frame = nullptr;
+	if (!free_frames.pop(&frame)) {
+		//back-pressure: encoders are behind and every frame buffer is taken
+		dropped += 1;
+		return;
+	}
+
+	GLsizeiptr bytes = GLsizeiptr(frame->pixels.size()) * 4;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	void const *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+	if (mapped) {
+		std::memcpy(frame->pixels.data(), mapped, bytes);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	if (!mapped) {
+		free_frames.push(frame);
+		dropped += 1;
+		return;
+	}
+
+	frame->index = next_index++;
+	//(can't fail: the queue holds every frame)
+	queued_frames.push(frame);
+	wake.notify_one();
+}
+
+void VideoCapture::run() {
+	std::vector< uint8_t > scratch;
+	while (true) {
+		Frame *frame = nullptr;
+		if (!queued_frames.pop(&frame)) {
+			std::unique_lock< std::mutex > lock(mutex);
+			if (quit) {
+				//(nothing more will be queued once 'quit' is set, so an empty queue means done)
+				lock.unlock();
+				if (!queued_frames.pop(&frame)) return;
+			} else {
+				//(pushes notify without the lock, so don't rely on the notification alone)
+				wake.wait_for(lock, std::chrono::milliseconds(5));
+				continue;
+			}
+		}
+		encode(frame, &scratch);
+		free_frames.push(frame);
+		written += 1;
+	}
+}
+
+void VideoCapture::encode(Frame *frame, std::vector< uint8_t > *scratch_) {
+	if (format == PNGSequence) {
+		for (auto &px : frame->pixels) px |= 0xff000000;
+		std::ostringstream name;
+		name << prefix << "-" << std::setw(6) << std::setfill('0') << frame->index << ".png";
+		try {
+			save_png_fast(name.str(), size.x, size.y, frame->pixels.data(), LowerLeftOrigin);
+		} catch (std::exception const &e) {
+			std::cerr << "WARNING: failed to write '" << name.str() << "': " << e.what() << std::endl;
+		}
+		return;
+	}
+
+	//Y4M: convert to 4:2:0 YCbCr (BT.601, full range), top row first:
+	std::vector< uint8_t > &scratch = *scratch_;
+	uint32_t cw = (size.x + 1) / 2, ch = (size.y + 1) / 2;
+	scratch.resize(size.x * size.y + 2 * cw * ch);
+	uint8_t *Y = scratch.data();
+	uint8_t *Cb = Y + size.x * size.y;
+	uint8_t *Cr = Cb + cw * ch;
+	auto channels = [&](uint32_t x, uint32_t y, int32_t *r, int32_t *g, int32_t *b) {
+		uint32_t px = frame->pixels[(size.y - 1 - y) * size.x + x];
+		*r = int32_t(px & 0xff);
+		*g = int32_t((px >> 8) & 0xff);
+		*b = int32_t((px >> 16) & 0xff);
+	};
+	for (uint32_t y = 0; y < size.y; ++y) {
+		for (uint32_t x = 0; x < size.x; ++x) {
+			int32_t r, g, b;
+			channels(x, y, &r, &g, &b);
+			Y[y * size.x + x] = uint8_t((77 * r + 150 * g + 29 * b + 128) >> 8);
+		}
+	}
+	for (uint32_t cy = 0; cy < ch; ++cy) {
+		for (uint32_t cx = 0; cx < cw; ++cx) {
+			//average the (up to) 2x2 block:
+			int32_t r = 0, g = 0, b = 0, n = 0;
+			for (uint32_t y = 2 * cy; y < std::min(2 * cy + 2, size.y); ++y) {
+				for (uint32_t x = 2 * cx; x < std::min(2 * cx + 2, size.x); ++x) {
+					int32_t pr, pg, pb;
+					channels(x, y, &pr, &pg, &pb);
+					r += pr; g += pg; b += pb; n += 1;
+				}
+			}
+			r /= n; g /= n; b /= n;
+			//(offset by 128 << 8 before shifting so the sums stay non-negative)
+			Cb[cy * cw + cx] = uint8_t(std::min(255, (-43 * r - 85 * g + 128 * b + 32896) >> 8));
+			Cr[cy * cw + cx] = uint8_t(std::min(255, (128 * r - 107 * g - 21 * b + 32896) >> 8));
+		}
+	}
+
+	//frames were queued in order, but may finish encoding out of order:
+	std::unique_lock< std::mutex > lock(mutex);
+	written_in_order.wait(lock, [this, frame]() { return y4m_next == frame->index; });
+	y4m << "FRAME\n";
+	y4m.write(reinterpret_cast< char const * >(scratch.data()), scratch.size());
+	y4m_next += 1;
+	written_in_order.notify_all();
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "GL.hpp"
+#include "BoundedQueue.hpp"
+
+#include <glm/glm.hpp>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+//"VideoCapture" records every rendered frame while active:
+// each frame is read back asynchronously into one of several pixel-pack buffers (as in Screenshots.hpp);
+// readbacks whose fences have signaled are copied into a recycled frame buffer and pushed into a
+// bounded lock-free queue, which a pool of encoder threads drains. Output is either a numbered
+// PNG sequence (<prefix>-000000.png, ...; written with save_png_fast) or a single raw Y4M stream (<prefix>.y4m, 4:2:0, written in frame order).
+//Frames are dropped only under back-pressure -- when every readback buffer is still in flight or every
+// frame buffer is still queued or encoding -- and never by blocking the render thread; drops are counted and reported.
+
+struct VideoCapture {
+	enum Format {
+		PNGSequence,
+		Y4M,
+	};
+
+	//'encoders' == 0 means "about a quarter of the hardware threads":
+	VideoCapture(uint32_t encoders = 0, uint32_t frame_count = 16);
+	VideoCapture(VideoCapture const &) = delete;
+	~VideoCapture();
+
+	//begin recording 'size' frames; 'fps' is only used for the Y4M header:
+	// note: will throw if the output can't be opened.
+	void start(std::string const &prefix, Format format, glm::uvec2 const &size, uint32_t fps = 60);
+	//finish in-flight readbacks, wait for every queued frame to be written, and print stats:
+	void stop();
+	bool recording() const { return active; }
+
+	//read the current back buffer as the next frame (call after drawing, before swapping):
+	void capture();
+	//queue finished readbacks for encoding (call once per frame, with the context current):
+	void poll();
+
+	//counts for the current (or last) recording:
+	uint32_t captured = 0; //frames read back
+	uint32_t dropped = 0; //frames skipped because of back-pressure
+	std::atomic< uint32_t > written{0};
+
+	//internals:
+	enum : uint32_t { Slots = 4 };
+	struct Frame {
+		uint32_t index = 0;
+		std::vector< uint32_t > pixels; //RGBA, bottom row first
+	};
+	struct Slot {
+		GLuint buffer = 0;
+		GLsync fence = 0; //non-zero while a readback is in flight
+	};
+	void collect(Slot &slot);
+	void encode(Frame *frame, std::vector< uint8_t > *scratch);
+	void run();
+	void stop_encoders();
+
+	bool active = false;
+	Format format = PNGSequence;
+	std::string prefix;
+	glm::uvec2 size = glm::uvec2(0);
+	uint32_t next_index = 0; //index given to the next frame queued for encoding
+
+	Slot slots[Slots]; //used in order, as a ring:
+	uint32_t oldest = 0; //slot of the oldest readback in flight
+	uint32_t in_flight = 0;
+	std::vector< Frame > frames; //recycled through the queues below
+	BoundedQueue< Frame * > free_frames; //ready to be filled
+	BoundedQueue< Frame * > queued_frames; //ready to be encoded
+
+	uint32_t encoder_count = 0;
+	std::vector< std::thread > encoders;
+	std::mutex mutex;
+	std::condition_variable wake; //encoders sleep here when the queue is empty
+	std::condition_variable written_in_order; //Y4M encoders wait here for their turn to write
+	bool quit = false;
+	std::ofstream y4m;
+	uint32_t y4m_next = 0; //(guarded by 'mutex') index of the next frame to append to 'y4m'
+};
@@ -0,0 +1,96 @@
+#include "WorkerPool.hpp"
+
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+WorkerPool::WorkerPool(uint32_t thread_count) {
+	if (thread_count == 0) {
+		uint32_t hardware = std::thread::hardware_concurrency();
+		thread_count = (hardware > 1 ? hardware - 1 : 1);
+	}
+	threads.reserve(thread_count);
+	for (uint32_t i = 0; i < thread_count; ++i) {
+		threads.emplace_back(&WorkerPool::run, this);
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		quit = true;
+	}
+	wake.notify_all();
+	for (auto &thread : threads) {
+		thread.join();
+	}
+}
+
+void WorkerPool::submit(std::function< void() > const &job) {
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		jobs.emplace_back(job);
+	}
+	wake.notify_one();
+}
+
+void WorkerPool::run() {
+	while (true) {
+		std::function< void() > job;
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			wake.wait(lock, [this](){ return quit || !jobs.empty(); });
+			//finish queued work before quitting:
+			if (jobs.empty()) return;
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		job();
+	}
+}
+
+void WorkerPool::parallel_for(uint32_t count, std::function< void(uint32_t begin, uint32_t end) > const &fn, uint32_t min_chunk) {
+	if (count == 0) return;
+	min_chunk = std::max(min_chunk, 1U);
+	uint32_t chunks = std::min((count + min_chunk - 1) / min_chunk, size() + 1);
+	if (chunks <= 1) {
+		fn(0, count);
+		return;
+	}
+
+	//shared state lives on the heap because helper jobs may be dequeued after this call returns:
+	struct State {
+		std::function< void(uint32_t, uint32_t) > fn;
+		uint32_t count = 0;
+		uint32_t chunks = 0;
+		std::atomic< uint32_t > next_chunk;
+		std::atomic< uint32_t > finished;
+		std::mutex mutex;
+		std::condition_variable done;
+		//grab and run chunks until none are left:
+		void work() {
+			uint32_t chunk;
+			while ((chunk = next_chunk.fetch_add(1)) < chunks) {
+				fn(uint32_t(uint64_t(count) * chunk / chunks), uint32_t(uint64_t(count) * (chunk + 1) / chunks));
+				if (finished.fetch_add(1) + 1 == chunks) {
+					std::unique_lock< std::mutex > lock(mutex);
+					done.notify_all();
+				}
+			}
+		}
+	};
+	std::shared_ptr< State > state = std::make_shared< State >();
+	state->fn = fn;
+	state->count = count;
+	state->chunks = chunks;
+	state->next_chunk = 0;
+	state->finished = 0;
+
+	for (uint32_t i = 0; i + 1 < chunks; ++i) {
+		submit([state](){ state->work(); });
+	}
+	state->work();
+
+	std::unique_lock< std::mutex > lock(state->mutex);
+	state->done.wait(lock, [&state](){ return state->finished.load() == state->chunks; });
+}
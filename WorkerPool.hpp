@@ -0,0 +1,34 @@
+#pragma once
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <cstdint>
+
+//WorkerPool runs jobs on a fixed set of background threads:
+struct WorkerPool {
+	//thread_count == 0 means "one per hardware thread, leaving one for the caller":
+	WorkerPool(uint32_t thread_count = 0);
+	WorkerPool(WorkerPool const &) = delete;
+	~WorkerPool();
+
+	//queue a job to be run (eventually) on some worker thread:
+	void submit(std::function< void() > const &job);
+
+	//call 'fn(begin, end)' over sub-ranges of [0,count), with at least 'min_chunk' items per call.
+	// the calling thread also runs chunks; returns once every chunk has finished.
+	void parallel_for(uint32_t count, std::function< void(uint32_t begin, uint32_t end) > const &fn, uint32_t min_chunk = 1);
+
+	uint32_t size() const { return uint32_t(threads.size()); }
+
+	//internals:
+	void run();
+	std::vector< std::thread > threads;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque< std::function< void() > > jobs;
+	bool quit = false;
+};
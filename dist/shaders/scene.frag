@@ -0,0 +1,49 @@
+//scene fragment shader (see SceneShader.hpp; "#version 330", feature #defines, and the Frame block are prepended on load)
+//features (each compiled in only when defined; see SceneShader::Feature):
+// DIRECTIONAL_LIGHTS: the cluster_grid.w directional lights at the start of cluster_lights
+// POINT_LIGHTS: point lights, found through the light clusters (see LightClusters.hpp)
+// FOG: exponential distance fog toward the clear color
+#ifndef FOG_DENSITY
+#define FOG_DENSITY 0.03
+#endif
+#ifndef FOG_COLOR
+#define FOG_COLOR vec3(0.5)
+#endif
+uniform samplerBuffer cluster_lights;
+uniform usamplerBuffer cluster_ranges;
+uniform usamplerBuffer cluster_indices;
+in vec3 position;
+in vec3 normal;
+in vec3 color;
+out vec4 fragColor;
+void main() {
+	vec3 n = normalize(normal);
+	vec3 light = vec3(0.0);
+#ifdef DIRECTIONAL_LIGHTS
+	for (int i = 0; i < int(cluster_grid.w); ++i) {
+		vec3 to_light = texelFetch(cluster_lights, 2*i).xyz;
+		vec3 l = mix(normal,to_light,0.9);
+		light += texelFetch(cluster_lights, 2*i+1).rgb * max(0.0, dot(n, l));
+	}
+#endif
+#ifdef POINT_LIGHTS
+	uvec3 cluster;
+	cluster.xy = uvec2(min(gl_FragCoord.xy * cluster_params.xy, vec2(cluster_grid.xy - 1u)));
+	float slice = log(-position.z / cluster_params.z) * cluster_params.w;
+	cluster.z = uint(clamp(slice, 0.0, float(cluster_grid.z - 1u)));
+	uvec2 range = texelFetch(cluster_ranges, int((cluster.z * cluster_grid.y + cluster.y) * cluster_grid.x + cluster.x)).xy;
+	for (uint i = range.x; i < range.x + range.y; ++i) {
+		int index = int(texelFetch(cluster_indices, int(i)).x);
+		vec4 position_range = texelFetch(cluster_lights, 2*index);
+		vec3 to_light = position_range.xyz - position;
+		float dist = length(to_light);
+		float falloff = clamp(1.0 - dist / position_range.w, 0.0, 1.0);
+		light += texelFetch(cluster_lights, 2*index+1).rgb * (falloff * falloff * max(0.0, dot(n, to_light / dist)));
+	}
+#endif
+	vec3 result = light * color;
+#ifdef FOG
+	result = mix(FOG_COLOR, result, exp(-FOG_DENSITY * length(position)));
+#endif
+	fragColor = vec4(result, 1.0);
+}
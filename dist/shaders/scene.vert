@@ -0,0 +1,19 @@
+//scene vertex shader (see SceneShader.hpp; "#version 330", feature #defines, and the Frame block are prepended on load)
+//(explicit locations, so every variant agrees with the vertex arrays even when some attributes go unused)
+layout(location = 0) in vec4 Position;
+layout(location = 1) in vec3 Normal;
+layout(location = 2) in vec3 Color;
+//per-instance attributes (see InstanceBuffer.hpp):
+layout(location = 4) in mat4 InstanceMV;
+layout(location = 8) in mat3 InstanceITMV;
+layout(location = 11) in vec4 InstanceColor;
+out vec3 position;
+out vec3 normal;
+out vec3 color;
+void main() {
+	vec4 camera_position = InstanceMV * Position;
+	gl_Position = projection * camera_position;
+	position = vec3(camera_position);
+	normal = InstanceITMV * Normal;
+	color = Color * InstanceColor.rgb;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+//64-bit FNV-1a, for spotting data that changed between loads (fast and simple, but not collision-resistant):
+// to hash several pieces as one, pass each call's result as the next call's 'hash'.
+
+uint64_t const FNV1aBasis = 14695981039346656037ULL;
+
+inline uint64_t fnv1a(void const *data, size_t size, uint64_t hash = FNV1aBasis) {
+	uint8_t const *bytes = reinterpret_cast< uint8_t const * >(data);
+	for (size_t i = 0; i < size; ++i) {
+		hash = (hash ^ bytes[i]) * 1099511628211ULL;
+	}
+	return hash;
+}
@@ -0,0 +1,544 @@
+//gl-replay plays back a GL call trace recorded by the game (main --trace <file> <frames>)
+// and reports how long each kind of call and each frame took.
+// Calls are issued into a headless context (see HeadlessContext.hpp), with an offscreen framebuffer the size of
+// the game's window standing in for its default framebuffer, so no display is needed; each frame ends with glFinish.
+
+#define GL_TRACE_NO_REDIRECT
+#include "GL.hpp"
+#include "GLTrace.hpp"
+#include "MappedFile.hpp"
+#include "HeadlessContext.hpp"
+#include "Offscreen.hpp"
+
+#include <SDL.h> //(main becomes SDL_main where HeadlessContext uses SDL)
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+namespace {
+	//sequential reads from the mapped trace:
+	struct Reader {
+		char const *at;
+		char const *end;
+		void bytes(void *dst, size_t size) {
+			if (size_t(end - at) < size) throw std::runtime_error("GL trace ends in the middle of a record.");
+			std::memcpy(dst, at, size);
+			at += size;
+		}
+		uint16_t u16() { uint16_t v; bytes(&v, sizeof(v)); return v; }
+		uint32_t u32() { uint32_t v; bytes(&v, sizeof(v)); return v; }
+		uint64_t u64() { uint64_t v; bytes(&v, sizeof(v)); return v; }
+		float f32() { float v; bytes(&v, sizeof(v)); return v; }
+		//returns a pointer into the trace (not necessarily aligned):
+		char const *blob(uint32_t *size) {
+			*size = u32();
+			if (size_t(end - at) < *size) throw std::runtime_error("GL trace ends in the middle of a record.");
+			char const *ret = at;
+			at += *size;
+			return ret;
+		}
+		//blob copied out, for when alignment matters:
+		template< typename T >
+		std::vector< T > array() {
+			uint32_t size;
+			char const *src = blob(&size);
+			std::vector< T > ret(size / sizeof(T));
+			if (!ret.empty()) std::memcpy(ret.data(), src, ret.size() * sizeof(T));
+			return ret;
+		}
+		std::string string() {
+			uint32_t size;
+			char const *src = blob(&size);
+			return std::string(src, size);
+		}
+	};
+
+	//maps names from the trace to names in this context (0 always maps to 0):
+	struct Names {
+		std::unordered_map< uint32_t, GLuint > map;
+		GLuint operator()(uint32_t traced) const {
+			if (traced == 0) return 0;
+			auto f = map.find(traced);
+			if (f == map.end()) return traced; //(best effort)
+			return f->second;
+		}
+	};
+}
+
+int main(int argc, char **argv) {
+	if (argc != 2) {
+		std::cerr << "Usage:\n\t" << argv[0] << " <trace>" << std::endl;
+		return 1;
+	}
+	std::string filename = argv[1];
+
+	//------------ context ------------
+
+	HeadlessContext context;
+	std::cout << "Replaying with " << context.renderer << "." << std::endl;
+
+	//(same size as the game's window; draws to the default framebuffer land here)
+	Offscreen offscreen(glm::uvec2(640, 480));
+	offscreen.bind();
+
+	//------------ replay ------------
+
+	MappedFile file(filename);
+	Reader in{file.data, file.data + file.size};
+	{ //header:
+		char magic[4];
+		in.bytes(magic, 4);
+		if (std::memcmp(magic, "gltr", 4) != 0) throw std::runtime_error("'" + filename + "' is not a GL trace.");
+		uint32_t version = in.u32();
+		if (version != GLTrace::Version) throw std::runtime_error("'" + filename + "' has trace version " + std::to_string(version) + "; expected " + std::to_string(GLTrace::Version) + ".");
+	}
+
+	Names buffers, textures, arrays, framebuffers, renderbuffers, objects; //(shaders and programs share a namespace)
+	std::unordered_map< uint64_t, GLsync > syncs;
+	std::map< std::pair< GLuint, uint32_t >, GLint > locations; //(replayed program, traced location) -> location
+	std::map< std::pair< GLuint, uint32_t >, GLuint > block_indices; //(replayed program, traced index) -> index
+	GLuint current_program = 0;
+	std::vector< char > read_pixels; //stands in for client memory the traced program read pixels into
+	auto location = [&](uint32_t traced) -> GLint {
+		if (int32_t(traced) < 0) return -1;
+		auto f = locations.find(std::make_pair(current_program, traced));
+		return (f == locations.end() ? GLint(traced) : f->second);
+	};
+
+	struct OpStats {
+		uint64_t count = 0;
+		std::chrono::nanoseconds total = std::chrono::nanoseconds(0);
+	};
+	std::vector< OpStats > op_stats(GLTrace::OpCount);
+	std::vector< double > frame_ms;
+
+	auto frame_start = std::chrono::steady_clock::now();
+	bool first_frame = true; //(the first frame also creates every resource, so is reported separately)
+	double setup_ms = 0.0;
+
+	while (in.at != in.end) {
+		uint16_t op = in.u16();
+		if (op >= GLTrace::OpCount) throw std::runtime_error("GL trace contains unknown op " + std::to_string(op) + ".");
+
+		//arguments are decoded before the timer starts, so only the GL call itself is measured:
+		std::function< void() > call;
+		switch (op) {
+			case GLTrace::FrameEnd: break;
+			case GLTrace::ActiveTexture: {
+				GLenum texture = in.u32();
+				call = [=]() { glActiveTexture(texture); };
+			} break;
+			case GLTrace::AttachShader: {
+				GLuint program = objects(in.u32());
+				GLuint shader = objects(in.u32());
+				call = [=]() { glAttachShader(program, shader); };
+			} break;
+			case GLTrace::BindBuffer: {
+				GLenum target = in.u32();
+				GLuint buffer = buffers(in.u32());
+				call = [=]() { glBindBuffer(target, buffer); };
+			} break;
+			case GLTrace::BindBufferRange: {
+				GLenum target = in.u32();
+				GLuint index = in.u32();
+				GLuint buffer = buffers(in.u32());
+				GLintptr offset = GLintptr(in.u64());
+				GLsizeiptr size = GLsizeiptr(in.u64());
+				call = [=]() { glBindBufferRange(target, index, buffer, offset, size); };
+			} break;
+			case GLTrace::BindFramebuffer: {
+				GLenum binding = in.u32();
+				uint32_t traced = in.u32();
+				GLuint framebuffer = (traced == 0 ? offscreen.framebuffer : framebuffers(traced));
+				call = [=]() { glBindFramebuffer(binding, framebuffer); };
+			} break;
+			case GLTrace::BindRenderbuffer: {
+				GLenum target = in.u32();
+				GLuint renderbuffer = renderbuffers(in.u32());
+				call = [=]() { glBindRenderbuffer(target, renderbuffer); };
+			} break;
+			case GLTrace::BindTexture: {
+				GLenum target = in.u32();
+				GLuint texture = textures(in.u32());
+				call = [=]() { glBindTexture(target, texture); };
+			} break;
+			case GLTrace::BindVertexArray: {
+				GLuint array = arrays(in.u32());
+				call = [=]() { glBindVertexArray(array); };
+			} break;
+			case GLTrace::BlendFunc: {
+				GLenum sfactor = in.u32();
+				GLenum dfactor = in.u32();
+				call = [=]() { glBlendFunc(sfactor, dfactor); };
+			} break;
+			case GLTrace::BufferData: {
+				GLenum target = in.u32();
+				GLsizeiptr size = GLsizeiptr(in.u64());
+				GLenum usage = in.u32();
+				uint32_t data_size;
+				char const *data = in.blob(&data_size);
+				call = [=]() { glBufferData(target, size, (data_size ? data : nullptr), usage); };
+			} break;
+			case GLTrace::BufferSubData: {
+				GLenum target = in.u32();
+				GLintptr offset = GLintptr(in.u64());
+				uint32_t size;
+				char const *data = in.blob(&size);
+				call = [=]() { glBufferSubData(target, offset, size, data); };
+			} break;
+			case GLTrace::Clear: {
+				GLbitfield mask = in.u32();
+				call = [=]() { glClear(mask); };
+			} break;
+			case GLTrace::ClearColor: {
+				float r = in.f32(), g = in.f32(), b = in.f32(), a = in.f32();
+				call = [=]() { glClearColor(r, g, b, a); };
+			} break;
+			case GLTrace::ClientWaitSync: {
+				auto f = syncs.find(in.u64());
+				GLbitfield flags = in.u32();
+				GLuint64 timeout = in.u64();
+				if (f == syncs.end()) break;
+				GLsync sync = f->second;
+				call = [=]() { glClientWaitSync(sync, flags, timeout); };
+			} break;
+			case GLTrace::CompileShader: {
+				GLuint shader = objects(in.u32());
+				call = [=]() { glCompileShader(shader); };
+			} break;
+			case GLTrace::CreateProgram: {
+				uint32_t traced = in.u32();
+				call = [=, &objects]() { objects.map[traced] = glCreateProgram(); };
+			} break;
+			case GLTrace::CreateShader: {
+				GLenum type = in.u32();
+				uint32_t traced = in.u32();
+				call = [=, &objects]() { objects.map[traced] = glCreateShader(type); };
+			} break;
+			case GLTrace::DeleteBuffers: {
+				std::vector< GLuint > names = in.array< GLuint >();
+				for (auto &name : names) name = buffers(name);
+				call = [=]() { glDeleteBuffers(GLsizei(names.size()), names.data()); };
+			} break;
+			case GLTrace::DeleteFramebuffers: {
+				std::vector< GLuint > names = in.array< GLuint >();
+				for (auto &name : names) name = framebuffers(name);
+				call = [=]() { glDeleteFramebuffers(GLsizei(names.size()), names.data()); };
+			} break;
+			case GLTrace::DeleteProgram: {
+				GLuint program = objects(in.u32());
+				call = [=]() { glDeleteProgram(program); };
+			} break;
+			case GLTrace::DeleteRenderbuffers: {
+				std::vector< GLuint > names = in.array< GLuint >();
+				for (auto &name : names) name = renderbuffers(name);
+				call = [=]() { glDeleteRenderbuffers(GLsizei(names.size()), names.data()); };
+			} break;
+			case GLTrace::DeleteShader: {
+				GLuint shader = objects(in.u32());
+				call = [=]() { glDeleteShader(shader); };
+			} break;
+			case GLTrace::DeleteSync: {
+				auto f = syncs.find(in.u64());
+				if (f == syncs.end()) break;
+				GLsync sync = f->second;
+				syncs.erase(f);
+				call = [=]() { glDeleteSync(sync); };
+			} break;
+			case GLTrace::DeleteTextures: {
+				std::vector< GLuint > names = in.array< GLuint >();
+				for (auto &name : names) name = textures(name);
+				call = [=]() { glDeleteTextures(GLsizei(names.size()), names.data()); };
+			} break;
+			case GLTrace::DeleteVertexArrays: {
+				std::vector< GLuint > names = in.array< GLuint >();
+				for (auto &name : names) name = arrays(name);
+				call = [=]() { glDeleteVertexArrays(GLsizei(names.size()), names.data()); };
+			} break;
+			case GLTrace::Disable: {
+				GLenum cap = in.u32();
+				call = [=]() { glDisable(cap); };
+			} break;
+			case GLTrace::DrawArraysInstanced: {
+				GLenum mode = in.u32();
+				GLint first = GLint(in.u32());
+				GLsizei count = GLsizei(in.u32());
+				GLsizei instances = GLsizei(in.u32());
+				call = [=]() { glDrawArraysInstanced(mode, first, count, instances); };
+			} break;
+			case GLTrace::Enable: {
+				GLenum cap = in.u32();
+				call = [=]() { glEnable(cap); };
+			} break;
+			case GLTrace::EnableVertexAttribArray: {
+				GLuint index = in.u32();
+				call = [=]() { glEnableVertexAttribArray(index); };
+			} break;
+			case GLTrace::FenceSync: {
+				GLenum condition = in.u32();
+				GLbitfield flags = in.u32();
+				uint64_t traced = in.u64();
+				call = [=, &syncs]() { syncs[traced] = glFenceSync(condition, flags); };
+			} break;
+			case GLTrace::FramebufferRenderbuffer: {
+				GLenum target = in.u32();
+				GLenum attachment = in.u32();
+				GLenum renderbuffertarget = in.u32();
+				GLuint renderbuffer = renderbuffers(in.u32());
+				call = [=]() { glFramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer); };
+			} break;
+			case GLTrace::GenBuffers:
+			case GLTrace::GenFramebuffers:
+			case GLTrace::GenRenderbuffers:
+			case GLTrace::GenTextures:
+			case GLTrace::GenVertexArrays: {
+				std::vector< GLuint > traced = in.array< GLuint >();
+				Names &names = (op == GLTrace::GenBuffers ? buffers
+					: op == GLTrace::GenFramebuffers ? framebuffers
+					: op == GLTrace::GenRenderbuffers ? renderbuffers
+					: op == GLTrace::GenTextures ? textures : arrays);
+				call = [=, &names]() {
+					std::vector< GLuint > made(traced.size());
+					if (op == GLTrace::GenBuffers) glGenBuffers(GLsizei(made.size()), made.data());
+					else if (op == GLTrace::GenFramebuffers) glGenFramebuffers(GLsizei(made.size()), made.data());
+					else if (op == GLTrace::GenRenderbuffers) glGenRenderbuffers(GLsizei(made.size()), made.data());
+					else if (op == GLTrace::GenTextures) glGenTextures(GLsizei(made.size()), made.data());
+					else glGenVertexArrays(GLsizei(made.size()), made.data());
+					for (uint32_t i = 0; i < made.size(); ++i) {
+						names.map[traced[i]] = made[i];
+					}
+				};
+			} break;
+			case GLTrace::GetAttribLocation: {
+				GLuint program = objects(in.u32());
+				std::string name = in.string();
+				GLint traced = GLint(in.u32());
+				call = [=]() {
+					if (glGetAttribLocation(program, name.c_str()) != traced) {
+						std::cerr << "WARNING: attribute '" << name << "' has a different location than when traced." << std::endl;
+					}
+				};
+			} break;
+			case GLTrace::GetUniformBlockIndex: {
+				GLuint program = objects(in.u32());
+				std::string name = in.string();
+				uint32_t traced = in.u32();
+				call = [=, &block_indices]() { block_indices[std::make_pair(program, traced)] = glGetUniformBlockIndex(program, name.c_str()); };
+			} break;
+			case GLTrace::GetUniformLocation: {
+				GLuint program = objects(in.u32());
+				std::string name = in.string();
+				uint32_t traced = in.u32();
+				call = [=, &locations]() { locations[std::make_pair(program, traced)] = glGetUniformLocation(program, name.c_str()); };
+			} break;
+			case GLTrace::LinkProgram: {
+				GLuint program = objects(in.u32());
+				call = [=]() { glLinkProgram(program); };
+			} break;
+			case GLTrace::MappedWrite: {
+				GLenum target = in.u32();
+				GLintptr offset = GLintptr(in.u64());
+				GLbitfield access = in.u32();
+				uint32_t size;
+				char const *data = in.blob(&size);
+				call = [=]() {
+					void *dst = glMapBufferRange(target, offset, size, access);
+					if (dst) {
+						std::memcpy(dst, data, size);
+						glUnmapBuffer(target);
+					} else {
+						glBufferSubData(target, offset, size, data);
+					}
+				};
+			} break;
+			case GLTrace::PixelStorei: {
+				GLenum pname = in.u32();
+				GLint param = GLint(in.u32());
+				call = [=]() { glPixelStorei(pname, param); };
+			} break;
+			case GLTrace::ReadBuffer: {
+				GLenum src = in.u32();
+				//(reads from the default framebuffer come from the offscreen one's color buffer)
+				if (src == GL_BACK || src == GL_FRONT) src = GL_COLOR_ATTACHMENT0;
+				call = [=]() { glReadBuffer(src); };
+			} break;
+			case GLTrace::ReadPixels: {
+				GLint x = GLint(in.u32());
+				GLint y = GLint(in.u32());
+				GLsizei width = GLsizei(in.u32());
+				GLsizei height = GLsizei(in.u32());
+				GLenum format = in.u32();
+				GLenum type = in.u32();
+				bool to_buffer = (in.u32() != 0);
+				uintptr_t offset = uintptr_t(in.u64());
+				void *pixels = reinterpret_cast< void * >(offset);
+				if (!to_buffer) {
+					//(room for four channels of four bytes each, plus row alignment)
+					read_pixels.resize(std::max(read_pixels.size(), (size_t(width) * 16 + 8) * size_t(height)));
+					pixels = read_pixels.data();
+				}
+				call = [=]() { glReadPixels(x, y, width, height, format, type, pixels); };
+			} break;
+			case GLTrace::RenderbufferStorage: {
+				GLenum target = in.u32();
+				GLenum internalformat = in.u32();
+				GLsizei width = GLsizei(in.u32());
+				GLsizei height = GLsizei(in.u32());
+				call = [=]() { glRenderbufferStorage(target, internalformat, width, height); };
+			} break;
+			case GLTrace::ShaderSource: {
+				GLuint shader = objects(in.u32());
+				std::string source = in.string();
+				call = [=]() {
+					GLchar const *string = source.c_str();
+					GLint length = GLint(source.size());
+					glShaderSource(shader, 1, &string, &length);
+				};
+			} break;
+			case GLTrace::TexBuffer: {
+				GLenum target = in.u32();
+				GLenum format = in.u32();
+				GLuint buffer = buffers(in.u32());
+				call = [=]() { glTexBuffer(target, format, buffer); };
+			} break;
+			case GLTrace::TexImage2D: {
+				GLenum target = in.u32();
+				GLint level = GLint(in.u32());
+				GLint internalformat = GLint(in.u32());
+				GLsizei width = GLsizei(in.u32());
+				GLsizei height = GLsizei(in.u32());
+				GLenum format = in.u32();
+				GLenum type = in.u32();
+				uint32_t data_size;
+				char const *data = in.blob(&data_size);
+				call = [=]() { glTexImage2D(target, level, internalformat, width, height, 0, format, type, (data_size ? data : nullptr)); };
+			} break;
+			case GLTrace::TexParameteri: {
+				GLenum target = in.u32();
+				GLenum pname = in.u32();
+				GLint param = GLint(in.u32());
+				call = [=]() { glTexParameteri(target, pname, param); };
+			} break;
+			case GLTrace::Uniform1i: {
+				GLint loc = location(in.u32());
+				GLint v0 = GLint(in.u32());
+				call = [=]() { glUniform1i(loc, v0); };
+			} break;
+			case GLTrace::Uniform2fv: {
+				GLint loc = location(in.u32());
+				std::vector< GLfloat > values = in.array< GLfloat >();
+				call = [=]() { glUniform2fv(loc, GLsizei(values.size() / 2), values.data()); };
+			} break;
+			case GLTrace::Uniform3ui: {
+				GLint loc = location(in.u32());
+				GLuint v0 = in.u32(), v1 = in.u32(), v2 = in.u32();
+				call = [=]() { glUniform3ui(loc, v0, v1, v2); };
+			} break;
+			case GLTrace::UniformBlockBinding: {
+				GLuint program = objects(in.u32());
+				uint32_t traced = in.u32();
+				GLuint binding = in.u32();
+				auto f = block_indices.find(std::make_pair(program, traced));
+				GLuint index = (f == block_indices.end() ? traced : f->second);
+				call = [=]() { glUniformBlockBinding(program, index, binding); };
+			} break;
+			case GLTrace::UniformMatrix3fv: {
+				GLint loc = location(in.u32());
+				GLboolean transpose = GLboolean(in.u32());
+				std::vector< GLfloat > values = in.array< GLfloat >();
+				call = [=]() { glUniformMatrix3fv(loc, GLsizei(values.size() / 9), transpose, values.data()); };
+			} break;
+			case GLTrace::UniformMatrix4fv: {
+				GLint loc = location(in.u32());
+				GLboolean transpose = GLboolean(in.u32());
+				std::vector< GLfloat > values = in.array< GLfloat >();
+				call = [=]() { glUniformMatrix4fv(loc, GLsizei(values.size() / 16), transpose, values.data()); };
+			} break;
+			case GLTrace::UseProgram: {
+				current_program = objects(in.u32());
+				GLuint program = current_program;
+				call = [=]() { glUseProgram(program); };
+			} break;
+			case GLTrace::VertexAttribDivisor: {
+				GLuint index = in.u32();
+				GLuint divisor = in.u32();
+				call = [=]() { glVertexAttribDivisor(index, divisor); };
+			} break;
+			case GLTrace::VertexAttribPointer: {
+				GLuint index = in.u32();
+				GLint size = GLint(in.u32());
+				GLenum type = in.u32();
+				GLboolean normalized = GLboolean(in.u32());
+				GLsizei stride = GLsizei(in.u32());
+				uintptr_t offset = uintptr_t(in.u64());
+				call = [=]() { glVertexAttribPointer(index, size, type, normalized, stride, reinterpret_cast< void const * >(offset)); };
+			} break;
+			case GLTrace::Viewport: {
+				GLint x = GLint(in.u32());
+				GLint y = GLint(in.u32());
+				GLsizei width = GLsizei(in.u32());
+				GLsizei height = GLsizei(in.u32());
+				call = [=]() { glViewport(x, y, width, height); };
+			} break;
+		}
+
+		if (call) {
+			auto before = std::chrono::steady_clock::now();
+			call();
+			auto after = std::chrono::steady_clock::now();
+			op_stats[op].count += 1;
+			op_stats[op].total += std::chrono::duration_cast< std::chrono::nanoseconds >(after - before);
+		}
+
+		if (op == GLTrace::FrameEnd) {
+			//frame time includes finishing the GPU work, so GPU-bound traces show up too:
+			glFinish();
+			auto now = std::chrono::steady_clock::now();
+			double ms = std::chrono::duration< double, std::milli >(now - frame_start).count();
+			if (first_frame) setup_ms = ms;
+			else frame_ms.emplace_back(ms);
+			first_frame = false;
+			frame_start = now;
+		}
+	}
+
+	//------------ report ------------
+
+	std::cout << "Replayed '" << filename << "': " << (first_frame ? 0 : frame_ms.size() + 1) << " frames." << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "  first frame (includes setup): " << setup_ms << " ms" << std::endl;
+	if (!frame_ms.empty()) {
+		double total = 0.0;
+		for (double ms : frame_ms) total += ms;
+		std::cout << "  other frames: min " << *std::min_element(frame_ms.begin(), frame_ms.end())
+			<< " / avg " << (total / frame_ms.size())
+			<< " / max " << *std::max_element(frame_ms.begin(), frame_ms.end()) << " ms" << std::endl;
+	}
+
+	std::vector< uint16_t > order;
+	for (uint16_t op = 0; op < GLTrace::OpCount; ++op) {
+		if (op_stats[op].count) order.emplace_back(op);
+	}
+	std::sort(order.begin(), order.end(), [&op_stats](uint16_t a, uint16_t b) {
+		return op_stats[a].total > op_stats[b].total;
+	});
+	std::cout << "  " << std::left << std::setw(26) << "call" << std::right << std::setw(10) << "count" << std::setw(14) << "total ms" << std::setw(12) << "avg us" << std::endl;
+	for (uint16_t op : order) {
+		OpStats const &stats = op_stats[op];
+		double total_ms = std::chrono::duration< double, std::milli >(stats.total).count();
+		std::cout << "  " << std::left << std::setw(26) << GLTrace::op_name(op) << std::right
+			<< std::setw(10) << stats.count
+			<< std::setw(14) << total_ms
+			<< std::setw(12) << (1000.0 * total_ms / stats.count) << std::endl;
+	}
+
+	return 0;
+}
@@ -1,11 +1,22 @@
 #include "load_save_png.hpp"
+#include "WorkerPool.hpp"
 
 #include <png.h>
+#include <zlib.h>
 
 #include <iostream>
 #include <fstream>
 #include <cassert>
 #include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PNG_USE_SSE2 1
+#endif
 
 #define LOG_ERROR( X ) std::cerr << X << std::endl
 
@@ -26,14 +37,6 @@ void save_png(std::string filename, unsigned int width, unsigned int height, uin
 }
 
 
-static void user_read_data(png_structp png_ptr, png_bytep data, png_size_t length) {
-	std::istream *from = reinterpret_cast< std::istream * >(png_get_io_ptr(png_ptr));
-	assert(from);
-	if (!from->read(reinterpret_cast< char * >(data), length)) {
-		png_error(png_ptr, "Error reading.");
-	}
-}
-
 static void user_write_data(png_structp png_ptr, png_bytep data, png_size_t length) {
 	std::ostream *to = reinterpret_cast< std::ostream * >(png_get_io_ptr(png_ptr));
 	assert(to);
@@ -53,17 +56,84 @@ static void user_flush_data(png_structp png_ptr) {
 
 bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vector< uint32_t > *data, OriginLocation origin) {
 	assert(data);
+	data->clear();
+	bool loaded = load_png(from, width, height, [data](unsigned int w, unsigned int h) {
+		data->resize(size_t(w) * h);
+		return data->data();
+	}, origin);
+	if (!loaded) data->clear();
+	return loaded;
+}
+
+bool load_png(std::string filename, unsigned int *width, unsigned int *height, PNGDestination const &destination, OriginLocation origin) {
+	std::ifstream file(filename.c_str(), std::ios::binary);
+	if (!file) {
+		LOG_ERROR("  cannot open file.");
+		return false;
+	}
+	return load_png(file, width, height, destination, origin);
+}
+
+namespace {
+	//state shared with libpng's progressive-reader callbacks:
+	struct StreamingLoad {
+		PNGDestination const *destination = nullptr;
+		OriginLocation origin = UpperLeftOrigin;
+		uint32_t width = 0, height = 0;
+		uint8_t *pixels = nullptr;
+		bool done = false;
+	};
+
+	void streaming_info(png_structp png, png_infop info) {
+		StreamingLoad &load = *reinterpret_cast< StreamingLoad * >(png_get_progressive_ptr(png));
+		if (png_get_color_type(png, info) == PNG_COLOR_TYPE_PALETTE)
+			png_set_palette_to_rgb(png);
+		if (png_get_color_type(png, info) == PNG_COLOR_TYPE_GRAY || png_get_color_type(png, info) == PNG_COLOR_TYPE_GRAY_ALPHA)
+			png_set_gray_to_rgb(png);
+		if (!(png_get_color_type(png, info) & PNG_COLOR_MASK_ALPHA))
+			png_set_add_alpha(png, 0xff, PNG_FILLER_AFTER);
+		if (png_get_bit_depth(png, info) < 8)
+			png_set_packing(png);
+		if (png_get_bit_depth(png,info) == 16)
+			png_set_strip_16(png);
+		//interlaced images arrive in passes, which png_progressive_combine_row merges into the destination:
+		png_set_interlace_handling(png);
+		//Ok, should be 32-bit RGBA now.
+
+		png_read_update_info(png, info);
+		load.width = png_get_image_width(png, info);
+		load.height = png_get_image_height(png, info);
+		if (png_get_rowbytes(png, info) != load.width * sizeof(uint32_t)) {
+			png_error(png, "unexpected row size.");
+		}
+		load.pixels = reinterpret_cast< uint8_t * >((*load.destination)(load.width, load.height));
+		if (!load.pixels) png_error(png, "no destination for pixels.");
+	}
+
+	void streaming_row(png_structp png, png_bytep new_row, png_uint_32 row, int pass) {
+		(void)pass;
+		if (!new_row) return; //(row unchanged in this pass)
+		StreamingLoad &load = *reinterpret_cast< StreamingLoad * >(png_get_progressive_ptr(png));
+		uint32_t y = (load.origin == LowerLeftOrigin ? load.height - 1 - row : row);
+		png_progressive_combine_row(png, load.pixels + size_t(y) * load.width * sizeof(uint32_t), new_row);
+	}
+
+	void streaming_end(png_structp png, png_infop info) {
+		(void)info;
+		StreamingLoad &load = *reinterpret_cast< StreamingLoad * >(png_get_progressive_ptr(png));
+		load.done = true;
+	}
+}
+
+//run the progressive reader over pieces of input from 'next' (which returns 0 once out of input):
+static bool load_progressive(unsigned int *width, unsigned int *height, PNGDestination const &destination, OriginLocation origin,
+	std::function< size_t(png_bytep *piece) > const &next) {
 	uint32_t local_width, local_height;
 	if (width == nullptr) width = &local_width;
 	if (height == nullptr) height = &local_height;
 	*width = *height = 0;
-	data->clear();
-	//..... load file ......
-	//Load a png file, as per the libpng docs:
-	png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, (png_voidp)NULL, (png_error_ptr)NULL, (png_error_ptr)NULL);
-
-	png_set_read_fn(png, &from, user_read_data);
 
+	png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, (png_voidp)NULL, (png_error_ptr)NULL, (png_error_ptr)NULL);
 	if (!png) {
 		LOG_ERROR("  cannot alloc read struct.");
 		return false;
@@ -74,53 +144,56 @@ bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vec
 		png_destroy_read_struct(&png, (png_infopp)NULL, (png_infopp)NULL);
 		return false;
 	}
-	png_bytep *row_pointers = NULL;
+
+	StreamingLoad load;
+	load.destination = &destination;
+	load.origin = origin;
 	if (setjmp(png_jmpbuf(png))) {
 		LOG_ERROR("  png interal error.");
 		png_destroy_read_struct(&png, &info, (png_infopp)NULL);
-		if (row_pointers != NULL) delete[] row_pointers;
-		data->clear();
 		return false;
 	}
-	//not needed with custom read/write functions: png_init_io(png, NULL);
-	png_read_info(png, info);
-	unsigned int w = png_get_image_width(png, info);
-	unsigned int h = png_get_image_height(png, info);
-	if (png_get_color_type(png, info) == PNG_COLOR_TYPE_PALETTE)
-		png_set_palette_to_rgb(png);
-	if (png_get_color_type(png, info) == PNG_COLOR_TYPE_GRAY || png_get_color_type(png, info) == PNG_COLOR_TYPE_GRAY_ALPHA)
-		png_set_gray_to_rgb(png);
-	if (!(png_get_color_type(png, info) & PNG_COLOR_MASK_ALPHA))
-		png_set_add_alpha(png, 0xff, PNG_FILLER_AFTER);
-	if (png_get_bit_depth(png, info) < 8)
-		png_set_packing(png);
-	if (png_get_bit_depth(png,info) == 16)
-		png_set_strip_16(png);
-	//Ok, should be 32-bit RGBA now.
-
-	png_read_update_info(png, info);
-	unsigned int rowbytes = png_get_rowbytes(png, info);
-	//Make sure it's the format we think it is...
-	assert(rowbytes == w*sizeof(uint32_t));
-
-	data->resize(w*h);
-	row_pointers = new png_bytep[h];
-	for (unsigned int r = 0; r < h; ++r) {
-		if (origin == LowerLeftOrigin) {
-			row_pointers[h-1-r] = (png_bytep)(&(*data)[r*w]);
-		} else {
-			row_pointers[r] = (png_bytep)(&(*data)[r*w]);
+	png_set_progressive_read_fn(png, &load, streaming_info, streaming_row, streaming_end);
+
+	//rows land in the destination as soon as they are decoded:
+	while (!load.done) {
+		png_bytep piece = nullptr;
+		size_t size = next(&piece);
+		if (size == 0) {
+			LOG_ERROR("  file ends before image data.");
+			png_destroy_read_struct(&png, &info, (png_infopp)NULL);
+			return false;
 		}
+		png_process_data(png, info, piece, png_size_t(size));
 	}
-	png_read_image(png, row_pointers);
-	png_destroy_read_struct(&png, &info, NULL);
-	delete[] row_pointers;
+	png_destroy_read_struct(&png, &info, (png_infopp)NULL);
 
-	*width = w;
-	*height = h;
+	*width = load.width;
+	*height = load.height;
 	return true;
 }
 
+bool load_png(std::istream &from, unsigned int *width, unsigned int *height, PNGDestination const &destination, OriginLocation origin) {
+	//feed the file through in pieces:
+	png_byte buffer[16384];
+	return load_progressive(width, height, destination, origin, [&](png_bytep *piece) {
+		from.read(reinterpret_cast< char * >(buffer), sizeof(buffer));
+		std::streamsize got = from.gcount();
+		*piece = buffer;
+		return size_t(got > 0 ? got : 0);
+	});
+}
+
+bool load_png(void const *data, size_t size, unsigned int *width, unsigned int *height, PNGDestination const &destination, OriginLocation origin) {
+	//all of the data is there already, so hand it over at once:
+	return load_progressive(width, height, destination, origin, [&](png_bytep *piece) {
+		*piece = reinterpret_cast< png_bytep >(const_cast< void * >(data));
+		size_t given = size;
+		size = 0;
+		return given;
+	});
+}
+
 
 void save_png(std::ostream &to, unsigned int width, unsigned int height, uint32_t const *data, OriginLocation origin) {
 //After the libpng example.c
@@ -167,3 +240,557 @@ void save_png(std::ostream &to, unsigned int width, unsigned int height, uint32_
 
 	return;
 }
+
+//------------ parallel save ------------
+
+namespace {
+	inline uint8_t paeth(uint8_t a, uint8_t b, uint8_t c) {
+		//(the usual predictor, rearranged: p - a = b - c, p - b = a - c, p - c = (b - c) + (a - c))
+		int32_t pa = int32_t(b) - int32_t(c);
+		int32_t pb = int32_t(a) - int32_t(c);
+		int32_t pc = std::abs(pa + pb);
+		pa = std::abs(pa);
+		pb = std::abs(pb);
+		return (pa <= pb && pa <= pc ? a : (pb <= pc ? b : c));
+	}
+
+	//sum of absolute values of filtered bytes taken as signed, libpng's measure of how well a filter did:
+	inline uint32_t cost(uint8_t v) {
+		return uint32_t(std::abs(int32_t(int8_t(v))));
+	}
+
+	//filter one row of RGBA8 pixels ('bytes' long; 'prev' is the row above, all zeros for the first row) into
+	// out[0] (filter type) and out[1..bytes], using 'scratch' (4 * bytes) to hold the candidates:
+	// picks the filter whose output has the smallest sum of absolute (signed) values, like libpng's adaptive filtering.
+	void filter_row(uint8_t const *row, uint8_t const *prev, uint32_t bytes, uint8_t *out, uint8_t *scratch) {
+		uint8_t *candidates[5] = { nullptr, scratch, scratch + bytes, scratch + 2 * bytes, scratch + 3 * bytes };
+		uint64_t sums[5] = { 0, 0, 0, 0, 0 };
+		uint32_t first = std::min(4U, bytes);
+
+		//None:
+		for (uint32_t i = 0; i < bytes; ++i) {
+			sums[0] += cost(row[i]);
+		}
+		{ //Sub:
+			uint8_t *o = candidates[1];
+			for (uint32_t i = 0; i < first; ++i) { o[i] = row[i]; sums[1] += cost(o[i]); }
+			for (uint32_t i = 4; i < bytes; ++i) { o[i] = uint8_t(row[i] - row[i - 4]); sums[1] += cost(o[i]); }
+		}
+		{ //Up:
+			uint8_t *o = candidates[2];
+			for (uint32_t i = 0; i < bytes; ++i) { o[i] = uint8_t(row[i] - prev[i]); sums[2] += cost(o[i]); }
+		}
+		{ //Average:
+			uint8_t *o = candidates[3];
+			for (uint32_t i = 0; i < first; ++i) { o[i] = uint8_t(row[i] - (prev[i] >> 1)); sums[3] += cost(o[i]); }
+			for (uint32_t i = 4; i < bytes; ++i) { o[i] = uint8_t(row[i] - ((uint32_t(row[i - 4]) + uint32_t(prev[i])) >> 1)); sums[3] += cost(o[i]); }
+		}
+		{ //Paeth (with a = c = 0 for the first pixel, the predictor is b):
+			uint8_t *o = candidates[4];
+			for (uint32_t i = 0; i < first; ++i) { o[i] = uint8_t(row[i] - prev[i]); sums[4] += cost(o[i]); }
+			for (uint32_t i = 4; i < bytes; ++i) { o[i] = uint8_t(row[i] - paeth(row[i - 4], prev[i], prev[i - 4])); sums[4] += cost(o[i]); }
+		}
+
+		uint32_t best = 0;
+		for (uint32_t filter = 1; filter < 5; ++filter) {
+			if (sums[filter] < sums[best]) best = filter;
+		}
+		out[0] = uint8_t(best);
+		std::memcpy(out + 1, (best ? candidates[best] : row), bytes);
+	}
+
+	void put_be32(uint8_t *at, uint32_t value) {
+		at[0] = uint8_t(value >> 24);
+		at[1] = uint8_t(value >> 16);
+		at[2] = uint8_t(value >> 8);
+		at[3] = uint8_t(value);
+	}
+
+	//write a chunk whose crc (over type and data) is already known:
+	void write_chunk(std::ostream &to, char const *type, uint8_t const *data, uint32_t size, uint32_t crc) {
+		uint8_t header[8];
+		put_be32(header, size);
+		std::memcpy(header + 4, type, 4);
+		to.write(reinterpret_cast< char const * >(header), 8);
+		to.write(reinterpret_cast< char const * >(data), size);
+		uint8_t footer[4];
+		put_be32(footer, crc);
+		to.write(reinterpret_cast< char const * >(footer), 4);
+	}
+
+	uint32_t chunk_crc(char const *type, uint8_t const *data, uint32_t size) {
+		uLong crc = crc32(0L, Z_NULL, 0);
+		crc = crc32(crc, reinterpret_cast< Bytef const * >(type), 4);
+		//(crc32 with no data returns the initial value rather than 'crc')
+		if (size) crc = crc32(crc, data, size);
+		return uint32_t(crc);
+	}
+
+	//signature and IHDR for an 8-bit RGBA image:
+	void write_header(std::ostream &to, uint32_t width, uint32_t height) {
+		static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+		to.write(reinterpret_cast< char const * >(signature), 8);
+
+		uint8_t ihdr[13];
+		put_be32(ihdr + 0, width);
+		put_be32(ihdr + 4, height);
+		ihdr[8] = 8; //bit depth
+		ihdr[9] = 6; //color type: RGBA
+		ihdr[10] = 0; //compression: deflate
+		ihdr[11] = 0; //filter method: adaptive
+		ihdr[12] = 0; //not interlaced
+		write_chunk(to, "IHDR", ihdr, 13, chunk_crc("IHDR", ihdr, 13));
+	}
+
+	void write_end(std::ostream &to) {
+		write_chunk(to, "IEND", nullptr, 0, chunk_crc("IEND", nullptr, 0));
+		if (!to) throw std::runtime_error("Failed to write png data.");
+	}
+}
+
+void save_png(std::string filename, unsigned int width, unsigned int height, uint32_t const *data, OriginLocation origin, WorkerPool &workers) {
+	std::ofstream file(filename.c_str(), std::ios::binary);
+	if (!file) throw std::runtime_error("Failed to open '" + filename + "' for writing.");
+	save_png(file, width, height, data, origin, workers);
+}
+
+void save_png(std::ostream &to, unsigned int width, unsigned int height, uint32_t const *data, OriginLocation origin, WorkerPool &workers) {
+	if (width == 0 || height == 0) throw std::runtime_error("Can't save an empty image as png.");
+
+	uint32_t const row_bytes = 1 + 4 * width; //filter type + pixels
+	auto row = [&](uint32_t y) {
+		//(png rows run top to bottom)
+		uint32_t const *pixels = (origin == UpperLeftOrigin ? &data[y * width] : &data[(height - 1 - y) * width]);
+		return reinterpret_cast< uint8_t const * >(pixels);
+	};
+
+	//filter every row (rows only depend on the unfiltered row above, so any split works):
+	std::vector< uint8_t > filtered(size_t(row_bytes) * height);
+	workers.parallel_for(height, [&](uint32_t begin, uint32_t end) {
+		std::vector< uint8_t > scratch(4 * 4 * width);
+		std::vector< uint8_t > zeros(4 * width, 0);
+		for (uint32_t y = begin; y < end; ++y) {
+			filter_row(row(y), (y ? row(y - 1) : zeros.data()), 4 * width, &filtered[size_t(y) * row_bytes], scratch.data());
+		}
+	}, 16);
+
+	//deflate stripes of rows independently:
+	struct Stripe {
+		size_t begin = 0, end = 0; //range of 'filtered'
+		std::vector< uint8_t > idat; //this stripe's IDAT chunk data
+		uint32_t adler = 0; //of filtered[begin,end)
+		uint32_t crc = 0; //of "IDAT" + idat
+		bool failed = false;
+	};
+	uint32_t stripe_count = std::max(1U, std::min((height + 15) / 16, workers.size() + 1));
+	std::vector< Stripe > stripes(stripe_count);
+	for (uint32_t s = 0; s < stripe_count; ++s) {
+		stripes[s].begin = size_t(uint64_t(height) * s / stripe_count) * row_bytes;
+		stripes[s].end = size_t(uint64_t(height) * (s + 1) / stripe_count) * row_bytes;
+	}
+
+	workers.parallel_for(stripe_count, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t s = begin; s < end; ++s) {
+			Stripe &stripe = stripes[s];
+			bool last = (s + 1 == stripe_count);
+			uLong length = uLong(stripe.end - stripe.begin);
+
+			z_stream z;
+			std::memset(&z, 0, sizeof(z));
+			//raw deflate (the zlib header and adler32 trailer are added around the whole set of stripes):
+			if (deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_FILTERED) != Z_OK) {
+				stripe.failed = true;
+				continue;
+			}
+			if (s > 0) {
+				//prime with the end of the previous stripe, so matches can reach back across the boundary:
+				size_t dictionary = std::min< size_t >(32768, stripe.begin);
+				deflateSetDictionary(&z, &filtered[stripe.begin - dictionary], uInt(dictionary));
+			}
+
+			size_t header = (s == 0 ? 2 : 0);
+			//(room for the sync-flush marker and the trailer, too)
+			stripe.idat.resize(header + deflateBound(&z, length) + 16);
+			if (s == 0) {
+				//CMF: deflate, 32k window; FLG: default level, check bits:
+				stripe.idat[0] = 0x78;
+				stripe.idat[1] = 0x9c;
+			}
+			z.next_in = &filtered[stripe.begin];
+			z.avail_in = uInt(length);
+			z.next_out = &stripe.idat[header];
+			z.avail_out = uInt(stripe.idat.size() - header);
+			//non-final stripes end with a sync flush, which leaves the output on a byte boundary and the stream open:
+			int result = deflate(&z, last ? Z_FINISH : Z_SYNC_FLUSH);
+			if (!(last ? result == Z_STREAM_END : (result == Z_OK && z.avail_in == 0 && z.avail_out != 0))) {
+				stripe.failed = true;
+			}
+			stripe.idat.resize(stripe.idat.size() - z.avail_out);
+			deflateEnd(&z);
+
+			stripe.adler = uint32_t(adler32(adler32(0L, Z_NULL, 0), &filtered[stripe.begin], uInt(length)));
+			if (!last) stripe.crc = chunk_crc("IDAT", stripe.idat.data(), uint32_t(stripe.idat.size()));
+		}
+	});
+
+	for (auto const &stripe : stripes) {
+		if (stripe.failed) throw std::runtime_error("Failed to deflate png data.");
+	}
+
+	{ //zlib trailer (adler32 of all the filtered data) goes on the end of the last stripe:
+		uLong adler = stripes[0].adler;
+		for (uint32_t s = 1; s < stripe_count; ++s) {
+			adler = adler32_combine(adler, stripes[s].adler, z_off_t(stripes[s].end - stripes[s].begin));
+		}
+		Stripe &last = stripes.back();
+		size_t at = last.idat.size();
+		last.idat.resize(at + 4);
+		put_be32(&last.idat[at], uint32_t(adler));
+		last.crc = chunk_crc("IDAT", last.idat.data(), uint32_t(last.idat.size()));
+	}
+
+	write_header(to, width, height);
+	for (auto const &stripe : stripes) {
+		write_chunk(to, "IDAT", stripe.idat.data(), uint32_t(stripe.idat.size()), stripe.crc);
+	}
+	write_end(to);
+}
+
+//------------ fast save ------------
+
+namespace {
+	//fixed filter choice: Up for every row but the first, which uses Sub (there is no row above it):
+	void filter_row_fixed(uint8_t const *row, uint8_t const *prev, uint32_t bytes, uint8_t *out) {
+		uint32_t i = 0;
+		if (prev) {
+			*(out++) = 2;
+#ifdef PNG_USE_SSE2
+			for (; i + 16 <= bytes; i += 16) {
+				__m128i a = _mm_loadu_si128(reinterpret_cast< __m128i const * >(row + i));
+				__m128i b = _mm_loadu_si128(reinterpret_cast< __m128i const * >(prev + i));
+				_mm_storeu_si128(reinterpret_cast< __m128i * >(out + i), _mm_sub_epi8(a, b));
+			}
+#endif
+			for (; i < bytes; ++i) out[i] = uint8_t(row[i] - prev[i]);
+		} else {
+			*(out++) = 1;
+			for (; i < std::min(4U, bytes); ++i) out[i] = row[i];
+#ifdef PNG_USE_SSE2
+			for (; i + 16 <= bytes; i += 16) {
+				__m128i a = _mm_loadu_si128(reinterpret_cast< __m128i const * >(row + i));
+				__m128i b = _mm_loadu_si128(reinterpret_cast< __m128i const * >(row + i - 4));
+				_mm_storeu_si128(reinterpret_cast< __m128i * >(out + i), _mm_sub_epi8(a, b));
+			}
+#endif
+			for (; i < bytes; ++i) out[i] = uint8_t(row[i] - row[i - 4]);
+		}
+	}
+
+	//deflate's length symbols (257..285) and extra bits for match lengths 3..258:
+	struct LengthCodes {
+		uint16_t symbol[259];
+		uint8_t extra_bits[259];
+		uint16_t extra[259];
+		LengthCodes() {
+			static const uint16_t base[29] = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+			static const uint8_t bits[29] = { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+			for (uint32_t code = 0; code < 29; ++code) {
+				uint32_t end = (code + 1 < 29 ? base[code + 1] : 259U);
+				for (uint32_t length = base[code]; length < end; ++length) {
+					symbol[length] = uint16_t(257 + code);
+					extra_bits[length] = bits[code];
+					extra[length] = uint16_t(length - base[code]);
+				}
+			}
+		}
+	};
+
+	//length-limited huffman code lengths for 'count' symbols (unused symbols get length 0):
+	// (in-place minimum-redundancy lengths after Moffat and Katajainen, then the overlong codes are
+	//  folded back under 'limit' by adjusting the per-length counts, as miniz does)
+	void huffman_lengths(uint32_t const *freq, uint32_t count, uint32_t limit, uint8_t *lengths) {
+		std::memset(lengths, 0, count);
+		struct Entry {
+			uint32_t key; //frequency, then parent index, then depth
+			uint32_t symbol;
+		};
+		std::vector< Entry > A;
+		for (uint32_t s = 0; s < count; ++s) {
+			if (freq[s]) A.push_back(Entry{ freq[s], s });
+		}
+		int32_t n = int32_t(A.size());
+		if (n == 0) return;
+		if (n == 1) {
+			lengths[A[0].symbol] = 1;
+			return;
+		}
+		std::sort(A.begin(), A.end(), [](Entry const &a, Entry const &b) { return a.key < b.key; });
+
+		A[0].key += A[1].key;
+		int32_t root = 0, leaf = 2;
+		for (int32_t next = 1; next < n - 1; ++next) {
+			if (leaf >= n || A[root].key < A[leaf].key) { A[next].key = A[root].key; A[root++].key = uint32_t(next); }
+			else A[next].key = A[leaf++].key;
+			if (leaf >= n || (root < next && A[root].key < A[leaf].key)) { A[next].key += A[root].key; A[root++].key = uint32_t(next); }
+			else A[next].key += A[leaf++].key;
+		}
+		A[n - 2].key = 0;
+		for (int32_t next = n - 3; next >= 0; --next) A[next].key = A[A[next].key].key + 1;
+		{
+			int32_t available = 1, used = 0, depth = 0, next = n - 1;
+			root = n - 2;
+			while (available > 0) {
+				while (root >= 0 && int32_t(A[root].key) == depth) { ++used; --root; }
+				while (available > used) { A[next--].key = uint32_t(depth); --available; }
+				available = 2 * used;
+				++depth;
+				used = 0;
+			}
+		}
+
+		uint32_t per_length[64] = { 0 };
+		for (auto const &e : A) per_length[std::min(e.key, 63U)] += 1;
+		for (uint32_t l = limit + 1; l < 64; ++l) {
+			per_length[limit] += per_length[l];
+			per_length[l] = 0;
+		}
+		uint64_t total = 0;
+		for (uint32_t l = limit; l > 0; --l) total += uint64_t(per_length[l]) << (limit - l);
+		while (total != (uint64_t(1) << limit)) {
+			per_length[limit] -= 1;
+			for (uint32_t l = limit - 1; l > 0; --l) {
+				if (per_length[l]) {
+					per_length[l] -= 1;
+					per_length[l + 1] += 2;
+					break;
+				}
+			}
+			total -= 1;
+		}
+
+		//shortest codes to the most frequent symbols (the end of 'A'):
+		int32_t j = n;
+		for (uint32_t l = 1; l <= limit; ++l) {
+			for (uint32_t c = per_length[l]; c > 0; --c) lengths[A[--j].symbol] = uint8_t(l);
+		}
+	}
+
+	//canonical codes for the given lengths, bit-reversed (deflate sends huffman codes most-significant bit first):
+	void huffman_codes(uint8_t const *lengths, uint32_t count, uint16_t *codes) {
+		uint32_t per_length[16] = { 0 };
+		for (uint32_t s = 0; s < count; ++s) per_length[lengths[s]] += 1;
+		per_length[0] = 0;
+		uint32_t next[16] = { 0 };
+		for (uint32_t l = 1; l < 16; ++l) next[l] = (next[l - 1] + per_length[l - 1]) << 1;
+		for (uint32_t s = 0; s < count; ++s) {
+			uint32_t l = lengths[s];
+			if (!l) { codes[s] = 0; continue; }
+			uint32_t code = next[l]++;
+			uint32_t reversed = 0;
+			for (uint32_t b = 0; b < l; ++b) reversed |= ((code >> b) & 1) << (l - 1 - b);
+			codes[s] = uint16_t(reversed);
+		}
+	}
+
+	//bits go out least-significant first; 'at' must have room (the caller reserves per block):
+	struct BitWriter {
+		uint8_t *at = nullptr;
+		uint64_t bits = 0;
+		uint32_t count = 0;
+		void put(uint32_t value, uint32_t length) { //length <= 32
+			bits |= uint64_t(value) << count;
+			count += length;
+			if (count >= 32) {
+				at[0] = uint8_t(bits);
+				at[1] = uint8_t(bits >> 8);
+				at[2] = uint8_t(bits >> 16);
+				at[3] = uint8_t(bits >> 24);
+				at += 4;
+				bits >>= 32;
+				count -= 32;
+			}
+		}
+		void align() {
+			while (count > 0) {
+				*(at++) = uint8_t(bits);
+				bits >>= 8;
+				count = (count > 8 ? count - 8 : 0);
+			}
+			bits = 0;
+		}
+	};
+
+	inline uint64_t load64(uint8_t const *at) {
+		uint64_t value;
+		std::memcpy(&value, at, 8);
+		return value;
+	}
+
+	//deflate 'data' into a zlib stream appended to 'out', trading ratio for speed:
+	// the only matches looked for are repeats of the previous filtered pixel (distance 4) -- runs of
+	// zeros where the image is flat, in particular -- and each block of tokens gets its own dynamic huffman codes.
+	void deflate_fast(uint8_t const *data, size_t size, std::vector< uint8_t > *out) {
+		static const LengthCodes length_codes;
+		enum : uint32_t { BlockTokens = 1 << 16, MinMatch = 3, MaxMatch = 258 };
+		//order in which code length code lengths are sent:
+		static const uint8_t cl_order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+		//CMF: deflate, 32k window; FLG: fastest level, check bits:
+		out->push_back(0x78);
+		out->push_back(0x01);
+
+		std::vector< uint16_t > tokens(BlockTokens); //literal bytes, or 256 + (length - MinMatch) for a distance-4 match
+		BitWriter writer;
+		size_t written = out->size();
+		size_t i = 0;
+		while (true) {
+			uint32_t lit_freq[286] = { 0 };
+			uint32_t token_count = 0;
+			while (i < size && token_count < BlockTokens) {
+				if (i >= 4 && i + MinMatch <= size && data[i] == data[i - 4] && data[i + 1] == data[i - 3] && data[i + 2] == data[i - 2]) {
+					size_t length = MinMatch;
+					size_t longest = std::min< size_t >(MaxMatch, size - i);
+					while (length + 8 <= longest && load64(data + i + length) == load64(data + i + length - 4)) length += 8;
+					while (length < longest && data[i + length] == data[i + length - 4]) ++length;
+					tokens[token_count++] = uint16_t(256 + length - MinMatch);
+					lit_freq[length_codes.symbol[length]] += 1;
+					i += length;
+				} else {
+					tokens[token_count++] = data[i];
+					lit_freq[data[i]] += 1;
+					i += 1;
+				}
+			}
+			bool last = (i == size);
+
+			//codes for this block (always at least two literal/length symbols, so the code is complete):
+			lit_freq[256] = 1;
+			if (token_count == 0) lit_freq[0] = 1;
+			uint8_t lengths[286 + 4];
+			huffman_lengths(lit_freq, 286, 15, lengths);
+			uint32_t lit_count = 286;
+			while (lit_count > 257 && lengths[lit_count - 1] == 0) --lit_count;
+			//only distance 4 (code 3) is used; give it a one-bit code, paired with code 0 to keep the code complete:
+			uint32_t const dist_count = 4;
+			uint8_t *dist_lengths = lengths + lit_count;
+			dist_lengths[0] = 1; dist_lengths[1] = 0; dist_lengths[2] = 0; dist_lengths[3] = 1;
+			uint16_t lit_codes[286] = { 0 };
+			huffman_codes(lengths, lit_count, lit_codes);
+			uint32_t const dist_code = 1; //(canonical: code 0 -> 0, code 3 -> 1)
+
+			//run-length encode the code lengths (symbols 0-15, 16 = repeat previous, 17/18 = runs of zeros):
+			uint8_t cl_symbols[286 + 4], cl_extra[286 + 4];
+			uint32_t cl_count = 0;
+			uint32_t cl_freq[19] = { 0 };
+			uint32_t total = lit_count + dist_count;
+			for (uint32_t at = 0; at < total; ) {
+				uint8_t length = lengths[at];
+				uint32_t run = 1;
+				while (at + run < total && lengths[at + run] == length) ++run;
+				at += run;
+				auto emit = [&](uint8_t symbol, uint8_t extra) {
+					cl_symbols[cl_count] = symbol;
+					cl_extra[cl_count] = extra;
+					++cl_count;
+					cl_freq[symbol] += 1;
+				};
+				if (length == 0) {
+					while (run >= 11) { uint32_t r = std::min(run, 138U); emit(18, uint8_t(r - 11)); run -= r; }
+					if (run >= 3) { emit(17, uint8_t(run - 3)); run = 0; }
+					while (run > 0) { emit(0, 0); --run; }
+				} else {
+					emit(length, 0);
+					run -= 1;
+					while (run >= 3) { uint32_t r = std::min(run, 6U); emit(16, uint8_t(r - 3)); run -= r; }
+					while (run > 0) { emit(length, 0); --run; }
+				}
+			}
+			uint8_t cl_lengths[19];
+			huffman_lengths(cl_freq, 19, 7, cl_lengths);
+			uint16_t cl_codes[19];
+			huffman_codes(cl_lengths, 19, cl_codes);
+			uint32_t cl_sent = 19;
+			while (cl_sent > 4 && cl_lengths[cl_order[cl_sent - 1]] == 0) --cl_sent;
+
+			//worst case: a 15-bit literal/length code, 5 extra bits and a distance bit per token, plus the header:
+			out->resize(written + size_t(token_count) * 3 + 1024);
+			writer.at = out->data() + written;
+
+			writer.put(last ? 1 : 0, 1);
+			writer.put(2, 2); //dynamic huffman codes
+			writer.put(lit_count - 257, 5);
+			writer.put(dist_count - 1, 5);
+			writer.put(cl_sent - 4, 4);
+			for (uint32_t c = 0; c < cl_sent; ++c) writer.put(cl_lengths[cl_order[c]], 3);
+			static const uint8_t cl_extra_bits[19] = { 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 2, 3, 7 };
+			for (uint32_t c = 0; c < cl_count; ++c) {
+				uint8_t symbol = cl_symbols[c];
+				writer.put(cl_codes[symbol], cl_lengths[symbol]);
+				if (cl_extra_bits[symbol]) writer.put(cl_extra[c], cl_extra_bits[symbol]);
+			}
+
+			//matches are sent as one run of bits -- length code, extra bits, distance code -- looked up per length:
+			uint32_t match_bits[MaxMatch - MinMatch + 1];
+			uint8_t match_count[MaxMatch - MinMatch + 1];
+			for (uint32_t length = MinMatch; length <= MaxMatch; ++length) {
+				uint32_t symbol = length_codes.symbol[length];
+				uint32_t bits = lit_codes[symbol];
+				uint32_t count = lengths[symbol];
+				bits |= uint32_t(length_codes.extra[length]) << count;
+				count += length_codes.extra_bits[length];
+				bits |= dist_code << count;
+				count += 1;
+				match_bits[length - MinMatch] = bits;
+				match_count[length - MinMatch] = uint8_t(count);
+			}
+			for (uint32_t t = 0; t < token_count; ++t) {
+				uint32_t token = tokens[t];
+				if (token < 256) writer.put(lit_codes[token], lengths[token]);
+				else writer.put(match_bits[token - 256], match_count[token - 256]);
+			}
+			writer.put(lit_codes[256], lengths[256]);
+
+			if (last) writer.align();
+			written = writer.at - out->data();
+			if (last) break;
+		}
+		out->resize(written);
+
+		size_t at = out->size();
+		out->resize(at + 4);
+		put_be32(&(*out)[at], uint32_t(adler32(adler32(0L, Z_NULL, 0), data, uInt(size))));
+	}
+}
+
+void save_png_fast(std::string filename, unsigned int width, unsigned int height, uint32_t const *data, OriginLocation origin) {
+	std::ofstream file(filename.c_str(), std::ios::binary);
+	if (!file) throw std::runtime_error("Failed to open '" + filename + "' for writing.");
+	save_png_fast(file, width, height, data, origin);
+}
+
+void save_png_fast(std::ostream &to, unsigned int width, unsigned int height, uint32_t const *data, OriginLocation origin) {
+	if (width == 0 || height == 0) throw std::runtime_error("Can't save an empty image as png.");
+
+	uint32_t const row_bytes = 1 + 4 * width;
+	auto row = [&](uint32_t y) {
+		uint32_t const *pixels = (origin == UpperLeftOrigin ? &data[y * width] : &data[(height - 1 - y) * width]);
+		return reinterpret_cast< uint8_t const * >(pixels);
+	};
+
+	std::vector< uint8_t > filtered(size_t(row_bytes) * height);
+	for (uint32_t y = 0; y < height; ++y) {
+		filter_row_fixed(row(y), (y ? row(y - 1) : nullptr), 4 * width, &filtered[size_t(y) * row_bytes]);
+	}
+
+	std::vector< uint8_t > idat;
+	uint32_t const IDATChunkSize = 1 << 20;
+	deflate_fast(filtered.data(), filtered.size(), &idat);
+
+	write_header(to, width, height);
+	//(split up, since decoders may refuse very large chunks)
+	for (size_t at = 0; at < idat.size(); at += IDATChunkSize) {
+		uint32_t size = uint32_t(std::min< size_t >(IDATChunkSize, idat.size() - at));
+		write_chunk(to, "IDAT", &idat[at], size, chunk_crc("IDAT", &idat[at], size));
+	}
+	write_end(to);
+}
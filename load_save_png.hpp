@@ -2,6 +2,7 @@
 
 #include <string>
 #include <vector>
+#include <functional>
 #include <stdint.h>
 
 /*
@@ -18,3 +19,41 @@ void save_png(std::string filename, unsigned int width, unsigned int height, uin
 
 bool load_png(std::istream &from, unsigned int *width, unsigned int *height, std::vector< uint32_t > *data, OriginLocation origin = UpperLeftOrigin);
 void save_png(std::ostream &to, unsigned int width, unsigned int height, uint32_t const *data, OriginLocation origin = UpperLeftOrigin);
+
+/*
+ * Streaming load: decodes with libpng's progressive reader, writing each row straight into memory
+ * supplied by the caller -- e.g., a mapped GL_PIXEL_UNPACK_BUFFER -- as soon as it is decoded.
+ * Once the size is known, 'destination(width, height)' is called (exactly once) and must return room for
+ * width * height tightly-packed RGBA pixels, or nullptr to abandon the load. Rows are placed according to 'origin'.
+ * There is no intermediate copy of the image and no allocation beyond libpng's own state.
+ * (Interlaced images are combined in place, so their destination is read back as well as written.)
+ */
+
+typedef std::function< uint32_t *(unsigned int width, unsigned int height) > PNGDestination;
+
+bool load_png(std::string filename, unsigned int *width, unsigned int *height, PNGDestination const &destination, OriginLocation origin);
+bool load_png(std::istream &from, unsigned int *width, unsigned int *height, PNGDestination const &destination, OriginLocation origin = UpperLeftOrigin);
+//(or from a PNG file already in memory, e.g., a MappedFile)
+bool load_png(void const *data, size_t size, unsigned int *width, unsigned int *height, PNGDestination const &destination, OriginLocation origin = UpperLeftOrigin);
+
+/*
+ * Parallel save: same format as above, but rows are filtered and deflated in horizontal stripes
+ * spread over 'workers'. Each stripe is deflated separately (ending on a sync-flush boundary, with the
+ * previous stripe's tail as its dictionary) and written as its own IDAT chunk; together they form one zlib stream.
+ * Throws on failure.
+ */
+
+struct WorkerPool;
+
+void save_png(std::string filename, unsigned int width, unsigned int height, uint32_t const *data, OriginLocation origin, WorkerPool &workers);
+void save_png(std::ostream &to, unsigned int width, unsigned int height, uint32_t const *data, OriginLocation origin, WorkerPool &workers);
+
+/*
+ * Fast save: same format again, but tuned for screenshots and frame dumps on a single thread.
+ * Rows use a fixed filter (Up; Sub for the first row) computed with SSE2 where available, and the deflate
+ * stream only encodes repeats of the previous pixel, with per-block huffman codes. Files come out somewhat
+ * larger than with libpng, in a fraction of the time. Throws on failure.
+ */
+
+void save_png_fast(std::string filename, unsigned int width, unsigned int height, uint32_t const *data, OriginLocation origin);
+void save_png_fast(std::ostream &to, unsigned int width, unsigned int height, uint32_t const *data, OriginLocation origin = UpperLeftOrigin);
@@ -2,7 +2,21 @@
 #include "GL.hpp"
 #include "Meshes.hpp"
 #include "Scene.hpp"
-#include "read_chunk.hpp"
+#include "LightClusters.hpp"
+#include "BVH.hpp"
+#include "OcclusionBuffer.hpp"
+#include "Checkpoint.hpp"
+#include "WorkerPool.hpp"
+#include "FileWatcher.hpp"
+#include "GLState.hpp"
+#include "FrameUniforms.hpp"
+#include "StreamingBuffer.hpp"
+#include "TripleBuffer.hpp"
+#include "SceneShader.hpp"
+#include "ProgramCache.hpp"
+#include "SceneFile.hpp"
+#include "Screenshots.hpp"
+#include "VideoCapture.hpp"
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <SDL.h>
@@ -17,17 +31,46 @@
 #include <fstream>
 #include <cmath>
 #include <thread>
-
-static GLuint compile_shader(GLenum type, std::string const &source);
-static GLuint link_program(GLuint vertex_shader, GLuint fragment_shader);
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
 
 int main(int argc, char **argv) {
 	//Configuration:
 	struct {
 		std::string title = "Cube Volleyball";
 		glm::uvec2 size = glm::uvec2(640, 480);
+		std::string checkpoint = "checkpoint.bin"; //F5 saves here, F9 restores
+		bool restore_checkpoint = false; //restore before the first frame
+		float tick = 1.0f / 240.0f; //input + simulation step length (rendering runs separately, at the display rate)
+		std::string trace; //if set, record GL calls here (for gl-replay)
+		uint32_t trace_frames = 0;
+		VideoCapture::Format record_format = VideoCapture::PNGSequence; //F10 starts/stops recording in this format
+		bool fog = false; //draw with the scene shader's fog feature
 	} config;
 
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--checkpoint" && argi + 1 < argc) {
+			config.checkpoint = argv[++argi];
+			config.restore_checkpoint = true;
+		} else if (arg == "--trace" && argi + 2 < argc) {
+			config.trace = argv[++argi];
+			config.trace_frames = uint32_t(std::max(1, std::atoi(argv[++argi])));
+		} else if (arg == "--record-format" && argi + 1 < argc && (std::string(argv[argi+1]) == "png" || std::string(argv[argi+1]) == "y4m")) {
+			config.record_format = (std::string(argv[++argi]) == "y4m" ? VideoCapture::Y4M : VideoCapture::PNGSequence);
+		} else if (arg == "--fog") {
+			config.fog = true;
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--checkpoint <file>] [--trace <file> <frames>] [--record-format png|y4m] [--fog]" << std::endl;
+			return 1;
+		}
+	}
+
 	//------------  initialization ------------
 
 	//Initialize SDL library:
@@ -88,375 +131,599 @@ int main(int argc, char **argv) {
 	//Hide mouse cursor (note: showing can be useful for debugging):
 	//SDL_ShowCursor(SDL_DISABLE);
 
-	//------------ opengl objects / game assets ------------
-
-	//shader program:
-	GLuint program = 0;
-	GLuint program_Position = 0;
-	GLuint program_Normal = 0;
-	GLuint program_Color = 0;
-	GLuint program_mvp = 0;
-	GLuint program_itmv = 0;
-	GLuint program_to_light = 0;
-	{ //compile shader program:
-		GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER,
-			"#version 330\n"
-			"uniform mat4 mvp;\n"
-			"uniform mat3 itmv;\n"
-			"in vec4 Position;\n"
-			"in vec3 Normal;\n"
-			"in vec3 Color;\n"
-			"out vec3 normal;\n"
-			"out vec3 color;\n"
-			"void main() {\n"
-			"	gl_Position = mvp * Position;\n"
-			"	normal = itmv * Normal;\n"
-			"   color = Color;\n"
-			"}\n"
-		);
-
-		GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER,
-			"#version 330\n"
-			"uniform vec3 to_light;\n"
-			"in vec3 normal;\n"
-			"in vec3 color;\n"
-			"out vec4 fragColor;\n"
-			"void main() {\n"
-			"   vec3 l = mix(normal,to_light,0.9);\n"
-			"	float light = max(0.0, dot(normalize(normal), l));\n"
-			"	fragColor = vec4(light * color, 1.0);\n"
-			"}\n"
-		);
-
-		program = link_program(fragment_shader, vertex_shader);
-
-		//look up attribute locations:
-		program_Position = glGetAttribLocation(program, "Position");
-		if (program_Position == -1U) throw std::runtime_error("no attribute named Position");
-		program_Normal = glGetAttribLocation(program, "Normal");
-		if (program_Normal == -1U) throw std::runtime_error("no attribute named Normal");
-		program_Color = glGetAttribLocation(program, "Color");
-		if (program_Color == -1U) throw std::runtime_error("no attribute named Color");
-
-		//look up uniform locations:
-		program_mvp = glGetUniformLocation(program, "mvp");
-		if (program_mvp == -1U) throw std::runtime_error("no uniform named mvp");
-		program_itmv = glGetUniformLocation(program, "itmv");
-		if (program_itmv == -1U) throw std::runtime_error("no uniform named itmv");
-
-		program_to_light = glGetUniformLocation(program, "to_light");
-		if (program_to_light == -1U) throw std::runtime_error("no uniform named to_light");
+	//Start capturing GL calls (before any are made, so the trace can be replayed from scratch):
+	if (config.trace != "") {
+		GLTrace::start(config.trace, config.trace_frames);
 	}
 
-	//------------ meshes ------------
+	//GL objects (and the render thread that draws with them) live in this scope, so they are
+	// destroyed while the context still exists:
+	{
+		//------------ opengl objects / game assets ------------
 
-	Meshes meshes;
+		//all drawing sets state through this, so redundant calls are skipped:
+		GLState gl;
 
-	{ //add meshes to database:
-		Meshes::Attributes attributes;
-		attributes.Position = program_Position;
-		attributes.Normal = program_Normal;
-		attributes.Color = program_Color;
+		//shader programs (linked binaries are cached between launches, where the driver allows):
+		ProgramCache program_cache("programs.cache");
+		SceneShader scene_shader(gl, &program_cache);
+		GLuint program = scene_shader.program;
+		//(variants picked per frame -- see the render thread -- are built ahead of time where listed, so the first frames don't stall)
+		scene_shader.prewarm("shaders/scene.variants", gl);
 
-		meshes.load("meshes.blob", attributes);
-	}
+		//------------ workers / lighting ------------
 
-	//------------ scene ------------
-
-	Scene scene;
-	//set up camera parameters based on window:
-	scene.camera.fovy = glm::radians(60.0f);
-	scene.camera.aspect = float(config.size.x) / float(config.size.y);
-	scene.camera.near_plane = 0.01f;
-	//(transform will be handled in the update function below)
-
-	//add some objects from the mesh library:
-	auto add_object = [&](std::string const &name, glm::vec3 const &position, glm::quat const &rotation, glm::vec3 const &scale) -> Scene::Object & {
-		Mesh const &mesh = meshes.get(name);
-		Scene::Object object;
-		object.transform.position = position;
-		object.transform.rotation = rotation;
-		object.transform.scale = scale;
-		object.vao = mesh.vao;
-		object.start = mesh.start;
-		object.count = mesh.count;
-		object.program = program;
-		object.program_mvp = program_mvp;
-		object.program_itmv = program_itmv;
-		scene.objects[name]=object;
-		return scene.objects[name];
-	};
-
-
-	{ //read objects to add from "scene.blob":
-		std::ifstream file("scene.blob", std::ios::binary);
-
-		std::vector< char > strings;
-		//read strings chunk:
-		read_chunk(file, "str0", &strings);
-
-		{ //read scene chunk, add meshes to scene:
-			struct SceneEntry {
-				uint32_t name_begin, name_end;
-				glm::vec3 position;
-				glm::quat rotation;
-				glm::vec3 scale;
-			};
-			static_assert(sizeof(SceneEntry) == 48, "Scene entry should be packed");
-
-			std::vector< SceneEntry > data;
-			read_chunk(file, "scn0", &data);
-
-			for (auto const &entry : data) {
-				if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
-					throw std::runtime_error("index entry has out-of-range name begin/end");
-				}
-				std::string name(&strings[0] + entry.name_begin, &strings[0] + entry.name_end);
-				add_object(name, entry.position, entry.rotation, entry.scale);
-			}
-		}
-	}
+		WorkerPool workers;
 
-	//add_object("Link3", glm::vec3(0.0f, 0.0f, 1.0f), glm::quat(0.0f, 0.0f, 0.0f, 1.0f), glm::vec3(1.0f));
+		LightClusters light_clusters;
 
-	
+		FrameUniforms frame_uniforms;
 
-	glm::vec2 mouse = glm::vec2(0.0f, 0.0f); //mouse position in [-1,1]x[-1,1] coordinates
+		//per-frame dynamic data (uniform blocks, instances) is sub-allocated from here:
+		StreamingBuffer streaming;
 
-	struct {
-		float radius = 18.0f;
-		float elevation = -10.0f;
-		float azimuth = 0.0f;
-		glm::vec3 target = glm::vec3(0.0f, 0.0f, 0.0f);
-	} camera;
-
-	//------------ game loop ------------
-
-	float p1y = 0.0f, p1z = 0.0f, p2y = 0.0f, p2z = 0.0f;
-	float by = 0.0f, bz = 0.0f;
-	int hits = 0;
-	int lastHit = 1;
-	auto player1 = &scene.objects["Cube"];
-	auto player2 = &scene.objects["Cube.001"];
-	auto ball = &scene.objects["Sphere"];
-	ball->transform.position.z = 7.5f;
-
-	bool should_quit = false;
-	while (true) {
-		static SDL_Event evt;
-		while (SDL_PollEvent(&evt) == 1) {
-			//handle input:
-			if (evt.type == SDL_MOUSEMOTION) {
-			}
-			else if (evt.type == SDL_MOUSEBUTTONDOWN) {
-			}
-			else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_ESCAPE) {
-				should_quit = true;
-			}
-			else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_w && p1z == 0.0f && player1->transform.position.z == 0.5f) {
-				p1z = 10.0f;
-			}
-			else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_UP && p2z == 0.0f && player2->transform.position.z == 0.5f) {
-				p2z = 10.0f;
-			}
-			else if (evt.type == SDL_QUIT) {
-				should_quit = true;
-				break;
-			}
+		//F12 saves the frame here, without waiting on the GPU:
+		Screenshots screenshots;
+		//F10 records every frame (encoded on background threads):
+		VideoCapture video;
+
+		//------------ meshes ------------
+
+		Meshes meshes;
+
+		//add meshes to database:
+		meshes.load("meshes.blob", scene_shader.attributes);
+
+		//------------ scene ------------
+
+		Scene scene;
+		//set up camera parameters based on window:
+		scene.camera.fovy = glm::radians(60.0f);
+		scene.camera.aspect = float(config.size.x) / float(config.size.y);
+		scene.camera.near_plane = 0.01f;
+		//(transform will be handled in the update function below)
+
+		//point an object at a mesh from the library (also used when meshes are reloaded):
+		auto apply_mesh = [&](Scene::Object &object, Mesh const &mesh) {
+			object.vao = mesh.vao;
+			object.start = mesh.start;
+			object.count = mesh.count;
+			object.bounds = mesh.bounds;
+			object.sphere = mesh.sphere;
+		};
+
+		//object placements from the exporter:
+		SceneFile scene_file;
+
+		//read "scene.blob", adding new objects and moving existing ones:
+		// returns the names of entries that changed since the last read.
+		auto read_scene = [&]() -> std::vector< std::string > {
+			return scene_file.read("scene.blob", &scene, [&](std::string const &name, Scene::Object &object) {
+				apply_mesh(object, meshes.get(name));
+				object.program = program;
+			});
+		};
+
+		//read objects to add from "scene.blob":
+		read_scene();
+
+		//arena floor, net, and walls hide most everything else from some views:
+		for (auto const &name : { "Plane", "Cube.002", "Cube.003", "Cube.004", "Cube.005" }) {
+			auto f = scene.objects.find(name);
+			if (f != scene.objects.end()) f->second.occluder = true;
 		}
-		if (should_quit) break;
-
-		auto current_time = std::chrono::high_resolution_clock::now();
-		static auto previous_time = current_time;
-		float elapsed = std::chrono::duration< float >(current_time - previous_time).count();
-		previous_time = current_time;
-
-		{ //update game state:
-			auto state = SDL_GetKeyboardState(nullptr);
-			if (state[SDL_SCANCODE_A] && !state[SDL_SCANCODE_D])
-				p1y = 5.0f;
-			else if (!state[SDL_SCANCODE_A] && state[SDL_SCANCODE_D])
-				p1y = -5.0f;
-			else
-				p1y = 0.0f;
-			if (state[SDL_SCANCODE_LEFT] && !state[SDL_SCANCODE_RIGHT])
-				p2y = 5.0f;
-			else if (!state[SDL_SCANCODE_LEFT] && state[SDL_SCANCODE_RIGHT])
-				p2y = -5.0f;
-			else
-				p2y = 0.0f;
-
-			//Player and ball collision
-			if ((abs(ball->transform.position.z - player1->transform.position.z) <= 1.0f &&
-					abs(ball->transform.position.y - player1->transform.position.y) <= 0.5f) ||
-				(abs(ball->transform.position.z - player1->transform.position.z) <= 0.5f &&
-					abs(ball->transform.position.y - player1->transform.position.y) <= 1.0f) ||
-				std::pow(ball->transform.position.y- player1->transform.position.y + 0.5f,2.0f) + 
-					std::pow(ball->transform.position.z - player1->transform.position.z + 0.5f, 2.0f) <= 0.25 ||
-				std::pow(ball->transform.position.y - player1->transform.position.y - 0.5f, 2.0f) +
-					std::pow(ball->transform.position.z - player1->transform.position.z + 0.5f, 2.0f) <= 0.25 || 
-				std::pow(ball->transform.position.y - player1->transform.position.y + 0.5f, 2.0f) +
-					std::pow(ball->transform.position.z - player1->transform.position.z - 0.5f, 2.0f) <= 0.25 || 
-				std::pow(ball->transform.position.y - player1->transform.position.y - 0.5f, 2.0f) +
-					std::pow(ball->transform.position.z - player1->transform.position.z - 0.5f, 2.0f) <= 0.25){
-				if (lastHit != 1) {
-					lastHit = 1;
-					hits = 0;
+		OcclusionBuffer occlusion(workers);
+		scene.occlusion = &occlusion;
+		scene.variants = &scene_shader;
+
+		//hierarchy for picking and other spatial queries (kept up to date as objects move):
+		BVH bvh;
+		bvh.build(scene);
+
+		//pick up edits from the exporter while running:
+		FileWatcher watcher;
+		watcher.watch("meshes.blob");
+		watcher.watch("scene.blob");
+		watcher.watch(SceneShader::VertexPath);
+		watcher.watch(SceneShader::FragmentPath);
+
+		glm::vec2 mouse = glm::vec2(0.0f, 0.0f); //mouse position in [-1,1]x[-1,1] coordinates
+
+		struct {
+			float radius = 18.0f;
+			float elevation = -10.0f;
+			float azimuth = 0.0f;
+			glm::vec3 target = glm::vec3(0.0f, 0.0f, 0.0f);
+		} camera;
+
+		//------------ game loop ------------
+
+		float p1y = 0.0f, p1z = 0.0f, p2y = 0.0f, p2z = 0.0f;
+		float by = 0.0f, bz = 0.0f;
+		int hits = 0;
+		int lastHit = 1;
+		auto player1 = &scene.objects["Cube"];
+		auto player2 = &scene.objects["Cube.001"];
+		auto ball = &scene.objects["Sphere"];
+		ball->transform.position.z = 7.5f;
+
+		auto save_match = [&]() {
+			MatchState match;
+			match.player1_velocity = glm::vec2(p1y, p1z);
+			match.player2_velocity = glm::vec2(p2y, p2z);
+			match.ball_velocity = glm::vec2(by, bz);
+			match.hits = hits;
+			match.last_hit = lastHit;
+			save_checkpoint(config.checkpoint, scene, match);
+			std::cout << "Saved checkpoint to '" << config.checkpoint << "'." << std::endl;
+		};
+		auto restore_match = [&]() {
+			MatchState match;
+			load_checkpoint(config.checkpoint, &scene, &match);
+			p1y = match.player1_velocity.x; p1z = match.player1_velocity.y;
+			p2y = match.player2_velocity.x; p2z = match.player2_velocity.y;
+			by = match.ball_velocity.x; bz = match.ball_velocity.y;
+			hits = match.hits;
+			lastHit = match.last_hit;
+			std::cout << "Restored checkpoint from '" << config.checkpoint << "'." << std::endl;
+		};
+
+		{ //lights:
+			//sun (shining down, slightly toward -y):
+			scene.lights.emplace_back();
+			Scene::Light &sun = scene.lights.back();
+			sun.type = Scene::Light::Directional;
+			sun.transform.rotation = glm::angleAxis(-std::atan2(1.0f, 10.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+
+			//glow that follows the ball:
+			scene.lights.emplace_back();
+			Scene::Light &glow = scene.lights.back();
+			glow.type = Scene::Light::Point;
+			glow.intensity = glm::vec3(0.6f, 0.5f, 0.3f);
+			glow.range = 4.0f;
+			glow.transform.set_parent(&ball->transform);
+		}
+
+		if (config.restore_checkpoint) {
+			restore_match();
+			bvh.build(scene);
+		}
+
+		//------------ render thread ------------
+
+		//From here on the render thread owns the GL context, and the main thread runs input + simulation,
+		// handing over snapshots of the scene; a slow swap or vsync wait never holds up the simulation.
+		TripleBuffer< Scene::Snapshot > snapshots;
+		std::atomic< bool > render_quit(false);
+		std::atomic< bool > print_stats(false);
+		std::atomic< bool > take_screenshot(false);
+		std::atomic< bool > toggle_recording(false);
+
+		//work that needs the GL context, queued by the main thread:
+		std::mutex render_jobs_mutex;
+		std::vector< std::function< void() > > render_jobs;
+
+		//held by render jobs that change 'meshes', and by the main thread while reading from it:
+		std::mutex meshes_mutex;
+		std::vector< std::string > reloaded_meshes; //(guarded by meshes_mutex) to be re-applied to objects
+
+		//set by the render thread when an edited shader has been swapped in, for objects to be pointed at:
+		// (SceneShader::generation in the high 32 bits and the new program in the low 32, so the two are read together)
+		std::atomic< uint64_t > reloaded_program(0);
+
+		SDL_GL_MakeCurrent(window, nullptr);
+		std::thread render_thread([&]() {
+			SDL_GL_MakeCurrent(window, context);
+			std::vector< std::function< void() > > jobs;
+			uint32_t screenshot_index = 0;
+			while (!render_quit) {
+				{ //run queued jobs:
+					std::lock_guard< std::mutex > lock(render_jobs_mutex);
+					jobs.swap(render_jobs);
 				}
-				if(bz < 0.0f)
-					hits++;
-				by += (ball->transform.position.y - player1->transform.position.y) + p1y;
-				float temp = bz;
-				bz = p1z + 2.0f;
-				if (p1z != 0.0f)
-					p1z = temp;
-			}
-			else if ((abs(ball->transform.position.z - player2->transform.position.z) <= 1.0f &&
-					abs(ball->transform.position.y - player2->transform.position.y) <= 0.5f) ||
-				(abs(ball->transform.position.z - player2->transform.position.z) <= 0.5f &&
-					abs(ball->transform.position.y - player2->transform.position.y) <= 1.0f) ||
-				std::pow(ball->transform.position.y - player2->transform.position.y + 0.5f, 2.0f) +
-					std::pow(ball->transform.position.z - player2->transform.position.z + 0.5f, 2.0f) <= 0.25 ||
-				std::pow(ball->transform.position.y - player2->transform.position.y - 0.5f, 2.0f) +
-					std::pow(ball->transform.position.z - player2->transform.position.z + 0.5f, 2.0f) <= 0.25 ||
-				std::pow(ball->transform.position.y - player2->transform.position.y + 0.5f, 2.0f) +
-					std::pow(ball->transform.position.z - player2->transform.position.z - 0.5f, 2.0f) <= 0.25 ||
-				std::pow(ball->transform.position.y - player2->transform.position.y - 0.5f, 2.0f) +
-					std::pow(ball->transform.position.z - player2->transform.position.z - 0.5f, 2.0f) <= 0.25) {
-				if (lastHit != 2) {
-					lastHit = 2;
-					hits = 0;
+				for (auto const &job : jobs) {
+					job();
 				}
-				if (bz < 0.0f)
-					hits++;
-				by += (ball->transform.position.y - player2->transform.position.y) + p2y;
-				float temp = bz;
-				bz = p2z + 2.0f;
-				if (p2z != 0.0f)
-					p2z = temp;
+				jobs.clear();
 
+				if (scene_shader.poll(gl)) {
+					reloaded_program = (uint64_t(scene_shader.generation) << 32) | scene_shader.program;
+					std::cout << "Reloaded shaders." << std::endl;
+				}
+
+				if (!snapshots.acquire()) {
+					//nothing new to draw yet:
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+					continue;
+				}
+				Scene::Snapshot const &snapshot = snapshots.read_buffer();
+
+				//draw output:
+				gl.begin_frame();
+				//(reserving the frame's whole footprint up front, since growing mid-frame would orphan the Frame block uploaded below)
+				streaming.begin_frame(frame_uniforms.alignment + sizeof(FrameUniforms::Block) + (snapshot.objects.size() + 1) * sizeof(InstanceBuffer::Instance));
+				gl.clear_color(glm::vec4(0.5f, 0.5f, 0.5f, 0.0f));
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				gl.enable(GL_DEPTH_TEST);
+				gl.enable(GL_BLEND);
+				gl.blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+
+				{ //draw game state:
+					light_clusters.update(snapshot, config.size, workers, gl);
+					//compile out whatever this frame doesn't need (e.g., the cluster walk when no point lights are near the view):
+					scene.variant_mask = (light_clusters.directional_count ? SceneShader::DirectionalLights : 0)
+						| (light_clusters.index_count ? SceneShader::PointLights : 0)
+						| (config.fog ? SceneShader::Fog : 0);
+					uint32_t built = -1U;
+					for (auto const &object : snapshot.objects) {
+						uint32_t features = object.features & scene.variant_mask;
+						if (features != built) {
+							scene_shader.variant(features, gl); //(builds on first use; a no-op after that)
+							built = features;
+						}
+					}
+					frame_uniforms.block.projection = snapshot.camera.make_projection();
+					light_clusters.write(&frame_uniforms.block);
+					frame_uniforms.upload(streaming, gl);
+					light_clusters.bind(gl);
+					scene.render(snapshot, gl, streaming, workers);
+				}
+				streaming.end_frame();
+
+				{ //free mesh buffers that only older snapshots drew from:
+					std::lock_guard< std::mutex > lock(meshes_mutex);
+					for (GLuint vao : meshes.retire(snapshot.mesh_generation, gl)) {
+						scene.render_instance_buffer.forget(vao);
+					}
+				}
+				//...and shader programs that only older snapshots drew with:
+				scene_shader.retire(snapshot.program_generation, gl);
+
+				if (print_stats.exchange(false)) {
+					std::cout << "Last frame: " << scene.stats.visible << " visible, " << scene.stats.culled << " culled, " << scene.stats.occluded << " occluded, " << scene.stats.draws << " draw calls; "
+						<< gl.frame.issued << " GL state calls issued, " << gl.frame.skipped << " skipped." << std::endl;
+				}
+
+				if (take_screenshot.exchange(false)) {
+					screenshots.capture("screenshot-" + std::to_string(uint64_t(std::time(nullptr))) + "-" + std::to_string(screenshot_index++) + ".png", config.size);
+				}
+				screenshots.poll();
+
+				if (toggle_recording.exchange(false)) {
+					if (video.recording()) {
+						video.stop();
+					} else {
+						try {
+							video.start("capture-" + std::to_string(uint64_t(std::time(nullptr))), config.record_format, config.size);
+						} catch (std::exception const &e) {
+							std::cerr << "Failed to start recording: " << e.what() << std::endl;
+						}
+					}
+				}
+				video.capture();
+				video.poll();
+
+				SDL_GL_SwapWindow(window);
+				GLTrace::frame();
 			}
-			else if (ball->transform.position.z != 0.5f) {
-				bz = bz - 10.0f*elapsed;
-			}
-			by = by * std::pow(0.9f,elapsed);
-			if (player2->transform.position.z != 0.5f)
-				p2z = p2z - 10.0f*elapsed;
-			if (player1->transform.position.z != 0.5f)
-				p1z = p1z - 10.0f*elapsed;
-
-			//Translations
-			player1->transform.position.y += elapsed * p1y;
-			player1->transform.position.z += elapsed * p1z;
-			player2->transform.position.y += elapsed * p2y;
-			player2->transform.position.z += elapsed * p2z;
-			ball->transform.position.y += elapsed * by;
-			ball->transform.position.z += elapsed * bz;
-
-			//Player and world collision
-			if (player1->transform.position.z <= 0.5f) {
-				p1z = 0.0f;
-				player1->transform.position.z = 0.5f;
-			}
-			if (player1->transform.position.y > 9.5f) {
-				p1y = 0.0f;
-				player1->transform.position.y = 9.5f;
-			} else if(player1->transform.position.y < 1.0f) {
-				p1y = 0.0f;
-				player1->transform.position.y = 1.0f;
-			}
-			if (player2->transform.position.z <= 0.5f) {
-				p2z = 0.0f;
-				player2->transform.position.z = 0.5f;
+			screenshots.flush();
+			video.stop();
+			SDL_GL_MakeCurrent(window, nullptr);
+		});
+
+		bool should_quit = false;
+		while (true) {
+			static SDL_Event evt;
+			while (SDL_PollEvent(&evt) == 1) {
+				//handle input:
+				if (evt.type == SDL_MOUSEMOTION) {
+					mouse.x = (evt.motion.x + 0.5f) / float(config.size.x) * 2.0f - 1.0f;
+					mouse.y = (evt.motion.y + 0.5f) / float(config.size.y) *-2.0f + 1.0f;
+				}
+				else if (evt.type == SDL_MOUSEBUTTONDOWN) {
+					//pick the object under the mouse:
+					float tan_y = std::tan(0.5f * scene.camera.fovy);
+					glm::mat4 camera_to_world = scene.camera.transform.make_local_to_world();
+					glm::vec3 direction = glm::mat3(camera_to_world) * glm::vec3(mouse.x * tan_y * scene.camera.aspect, mouse.y * tan_y, -1.0f);
+					BVH::Hit hit;
+					if (bvh.raycast(glm::vec3(camera_to_world[3]), direction, &hit)) {
+						std::cout << "Picked '" << *hit.name << "'." << std::endl;
+					}
+				}
+				else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_ESCAPE) {
+					should_quit = true;
+				}
+				else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F3) {
+					print_stats = true; //(stats live on the render thread)
+				}
+				else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F10) {
+					toggle_recording = true;
+				}
+				else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F12) {
+					take_screenshot = true;
+				}
+				else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F5) {
+					try {
+						save_match();
+					} catch (std::exception const &e) {
+						std::cerr << "Failed to save checkpoint: " << e.what() << std::endl;
+					}
+				}
+				else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F9) {
+					try {
+						restore_match();
+						bvh.build(scene);
+					} catch (std::exception const &e) {
+						std::cerr << "Failed to restore checkpoint: " << e.what() << std::endl;
+					}
+				}
+				else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_w && p1z == 0.0f && player1->transform.position.z == 0.5f) {
+					p1z = 10.0f;
+				}
+				else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_UP && p2z == 0.0f && player2->transform.position.z == 0.5f) {
+					p2z = 10.0f;
+				}
+				else if (evt.type == SDL_QUIT) {
+					should_quit = true;
+					break;
+				}
 			}
-			if (player2->transform.position.y > -1.0f) {
-				p2y = 0.0f;
-				player2->transform.position.y = -1.0f;
+			if (should_quit) break;
+
+			for (auto const &path : watcher.poll()) {
+				if (path == "meshes.blob") {
+					//re-uploading needs the GL context, so hand it to the render thread:
+					std::lock_guard< std::mutex > lock(render_jobs_mutex);
+					render_jobs.emplace_back([&meshes, &meshes_mutex, &reloaded_meshes, &gl, path]() {
+						std::lock_guard< std::mutex > lock(meshes_mutex);
+						try {
+							std::vector< std::string > changed = meshes.reload(path, gl);
+							reloaded_meshes.insert(reloaded_meshes.end(), changed.begin(), changed.end());
+							std::cout << "Reloaded " << changed.size() << " mesh(es) from '" << path << "'." << std::endl;
+						} catch (std::exception const &e) {
+							//the exporter may still be writing; keep what we have and wait for the next change:
+							std::cerr << "Failed to reload '" << path << "': " << e.what() << std::endl;
+						}
+					});
+				} else if (path == SceneShader::VertexPath || path == SceneShader::FragmentPath) {
+					//compiling needs the GL context; the render thread picks up the result once it links:
+					std::lock_guard< std::mutex > lock(render_jobs_mutex);
+					render_jobs.emplace_back([&scene_shader, &gl, path]() {
+						try {
+							scene_shader.reload(gl);
+						} catch (std::exception const &e) {
+							std::cerr << "Failed to reload '" << path << "': " << e.what() << std::endl;
+						}
+					});
+				} else if (path == "scene.blob") {
+					try {
+						std::lock_guard< std::mutex > lock(meshes_mutex); //(new objects look up meshes)
+						std::vector< std::string > changed = read_scene();
+						std::cout << "Reloaded " << changed.size() << " object(s) from '" << path << "'." << std::endl;
+						bvh.build(scene);
+					} catch (std::exception const &e) {
+						std::cerr << "Failed to reload '" << path << "': " << e.what() << std::endl;
+					}
+				}
 			}
-			else if (player2->transform.position.y < -9.5f) {
-				p2y = 0.0f;
-				player2->transform.position.y = -9.5f;
+
+			{ //point objects at meshes the render thread re-uploaded:
+				std::lock_guard< std::mutex > lock(meshes_mutex);
+				if (!reloaded_meshes.empty()) {
+					for (auto const &name : reloaded_meshes) {
+						auto f = scene.objects.find(name);
+						if (f != scene.objects.end()) apply_mesh(f->second, meshes.get(name));
+					}
+					reloaded_meshes.clear();
+					bvh.build(scene);
+				}
+				scene.mesh_generation = meshes.generation;
 			}
 
-			//Point condition
-			if (ball->transform.position.z <= 0.5f || hits >= 4 ||
-				(std::abs(ball->transform.position.y) <= 0.5f && ball->transform.position.z <= 3.5f) ||
-				ball->transform.position.y >= 9.5f || ball->transform.position.y <= -9.5){
-				bz = 0.0f;
-				by = 0.0f;
-				player1->transform.position = glm::vec3(0.0f, 5.0f, 0.5f);
-				player2->transform.position = glm::vec3(0.0f, -5.0f, 0.5f);
-				//Net
-				if (std::abs(ball->transform.position.y) <= 0.5f && ball->transform.position.z <= 3.5f) {
-					if (lastHit == 1) {
-						lastHit = 2;
-						ball->transform.position = glm::vec3(0.0f, -5.0f, 7.5f);
+			{ //point objects at a rebuilt shader program:
+				uint64_t reloaded = reloaded_program.exchange(0);
+				if (reloaded) {
+					GLuint reloaded_default = GLuint(reloaded);
+					for (auto &object : scene.objects) {
+						if (object.second.program == program) object.second.program = reloaded_default;
 					}
-					else {
-						ball->transform.position = glm::vec3(0.0f, 5.0f, 7.5f);
+					program = reloaded_default;
+					scene.program_generation = uint32_t(reloaded >> 32);
+				}
+			}
+
+			auto current_time = std::chrono::high_resolution_clock::now();
+			static auto previous_time = current_time;
+			float elapsed = std::chrono::duration< float >(current_time - previous_time).count();
+			previous_time = current_time;
+
+			{ //update game state:
+				auto state = SDL_GetKeyboardState(nullptr);
+				if (state[SDL_SCANCODE_A] && !state[SDL_SCANCODE_D])
+					p1y = 5.0f;
+				else if (!state[SDL_SCANCODE_A] && state[SDL_SCANCODE_D])
+					p1y = -5.0f;
+				else
+					p1y = 0.0f;
+				if (state[SDL_SCANCODE_LEFT] && !state[SDL_SCANCODE_RIGHT])
+					p2y = 5.0f;
+				else if (!state[SDL_SCANCODE_LEFT] && state[SDL_SCANCODE_RIGHT])
+					p2y = -5.0f;
+				else
+					p2y = 0.0f;
+
+				//Player and ball collision
+				if ((abs(ball->transform.position.z - player1->transform.position.z) <= 1.0f &&
+						abs(ball->transform.position.y - player1->transform.position.y) <= 0.5f) ||
+					(abs(ball->transform.position.z - player1->transform.position.z) <= 0.5f &&
+						abs(ball->transform.position.y - player1->transform.position.y) <= 1.0f) ||
+					std::pow(ball->transform.position.y- player1->transform.position.y + 0.5f,2.0f) + 
+						std::pow(ball->transform.position.z - player1->transform.position.z + 0.5f, 2.0f) <= 0.25 ||
+					std::pow(ball->transform.position.y - player1->transform.position.y - 0.5f, 2.0f) +
+						std::pow(ball->transform.position.z - player1->transform.position.z + 0.5f, 2.0f) <= 0.25 || 
+					std::pow(ball->transform.position.y - player1->transform.position.y + 0.5f, 2.0f) +
+						std::pow(ball->transform.position.z - player1->transform.position.z - 0.5f, 2.0f) <= 0.25 || 
+					std::pow(ball->transform.position.y - player1->transform.position.y - 0.5f, 2.0f) +
+						std::pow(ball->transform.position.z - player1->transform.position.z - 0.5f, 2.0f) <= 0.25){
+					if (lastHit != 1) {
 						lastHit = 1;
+						hits = 0;
 					}
+					if(bz < 0.0f)
+						hits++;
+					by += (ball->transform.position.y - player1->transform.position.y) + p1y;
+					float temp = bz;
+					bz = p1z + 2.0f;
+					if (p1z != 0.0f)
+						p1z = temp;
 				}
-				//Ball dropped
-				else if (ball->transform.position.y < 0.0f && ball->transform.position.y > -9.5) {
-					ball->transform.position = glm::vec3(0.0f, 5.0f, 7.5f);
-					lastHit = 1;
+				else if ((abs(ball->transform.position.z - player2->transform.position.z) <= 1.0f &&
+						abs(ball->transform.position.y - player2->transform.position.y) <= 0.5f) ||
+					(abs(ball->transform.position.z - player2->transform.position.z) <= 0.5f &&
+						abs(ball->transform.position.y - player2->transform.position.y) <= 1.0f) ||
+					std::pow(ball->transform.position.y - player2->transform.position.y + 0.5f, 2.0f) +
+						std::pow(ball->transform.position.z - player2->transform.position.z + 0.5f, 2.0f) <= 0.25 ||
+					std::pow(ball->transform.position.y - player2->transform.position.y - 0.5f, 2.0f) +
+						std::pow(ball->transform.position.z - player2->transform.position.z + 0.5f, 2.0f) <= 0.25 ||
+					std::pow(ball->transform.position.y - player2->transform.position.y + 0.5f, 2.0f) +
+						std::pow(ball->transform.position.z - player2->transform.position.z - 0.5f, 2.0f) <= 0.25 ||
+					std::pow(ball->transform.position.y - player2->transform.position.y - 0.5f, 2.0f) +
+						std::pow(ball->transform.position.z - player2->transform.position.z - 0.5f, 2.0f) <= 0.25) {
+					if (lastHit != 2) {
+						lastHit = 2;
+						hits = 0;
+					}
+					if (bz < 0.0f)
+						hits++;
+					by += (ball->transform.position.y - player2->transform.position.y) + p2y;
+					float temp = bz;
+					bz = p2z + 2.0f;
+					if (p2z != 0.0f)
+						p2z = temp;
+
 				}
-				else if (ball->transform.position.y > 0.0f && ball->transform.position.y < 9.5){
-					ball->transform.position = glm::vec3(0.0f, -5.0f, 7.5f);
-					lastHit = 2;
+				else if (ball->transform.position.z != 0.5f) {
+					bz = bz - 10.0f*elapsed;
 				}
-				//Out of bounds
-				else {
-					if (lastHit == 1) {
-						lastHit = 2;
-						ball->transform.position = glm::vec3(0.0f, -5.0f, 7.5f);
+				by = by * std::pow(0.9f,elapsed);
+				if (player2->transform.position.z != 0.5f)
+					p2z = p2z - 10.0f*elapsed;
+				if (player1->transform.position.z != 0.5f)
+					p1z = p1z - 10.0f*elapsed;
+
+				//Translations
+				player1->transform.position.y += elapsed * p1y;
+				player1->transform.position.z += elapsed * p1z;
+				player2->transform.position.y += elapsed * p2y;
+				player2->transform.position.z += elapsed * p2z;
+				ball->transform.position.y += elapsed * by;
+				ball->transform.position.z += elapsed * bz;
+
+				//Player and world collision
+				if (player1->transform.position.z <= 0.5f) {
+					p1z = 0.0f;
+					player1->transform.position.z = 0.5f;
+				}
+				if (player1->transform.position.y > 9.5f) {
+					p1y = 0.0f;
+					player1->transform.position.y = 9.5f;
+				} else if(player1->transform.position.y < 1.0f) {
+					p1y = 0.0f;
+					player1->transform.position.y = 1.0f;
+				}
+				if (player2->transform.position.z <= 0.5f) {
+					p2z = 0.0f;
+					player2->transform.position.z = 0.5f;
+				}
+				if (player2->transform.position.y > -1.0f) {
+					p2y = 0.0f;
+					player2->transform.position.y = -1.0f;
+				}
+				else if (player2->transform.position.y < -9.5f) {
+					p2y = 0.0f;
+					player2->transform.position.y = -9.5f;
+				}
+
+				//Point condition
+				if (ball->transform.position.z <= 0.5f || hits >= 4 ||
+					(std::abs(ball->transform.position.y) <= 0.5f && ball->transform.position.z <= 3.5f) ||
+					ball->transform.position.y >= 9.5f || ball->transform.position.y <= -9.5){
+					bz = 0.0f;
+					by = 0.0f;
+					player1->transform.position = glm::vec3(0.0f, 5.0f, 0.5f);
+					player2->transform.position = glm::vec3(0.0f, -5.0f, 0.5f);
+					//Net
+					if (std::abs(ball->transform.position.y) <= 0.5f && ball->transform.position.z <= 3.5f) {
+						if (lastHit == 1) {
+							lastHit = 2;
+							ball->transform.position = glm::vec3(0.0f, -5.0f, 7.5f);
+						}
+						else {
+							ball->transform.position = glm::vec3(0.0f, 5.0f, 7.5f);
+							lastHit = 1;
+						}
 					}
-					else {
+					//Ball dropped
+					else if (ball->transform.position.y < 0.0f && ball->transform.position.y > -9.5) {
 						ball->transform.position = glm::vec3(0.0f, 5.0f, 7.5f);
 						lastHit = 1;
 					}
+					else if (ball->transform.position.y > 0.0f && ball->transform.position.y < 9.5){
+						ball->transform.position = glm::vec3(0.0f, -5.0f, 7.5f);
+						lastHit = 2;
+					}
+					//Out of bounds
+					else {
+						if (lastHit == 1) {
+							lastHit = 2;
+							ball->transform.position = glm::vec3(0.0f, -5.0f, 7.5f);
+						}
+						else {
+							ball->transform.position = glm::vec3(0.0f, 5.0f, 7.5f);
+							lastHit = 1;
+						}
+					}
+					hits = 0;
 				}
-				hits = 0;
-			}
 			
-			//camera:
-			scene.camera.transform.position = camera.radius * glm::vec3(
-				std::cos(camera.elevation) * std::cos(camera.azimuth),
-				std::cos(camera.elevation) * std::sin(camera.azimuth),
-				std::sin(camera.elevation)) + camera.target;
-
-			glm::vec3 out = -glm::normalize(camera.target - scene.camera.transform.position);
-			glm::vec3 up = glm::vec3(0.0f, 0.0f, 1.0f);
-			up = glm::normalize(up - glm::dot(up, out) * out);
-			glm::vec3 right = glm::cross(up, out);
-
-			scene.camera.transform.rotation = glm::quat_cast(
-				glm::mat3(right, up, out)
-			);
-			scene.camera.transform.scale = glm::vec3(1.0f, 1.0f, 1.0f);
-		}
-
-		//draw output:
-		glClearColor(0.5, 0.5, 0.5, 0.0);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		glEnable(GL_DEPTH_TEST);
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+				bvh.moved(player1);
+				bvh.moved(player2);
+				bvh.moved(ball);
+				bvh.refit();
+
+				//camera:
+				scene.camera.transform.position = camera.radius * glm::vec3(
+					std::cos(camera.elevation) * std::cos(camera.azimuth),
+					std::cos(camera.elevation) * std::sin(camera.azimuth),
+					std::sin(camera.elevation)) + camera.target;
+
+				glm::vec3 out = -glm::normalize(camera.target - scene.camera.transform.position);
+				glm::vec3 up = glm::vec3(0.0f, 0.0f, 1.0f);
+				up = glm::normalize(up - glm::dot(up, out) * out);
+				glm::vec3 right = glm::cross(up, out);
+
+				scene.camera.transform.rotation = glm::quat_cast(
+					glm::mat3(right, up, out)
+				);
+				scene.camera.transform.scale = glm::vec3(1.0f, 1.0f, 1.0f);
+			}
 
+			//hand the new state to the render thread:
+			scene.snapshot(&snapshots.write_buffer());
+			snapshots.publish();
 
-		{ //draw game state:
-			glUseProgram(program);
-			glUniform3fv(program_to_light, 1, glm::value_ptr(glm::normalize(glm::vec3(0.0f, 1.0f, 10.0f))));
-			scene.render();
+			std::this_thread::sleep_until(current_time + std::chrono::microseconds(int32_t(config.tick * 1e6f)));
 		}
 
 
-		SDL_GL_SwapWindow(window);
-	}
+		//------------  teardown ------------
 
-
-	//------------  teardown ------------
+		render_quit = true;
+		render_thread.join();
+		//(take the context back, so the GL objects above are deleted as the scope closes)
+		SDL_GL_MakeCurrent(window, context);
+	}
 
 	SDL_GL_DeleteContext(context);
 	context = 0;
@@ -466,47 +733,3 @@ int main(int argc, char **argv) {
 
 	return 0;
 }
-
-
-
-static GLuint compile_shader(GLenum type, std::string const &source) {
-	GLuint shader = glCreateShader(type);
-	GLchar const *str = source.c_str();
-	GLint length = source.size();
-	glShaderSource(shader, 1, &str, &length);
-	glCompileShader(shader);
-	GLint compile_status = GL_FALSE;
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &compile_status);
-	if (compile_status != GL_TRUE) {
-		std::cerr << "Failed to compile shader." << std::endl;
-		GLint info_log_length = 0;
-		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &info_log_length);
-		std::vector< GLchar > info_log(info_log_length, 0);
-		GLsizei length = 0;
-		glGetShaderInfoLog(shader, info_log.size(), &length, &info_log[0]);
-		std::cerr << "Info log: " << std::string(info_log.begin(), info_log.begin() + length);
-		glDeleteShader(shader);
-		throw std::runtime_error("Failed to compile shader.");
-	}
-	return shader;
-}
-
-static GLuint link_program(GLuint fragment_shader, GLuint vertex_shader) {
-	GLuint program = glCreateProgram();
-	glAttachShader(program, vertex_shader);
-	glAttachShader(program, fragment_shader);
-	glLinkProgram(program);
-	GLint link_status = GL_FALSE;
-	glGetProgramiv(program, GL_LINK_STATUS, &link_status);
-	if (link_status != GL_TRUE) {
-		std::cerr << "Failed to link shader program." << std::endl;
-		GLint info_log_length = 0;
-		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &info_log_length);
-		std::vector< GLchar > info_log(info_log_length, 0);
-		GLsizei length = 0;
-		glGetProgramInfoLog(program, info_log.size(), &length, &info_log[0]);
-		std::cerr << "Info log: " << std::string(info_log.begin(), info_log.begin() + length);
-		throw std::runtime_error("Failed to link program");
-	}
-	return program;
-}
\ No newline at end of file
@@ -0,0 +1,71 @@
+//pack-textures converts PNG files into a texture pack (see TexturePack.hpp), which the game maps and uploads
+// without decoding anything: images are flipped, packed into atlases (or pages of their own), and mipmapped here, once.
+//Entries are named by the paths given on the command line, so run it from the directory the game loads textures from.
+
+#include "TexturePack.hpp"
+#include "WorkerPool.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+
+int main(int argc, char **argv) {
+	TexturePack::Settings settings;
+	std::string output;
+	std::vector< std::string > inputs;
+
+	bool usage = false;
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--filter" && argi + 1 < argc) {
+			std::string filter = argv[++argi];
+			if (filter == "box") settings.filter = BoxFilter;
+			else if (filter == "kaiser") settings.filter = KaiserFilter;
+			else usage = true;
+		} else if (arg == "--atlas-width" && argi + 1 < argc) {
+			settings.atlas_width = uint32_t(std::max(1, std::atoi(argv[++argi])));
+		} else if (arg == "--atlas-max-image" && argi + 1 < argc) {
+			settings.atlas_max_image = uint32_t(std::max(0, std::atoi(argv[++argi])));
+		} else if (arg[0] != '-' && output.empty()) {
+			output = arg;
+		} else if (arg[0] != '-') {
+			inputs.emplace_back(arg);
+		} else {
+			usage = true;
+		}
+	}
+	if (usage || output.empty() || inputs.empty()) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [--filter box|kaiser] [--atlas-width <pixels>] [--atlas-max-image <pixels>] <output.tpk> <input.png> [...]" << std::endl;
+		return 1;
+	}
+
+	try {
+		auto before = std::chrono::high_resolution_clock::now();
+		WorkerPool workers;
+		TexturePack pack;
+		pack.build(inputs, workers, settings);
+		pack.save(output);
+		auto after = std::chrono::high_resolution_clock::now();
+
+		uint32_t atlases = 0;
+		size_t pixels = 0;
+		for (auto const &page : pack.pages) {
+			if (page.atlas) atlases += 1;
+			glm::uvec2 size = page.size;
+			for (size_t level = 0; level < page.levels.size(); ++level) {
+				pixels += size_t(size.x) * size.y;
+				size = mip_size(size);
+			}
+		}
+		std::cout << "Packed " << pack.entries.size() << " images into " << pack.pages.size() << " pages (" << atlases << " atlases), "
+			<< (pixels * 4) / 1024 << "k of pixels, in " << std::chrono::duration< double >(after - before).count() << "s." << std::endl;
+	} catch (std::exception const &e) {
+		std::cerr << "ERROR: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
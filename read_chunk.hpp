@@ -4,6 +4,8 @@
 #include <vector>
 #include <stdexcept>
 #include <cassert>
+#include <cstring>
+#include <cstdint>
 
 template< typename T >
 void read_chunk(std::istream &from, std::string const &magic, std::vector< T > *_to) {
@@ -33,3 +35,41 @@ void read_chunk(std::istream &from, std::string const &magic, std::vector< T > *
 		throw std::runtime_error("Failed to read chunk data.");
 	}
 }
+
+//read a chunk in place from memory (e.g., a mapped file) without copying:
+// on success, '*from' is advanced past the chunk and '*data' points at its '*count' elements.
+// note: the chunk data must be suitably aligned for T.
+template< typename T >
+void read_chunk(char const **from, char const *end, std::string const &magic, T const **data, size_t *count) {
+	assert(from && *from && data && count);
+
+	struct ChunkHeader {
+		char magic[4] = {'\0', '\0', '\0', '\0'};
+		uint32_t size = 0;
+	};
+	static_assert(sizeof(ChunkHeader) == 8, "header is packed");
+
+	if (size_t(end - *from) < sizeof(ChunkHeader)) {
+		throw std::runtime_error("Failed to read chunk header");
+	}
+	ChunkHeader header;
+	std::memcpy(&header, *from, sizeof(header));
+	if (std::string(header.magic,4) != magic) {
+		throw std::runtime_error("Unexpected magic number in chunk");
+	}
+
+	if (header.size % sizeof(T) != 0) {
+		throw std::runtime_error("Size of chunk not divisible by element size");
+	}
+	char const *begin = *from + sizeof(ChunkHeader);
+	if (size_t(end - begin) < header.size) {
+		throw std::runtime_error("Failed to read chunk data.");
+	}
+	if (reinterpret_cast< uintptr_t >(begin) % alignof(T) != 0) {
+		throw std::runtime_error("Chunk data is misaligned.");
+	}
+
+	*data = reinterpret_cast< T const * >(begin);
+	*count = header.size / sizeof(T);
+	*from = begin + header.size;
+}
@@ -0,0 +1,264 @@
+//render-test draws fixed views of the game's scene without a window and checks them against reference images:
+// each view is rendered into an offscreen framebuffer, read back, and compared with <references>/<view>.png.
+//A pixel counts as different if any color channel differs by more than --tolerance (out of 255);
+// a view fails if more than --max-different (a fraction of all pixels) differ.
+// For failing views, <view>.actual.png and <view>.diff.png (differing pixels in red) are written next to the reference.
+//With --frames, each view is also drawn that many times and the average frame time is reported.
+//Run from the 'dist' directory (it reads meshes.blob and scene.blob, like the game).
+
+#include "GL.hpp"
+#include "HeadlessContext.hpp"
+#include "Offscreen.hpp"
+#include "GLState.hpp"
+#include "SceneShader.hpp"
+#include "SceneFile.hpp"
+#include "Meshes.hpp"
+#include "Scene.hpp"
+#include "LightClusters.hpp"
+#include "FrameUniforms.hpp"
+#include "StreamingBuffer.hpp"
+#include "OcclusionBuffer.hpp"
+#include "WorkerPool.hpp"
+#include "load_save_png.hpp"
+
+#include <SDL.h> //(main becomes SDL_main where HeadlessContext uses SDL)
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+//camera placement, parameterized like the game's orbit camera:
+struct View {
+	char const *name;
+	float radius;
+	float elevation;
+	float azimuth;
+	glm::vec3 target;
+};
+
+int main(int argc, char **argv) {
+	//Configuration:
+	struct {
+		std::string references = "render-test"; //directory holding <view>.png (must exist)
+		bool update = false; //write references instead of comparing
+		uint32_t tolerance = 8; //largest per-channel difference that still counts as matching
+		float max_different = 0.001f; //fraction of pixels allowed to differ
+		uint32_t frames = 0; //if nonzero, time this many frames per view
+		glm::uvec2 size = glm::uvec2(640, 480); //(same as the game's window)
+	} config;
+
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--update") {
+			config.update = true;
+		} else if (arg == "--tolerance" && argi + 1 < argc) {
+			config.tolerance = uint32_t(std::max(0, std::atoi(argv[++argi])));
+		} else if (arg == "--max-different" && argi + 1 < argc) {
+			config.max_different = float(std::atof(argv[++argi]));
+		} else if (arg == "--frames" && argi + 1 < argc) {
+			config.frames = uint32_t(std::max(0, std::atoi(argv[++argi])));
+		} else if (arg[0] != '-') {
+			config.references = arg;
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--update] [--tolerance <0-255>] [--max-different <fraction>] [--frames <n>] [references directory]" << std::endl;
+			return 1;
+		}
+	}
+
+	HeadlessContext context;
+	std::cout << "Rendering with " << context.renderer << "." << std::endl;
+
+	//------------ renderer (set up like the game's) ------------
+
+	GLState gl;
+	SceneShader scene_shader(gl);
+
+	WorkerPool workers;
+	LightClusters light_clusters;
+	FrameUniforms frame_uniforms;
+	StreamingBuffer streaming;
+
+	Meshes meshes;
+	meshes.load("meshes.blob", scene_shader.attributes);
+
+	Scene scene;
+	scene.camera.fovy = glm::radians(60.0f);
+	scene.camera.aspect = float(config.size.x) / float(config.size.y);
+	scene.camera.near_plane = 0.01f;
+
+	SceneFile scene_file;
+	scene_file.read("scene.blob", &scene, [&](std::string const &name, Scene::Object &object) {
+		Mesh const &mesh = meshes.get(name);
+		object.vao = mesh.vao;
+		object.start = mesh.start;
+		object.count = mesh.count;
+		object.bounds = mesh.bounds;
+		object.sphere = mesh.sphere;
+		object.program = scene_shader.program;
+	});
+
+	for (auto const &name : { "Plane", "Cube.002", "Cube.003", "Cube.004", "Cube.005" }) {
+		auto f = scene.objects.find(name);
+		if (f != scene.objects.end()) f->second.occluder = true;
+	}
+	OcclusionBuffer occlusion(workers);
+	scene.occlusion = &occlusion;
+
+	{ //lights (as in the game, with the glow at the ball's serve position):
+		scene.lights.emplace_back();
+		Scene::Light &sun = scene.lights.back();
+		sun.type = Scene::Light::Directional;
+		sun.transform.rotation = glm::angleAxis(-std::atan2(1.0f, 10.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+
+		scene.lights.emplace_back();
+		Scene::Light &glow = scene.lights.back();
+		glow.type = Scene::Light::Point;
+		glow.intensity = glm::vec3(0.6f, 0.5f, 0.3f);
+		glow.range = 4.0f;
+		glow.transform.position = glm::vec3(0.0f, 5.0f, 7.5f);
+	}
+
+	Offscreen target(config.size);
+
+	//------------ views ------------
+
+	static View const views[] = {
+		{ "game", 18.0f, -10.0f, 0.0f, glm::vec3(0.0f) }, //the game's starting camera
+		{ "side", 12.0f, 0.8f, 1.5708f, glm::vec3(0.0f, -3.0f, 0.0f) }, //from inside the court, over the net at player 2
+		{ "above", 20.0f, 1.3f, 0.0f, glm::vec3(0.0f) },
+		{ "low", 10.0f, 0.1f, 0.8f, glm::vec3(0.0f, 0.0f, 2.0f) }, //mostly hidden behind the net
+	};
+
+	Scene::Snapshot snapshot;
+	std::vector< uint32_t > pixels;
+	uint32_t failed = 0;
+
+	for (View const &view : views) {
+		//place the camera exactly as the game does:
+		scene.camera.transform.position = view.radius * glm::vec3(
+			std::cos(view.elevation) * std::cos(view.azimuth),
+			std::cos(view.elevation) * std::sin(view.azimuth),
+			std::sin(view.elevation)) + view.target;
+		glm::vec3 out = -glm::normalize(view.target - scene.camera.transform.position);
+		glm::vec3 up = glm::vec3(0.0f, 0.0f, 1.0f);
+		up = glm::normalize(up - glm::dot(up, out) * out);
+		glm::vec3 right = glm::cross(up, out);
+		scene.camera.transform.rotation = glm::quat_cast(glm::mat3(right, up, out));
+		scene.camera.transform.scale = glm::vec3(1.0f);
+
+		scene.snapshot(&snapshot);
+
+		auto draw = [&]() {
+			gl.begin_frame();
+			//(reserving the frame's whole footprint up front, as the game does)
+			streaming.begin_frame(frame_uniforms.alignment + sizeof(FrameUniforms::Block) + (snapshot.objects.size() + 1) * sizeof(InstanceBuffer::Instance));
+			target.bind();
+			gl.clear_color(glm::vec4(0.5f, 0.5f, 0.5f, 0.0f));
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			gl.enable(GL_DEPTH_TEST);
+			gl.enable(GL_BLEND);
+			gl.blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+			light_clusters.update(snapshot, config.size, workers, gl);
+			frame_uniforms.block.projection = snapshot.camera.make_projection();
+			light_clusters.write(&frame_uniforms.block);
+			frame_uniforms.upload(streaming, gl);
+			light_clusters.bind(gl);
+			scene.render(snapshot, gl, streaming, workers);
+			streaming.end_frame();
+		};
+
+		draw();
+		target.read(&pixels);
+		//(background alpha is whatever the clear left; references are compared and saved opaque)
+		for (auto &px : pixels) px |= 0xff000000;
+
+		std::cout << "  " << std::left << std::setw(8) << view.name << std::right;
+
+		if (config.frames) {
+			glFinish();
+			auto before = std::chrono::steady_clock::now();
+			for (uint32_t i = 0; i < config.frames; ++i) {
+				draw();
+			}
+			glFinish();
+			auto after = std::chrono::steady_clock::now();
+			double ms = std::chrono::duration< double, std::milli >(after - before).count() / config.frames;
+			std::cout << " " << std::fixed << std::setprecision(3) << ms << " ms/frame;";
+		}
+
+		std::string reference = config.references + "/" + view.name + ".png";
+		if (config.update) {
+			save_png(reference, config.size.x, config.size.y, pixels.data(), LowerLeftOrigin, workers);
+			std::cout << " wrote '" << reference << "'." << std::endl;
+			continue;
+		}
+
+		glm::uvec2 expected_size(0);
+		std::vector< uint32_t > expected;
+		if (!load_png(reference, &expected_size.x, &expected_size.y, &expected, LowerLeftOrigin)) {
+			std::cout << " FAILED: couldn't load '" << reference << "' (run with --update to create it)." << std::endl;
+			++failed;
+			continue;
+		}
+		if (expected_size != config.size) {
+			std::cout << " FAILED: '" << reference << "' is " << expected_size.x << "x" << expected_size.y
+				<< ", expected " << config.size.x << "x" << config.size.y << "." << std::endl;
+			++failed;
+			continue;
+		}
+
+		//compare, building a diff image along the way (reference dimmed to gray, differing pixels red):
+		std::vector< uint32_t > diff(pixels.size());
+		uint32_t different = 0;
+		uint32_t largest = 0;
+		double squared = 0.0;
+		for (uint32_t i = 0; i < pixels.size(); ++i) {
+			uint32_t worst = 0;
+			uint32_t sum = 0;
+			for (uint32_t c = 0; c < 3; ++c) {
+				int32_t a = int32_t((pixels[i] >> (8 * c)) & 0xff);
+				int32_t b = int32_t((expected[i] >> (8 * c)) & 0xff);
+				uint32_t d = uint32_t(std::abs(a - b));
+				worst = std::max(worst, d);
+				squared += double(d) * double(d);
+				sum += uint32_t(b);
+			}
+			largest = std::max(largest, worst);
+			if (worst > config.tolerance) {
+				++different;
+				diff[i] = 0xff0000ff;
+			} else {
+				uint32_t gray = sum / 12;
+				diff[i] = 0xff000000 | (gray << 16) | (gray << 8) | gray;
+			}
+		}
+		double rms = std::sqrt(squared / (3.0 * pixels.size()));
+		bool ok = (different <= uint32_t(config.max_different * pixels.size()));
+
+		std::cout << " " << (ok ? "ok" : "FAILED") << ": " << different << " pixels differ (largest difference "
+			<< largest << ", rms " << std::fixed << std::setprecision(2) << rms << ")";
+		if (!ok) {
+			std::string prefix = config.references + "/" + view.name;
+			save_png(prefix + ".actual.png", config.size.x, config.size.y, pixels.data(), LowerLeftOrigin, workers);
+			save_png(prefix + ".diff.png", config.size.x, config.size.y, diff.data(), LowerLeftOrigin, workers);
+			std::cout << "; wrote '" << prefix << ".actual.png' and '" << prefix << ".diff.png'";
+			++failed;
+		}
+		std::cout << "." << std::endl;
+	}
+
+	if (!config.update) {
+		std::cout << (failed ? "FAILED: " : "Passed: ") << (sizeof(views) / sizeof(views[0]) - failed) << " of " << (sizeof(views) / sizeof(views[0])) << " views match." << std::endl;
+	}
+
+	return (failed ? 1 : 0);
+}
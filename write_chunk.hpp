@@ -0,0 +1,31 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <cassert>
+#include <cstdint>
+
+//write a chunk in the format understood by read_chunk:
+template< typename T >
+void write_chunk(std::ostream &to, std::string const &magic, std::vector< T > const &from) {
+	assert(magic.size() == 4);
+
+	struct ChunkHeader {
+		char magic[4] = {'\0', '\0', '\0', '\0'};
+		uint32_t size = 0;
+	};
+	static_assert(sizeof(ChunkHeader) == 8, "header is packed");
+
+	ChunkHeader header;
+	for (uint32_t i = 0; i < 4; ++i) {
+		header.magic[i] = magic[i];
+	}
+	header.size = uint32_t(from.size() * sizeof(T));
+	if (!to.write(reinterpret_cast< char const * >(&header), sizeof(header))) {
+		throw std::runtime_error("Failed to write chunk header");
+	}
+	if (!from.empty() && !to.write(reinterpret_cast< char const * >(&from[0]), from.size() * sizeof(T))) {
+		throw std::runtime_error("Failed to write chunk data.");
+	}
+}